@@ -0,0 +1,300 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "Calibration.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+  || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CALIBRATION_SSE2 1
+#include <emmintrin.h>
+#else
+#define CALIBRATION_SSE2 0
+#endif
+
+namespace {
+
+using OTDIPC::Messages::State;
+
+bool HasPosition(const State& state) {
+  return state.HasData(State::ValidMask::Position);
+}
+
+}// namespace
+
+Calibration::Calibration(
+  const Transform& transform,
+  const float maxX,
+  const float maxY)
+  : mMaxX(maxX),
+    mMaxY(maxY) {
+  if (const auto affine = std::get_if<Affine>(&transform)) {
+    // Normalize, transform, then denormalize, as one transform
+    const auto& m = affine->m;
+    const auto aspect = (maxY > 0) ? (maxX / maxY) : 1.0f;
+    mAffine = {
+      m[0],
+      m[1] * aspect,
+      m[2] * maxX,
+      m[3] / aspect,
+      m[4],
+      m[5] * maxY,
+    };
+    return;
+  }
+
+  const auto& grid = std::get<Grid>(transform);
+  const auto count = static_cast<std::size_t>(grid.columns) * grid.rows;
+  if (
+    grid.columns < 2 || grid.rows < 2 || grid.x.size() != count
+    || grid.y.size() != count) {
+    throw std::runtime_error("Calibration grids must be at least 2x2");
+  }
+  mIsGrid = true;
+  mColumns = grid.columns;
+  mRows = grid.rows;
+  mGridX.resize(count);
+  mGridY.resize(count);
+  std::ranges::transform(
+    grid.x, mGridX.begin(), [maxX](const float x) { return x * maxX; });
+  std::ranges::transform(
+    grid.y, mGridY.begin(), [maxY](const float y) { return y * maxY; });
+  mCellsPerX = (maxX > 0) ? (static_cast<float>(mColumns - 1) / maxX) : 0;
+  mCellsPerY = (maxY > 0) ? (static_cast<float>(mRows - 1) / maxY) : 0;
+}
+
+std::array<float, 2> Calibration::Apply(const float x, const float y) const {
+  float outX {};
+  float outY {};
+  if (mIsGrid) {
+    // Same steps as the SIMD version, so that they agree
+    const auto lastColumn = static_cast<float>(mColumns - 1);
+    const auto lastRow = static_cast<float>(mRows - 1);
+    const auto gx = std::clamp(x * mCellsPerX, 0.0f, lastColumn);
+    const auto gy = std::clamp(y * mCellsPerY, 0.0f, lastRow);
+    const auto ix = static_cast<uint32_t>(std::min(gx, lastColumn - 1));
+    const auto iy = static_cast<uint32_t>(std::min(gy, lastRow - 1));
+    const auto fx = gx - static_cast<float>(ix);
+    const auto fy = gy - static_cast<float>(iy);
+    const auto cell = (iy * mColumns) + ix;
+    const auto lerp2 = [&](const std::vector<float>& v) {
+      const auto top = v[cell] + ((v[cell + 1] - v[cell]) * fx);
+      const auto bottom = v[cell + mColumns]
+        + ((v[cell + mColumns + 1] - v[cell + mColumns]) * fx);
+      return top + ((bottom - top) * fy);
+    };
+    outX = lerp2(mGridX);
+    outY = lerp2(mGridY);
+  } else {
+    const auto& m = mAffine;
+    outX = (m[0] * x) + (m[1] * y) + m[2];
+    outY = (m[3] * x) + (m[4] * y) + m[5];
+  }
+  return {std::clamp(outX, 0.0f, mMaxX), std::clamp(outY, 0.0f, mMaxY)};
+}
+
+void Calibration::ApplyScalar(const std::span<State> states) const {
+  for (auto&& state: states) {
+    if (HasPosition(state)) {
+      const auto [x, y] = Apply(state.x, state.y);
+      state.x = x;
+      state.y = y;
+    }
+  }
+}
+
+void Calibration::Apply(const std::span<State> states) const {
+#if CALIBRATION_SSE2
+  // States are much larger than their positions, so gathering them is most
+  // of the work; 4 at a time is enough
+  constexpr std::size_t Lanes = 4;
+  const auto whole = states.size() - (states.size() % Lanes);
+  for (std::size_t i = 0; i < whole; i += Lanes) {
+    ApplyBatch(states.subspan(i, Lanes));
+  }
+  ApplyScalar(states.subspan(whole));
+#else
+  ApplyScalar(states);
+#endif
+}
+
+#if CALIBRATION_SSE2
+void Calibration::ApplyBatch(const std::span<State> states) const {
+  const auto& s = states;
+  const auto x = _mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x);
+  const auto y = _mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y);
+
+  __m128 outX;
+  __m128 outY;
+  if (mIsGrid) {
+    const auto zero = _mm_setzero_ps();
+    const auto lastColumn = static_cast<float>(mColumns - 1);
+    const auto lastRow = static_cast<float>(mRows - 1);
+    const auto gx = _mm_min_ps(
+      _mm_max_ps(_mm_mul_ps(x, _mm_set1_ps(mCellsPerX)), zero),
+      _mm_set1_ps(lastColumn));
+    const auto gy = _mm_min_ps(
+      _mm_max_ps(_mm_mul_ps(y, _mm_set1_ps(mCellsPerY)), zero),
+      _mm_set1_ps(lastRow));
+    // Non-negative, so truncation is floor
+    const auto ix
+      = _mm_cvttps_epi32(_mm_min_ps(gx, _mm_set1_ps(lastColumn - 1)));
+    const auto iy = _mm_cvttps_epi32(_mm_min_ps(gy, _mm_set1_ps(lastRow - 1)));
+    const auto fx = _mm_sub_ps(gx, _mm_cvtepi32_ps(ix));
+    const auto fy = _mm_sub_ps(gy, _mm_cvtepi32_ps(iy));
+
+    alignas(16) int32_t column[4];
+    alignas(16) int32_t row[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(column), ix);
+    _mm_store_si128(reinterpret_cast<__m128i*>(row), iy);
+    uint32_t cells[4];
+    for (int i = 0; i < 4; ++i) {
+      cells[i] = (static_cast<uint32_t>(row[i]) * mColumns)
+        + static_cast<uint32_t>(column[i]);
+    }
+
+    const auto lerp2 = [&](const std::vector<float>& v) {
+      const auto corner = [&](const uint32_t offset) {
+        return _mm_setr_ps(
+          v[cells[0] + offset],
+          v[cells[1] + offset],
+          v[cells[2] + offset],
+          v[cells[3] + offset]);
+      };
+      const auto c00 = corner(0);
+      const auto c10 = corner(1);
+      const auto c01 = corner(mColumns);
+      const auto c11 = corner(mColumns + 1);
+      const auto top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), fx));
+      const auto bottom
+        = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), fx));
+      return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+    };
+    outX = lerp2(mGridX);
+    outY = lerp2(mGridY);
+  } else {
+    const auto& m = mAffine;
+    outX = _mm_add_ps(
+      _mm_add_ps(
+        _mm_mul_ps(_mm_set1_ps(m[0]), x), _mm_mul_ps(_mm_set1_ps(m[1]), y)),
+      _mm_set1_ps(m[2]));
+    outY = _mm_add_ps(
+      _mm_add_ps(
+        _mm_mul_ps(_mm_set1_ps(m[3]), x), _mm_mul_ps(_mm_set1_ps(m[4]), y)),
+      _mm_set1_ps(m[5]));
+  }
+  const auto zero = _mm_setzero_ps();
+  outX = _mm_min_ps(_mm_max_ps(outX, zero), _mm_set1_ps(mMaxX));
+  outY = _mm_min_ps(_mm_max_ps(outY, zero), _mm_set1_ps(mMaxY));
+
+  alignas(16) float xs[4];
+  alignas(16) float ys[4];
+  _mm_store_ps(xs, outX);
+  _mm_store_ps(ys, outY);
+  for (std::size_t i = 0; i < 4; ++i) {
+    if (HasPosition(s[i])) {
+      s[i].x = xs[i];
+      s[i].y = ys[i];
+    }
+  }
+}
+#else
+void Calibration::ApplyBatch(const std::span<State> states) const {
+  ApplyScalar(states);
+}
+#endif
+
+namespace {
+
+void ParseTransform(std::istream& tokens, Calibration::Transform& transform) {
+  const auto fail = [](const std::string& what) {
+    throw std::runtime_error("Invalid calibration file: " + what);
+  };
+  const auto readFloat = [&tokens, &fail]() {
+    float value {};
+    if (!(tokens >> value)) {
+      fail("expected a number");
+    }
+    return value;
+  };
+
+  std::string kind;
+  if (!(tokens >> kind)) {
+    fail("expected `affine` or `grid`");
+  }
+  if (kind == "affine") {
+    Calibration::Affine affine;
+    for (auto&& it: affine.m) {
+      it = readFloat();
+    }
+    transform = affine;
+  } else if (kind == "grid") {
+    Calibration::Grid grid;
+    if (!(tokens >> grid.columns >> grid.rows)) {
+      fail("expected grid dimensions");
+    }
+    // Don't trust the dimensions with an allocation
+    constexpr uint32_t MaxSize = 256;
+    if (
+      grid.columns < 2 || grid.rows < 2 || grid.columns > MaxSize
+      || grid.rows > MaxSize) {
+      fail("grids must be between 2x2 and 256x256");
+    }
+    for (uint32_t i = 0; i < grid.columns * grid.rows; ++i) {
+      grid.x.push_back(readFloat());
+      grid.y.push_back(readFloat());
+    }
+    transform = std::move(grid);
+  } else {
+    fail("unknown transform `" + kind + "`");
+  }
+
+  if (std::string extra; tokens >> extra) {
+    fail("unexpected `" + extra + "`");
+  }
+}
+
+}// namespace
+
+std::vector<CalibrationConfig> LoadCalibrationFile(
+  const std::filesystem::path& path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Failed to open calibration file");
+  }
+
+  // Section headers are whole lines, as persistent IDs may contain spaces;
+  // everything else in a section is one transform
+  std::vector<CalibrationConfig> ret;
+  std::stringstream body;
+  const auto finishSection = [&]() {
+    if (!ret.empty()) {
+      ParseTransform(body, ret.back().mTransform);
+    }
+    body = {};
+  };
+
+  for (std::string line; std::getline(file, line);) {
+    line.erase(std::ranges::find(line, '#'), line.end());
+    const auto begin = line.find_first_not_of(" \t\r");
+    const auto end = line.find_last_not_of(" \t\r");
+    if (begin == std::string::npos) {
+      continue;
+    }
+    if (line[begin] == '[' && line[end] == ']' && end > begin + 1) {
+      finishSection();
+      ret.push_back({.mPersistentId = line.substr(begin + 1, end - begin - 1)});
+      continue;
+    }
+    if (ret.empty()) {
+      throw std::runtime_error(
+        "Invalid calibration file: expected `[persistent ID]` first");
+    }
+    body << line << '\n';
+  }
+  finishSection();
+  return ret;
+}
@@ -0,0 +1,97 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <OTDIPC/State.hpp>
+
+// Corrects the tablet area and orientation that a driver reports.
+//
+// Transforms are in normalized coordinates, where (0, 0) to (1, 1) is the
+// area that the driver reports, so a calibration doesn't depend on the
+// tablet's resolution; the result is clamped to the same area.
+//
+// `Apply()` works on batches, and uses SSE2 where it's available.
+class Calibration final {
+ public:
+  // x' = m[0]x + m[1]y + m[2], y' = m[3]x + m[4]y + m[5]
+  struct Affine {
+    std::array<float, 6> m {1, 0, 0, 0, 1, 0};
+  };
+
+  // The corrected positions of `columns` by `rows` evenly-spaced points
+  // covering the reported area, in row-major order; positions between them
+  // are interpolated bilinearly
+  struct Grid {
+    uint32_t columns {};
+    uint32_t rows {};
+    std::vector<float> x;
+    std::vector<float> y;
+  };
+
+  using Transform = std::variant<Affine, Grid>;
+
+  Calibration() = delete;
+  // Throws if the grid is smaller than 2x2, or the wrong size
+  Calibration(const Transform&, float maxX, float maxY);
+
+  // Calibrate the positions of the states in place; states without a
+  // position are left alone
+  void Apply(std::span<OTDIPC::Messages::State>) const;
+  // One state at a time, without SIMD; for comparison
+  void ApplyScalar(std::span<OTDIPC::Messages::State>) const;
+
+  // Same as above, for a single position in tablet units
+  [[nodiscard]]
+  std::array<float, 2> Apply(float x, float y) const;
+
+ private:
+  bool mIsGrid {false};
+  float mMaxX {};
+  float mMaxY {};
+
+  // Affine: pre-multiplied for tablet units
+  std::array<float, 6> mAffine {};
+
+  // Grid: corners in tablet units, and tablet units to grid cells
+  uint32_t mColumns {};
+  uint32_t mRows {};
+  std::vector<float> mGridX;
+  std::vector<float> mGridY;
+  float mCellsPerX {};
+  float mCellsPerY {};
+
+  void ApplyBatch(std::span<OTDIPC::Messages::State>) const;
+};
+
+// A calibration for the tablet with the given persistent ID, or `*` for
+// every tablet without its own
+struct CalibrationConfig {
+  std::string mPersistentId;
+  Calibration::Transform mTransform;
+};
+
+// Reads a text file of sections like:
+//
+//   [wintab-pnpid:...]
+//   affine 1 0 0  0 1 0
+//
+// or:
+//
+//   [*]
+//   grid 2 2
+//   0 0    1 0
+//   0 1    1 1
+//
+// where the grid lines are the corrected x and y of each point, row by row.
+// `#` starts a comment. Throws `std::runtime_error` on syntax errors.
+[[nodiscard]]
+std::vector<CalibrationConfig> LoadCalibrationFile(
+  const std::filesystem::path&);
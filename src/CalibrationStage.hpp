@@ -0,0 +1,109 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "Calibration.hpp"
+#include "Pipeline.hpp"
+
+// Applies the matching `CalibrationConfig` to each tablet's positions.
+//
+// Tablets are matched by persistent ID when they're added; tablets without
+// a calibration, or without any configs at all, are passed through without
+// copying.
+class CalibrationStage final : public PipelineStage {
+ public:
+  CalibrationStage() = delete;
+  explicit CalibrationStage(std::vector<CalibrationConfig> configs)
+    : mConfigs(std::move(configs)) {
+  }
+
+  template <Handler Next>
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device, Next& next) {
+    std::erase_if(mActive, [id = device.nonPersistentTabletId](auto& it) {
+      return it.mTabletId == id;
+    });
+    if (const auto config = FindConfig(device.GetPersistentId())) {
+      mActive.push_back({
+        device.nonPersistentTabletId,
+        Calibration {config->mTransform, device.maxX, device.maxY},
+      });
+    }
+    next.SetDevice(device);
+  }
+
+  template <Handler Next>
+  void SetState(const OTDIPC::Messages::State& state, Next& next) {
+    const auto calibration = FindCalibration(state.nonPersistentTabletId);
+    if (!calibration) {
+      next.SetState(state);
+      return;
+    }
+    auto copy = state;
+    calibration->Apply(std::span {&copy, 1});
+    next.SetState(copy);
+  }
+
+  template <Handler Next>
+  void SetStates(
+    const std::span<const OTDIPC::Messages::State> states,
+    Next& next) {
+    if (mActive.empty()) {
+      next.SetStates(states);
+      return;
+    }
+
+    // Reused, so that steady-state batches don't allocate
+    mBuffer.assign(states.begin(), states.end());
+    const std::span buffer {mBuffer};
+    // Batches are usually from a single tablet, so this is usually one run
+    for (std::size_t begin = 0; begin < buffer.size();) {
+      const auto tabletId = buffer[begin].nonPersistentTabletId;
+      auto end = begin + 1;
+      while (end < buffer.size()
+             && buffer[end].nonPersistentTabletId == tabletId) {
+        ++end;
+      }
+      if (const auto calibration = FindCalibration(tabletId)) {
+        calibration->Apply(buffer.subspan(begin, end - begin));
+      }
+      begin = end;
+    }
+    next.SetStates(buffer);
+  }
+
+ private:
+  struct Active {
+    uint32_t mTabletId {};
+    Calibration mCalibration;
+  };
+
+  std::vector<CalibrationConfig> mConfigs;
+  std::vector<Active> mActive;
+  std::vector<OTDIPC::Messages::State> mBuffer;
+
+  [[nodiscard]]
+  const CalibrationConfig* FindConfig(
+    const std::string_view persistentId) const {
+    const CalibrationConfig* fallback = nullptr;
+    for (auto&& it: mConfigs) {
+      if (it.mPersistentId == persistentId) {
+        return &it;
+      }
+      if (it.mPersistentId == "*") {
+        fallback = &it;
+      }
+    }
+    return fallback;
+  }
+
+  [[nodiscard]]
+  const Calibration* FindCalibration(const uint32_t tabletId) const {
+    const auto it = std::ranges::find(mActive, tabletId, &Active::mTabletId);
+    return (it == mActive.end()) ? nullptr : &it->mCalibration;
+  }
+};
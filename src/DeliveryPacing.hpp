@@ -0,0 +1,35 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstdint>
+
+#include "ExperimentalMessage.hpp"
+
+// Sent by a client, at any time, to receive at most one state per frame
+// instead of every sample.
+//
+// The server keeps only the latest state for the client, and sends it once
+// per `intervalMicroseconds`; changes to buttons or proximity are still sent
+// immediately. Clients that support `InputFrame` also get the latest
+// prediction, if any, in the same frame.
+//
+// Servers that don't support this ignore it, and keep sending every sample.
+struct DeliveryPacing : ExperimentalHeader {
+  // {C7DCB4CC-624E-4D78-9F06-B29017560B7B}
+  static constexpr ExperimentalGuid GUID {
+    0xc7dcb4cc,
+    0x624e,
+    0x4d78,
+    {0x9f, 0x06, 0xb2, 0x90, 0x17, 0x56, 0x0b, 0x7b},
+  };
+
+  // Zero turns pacing off again
+  uint32_t intervalMicroseconds {};
+  // Optional: when the client next wants a state, on the same clock as
+  // `InputFrameSample::timestamp`. Deliveries are aligned so that they arrive
+  // just before this, and every interval after it; if zero, they're aligned
+  // to when this message was received.
+  uint64_t nextDeadline {};
+};
+static_assert(sizeof(DeliveryPacing) == 40);
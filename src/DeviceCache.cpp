@@ -0,0 +1,133 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "DeviceCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "Log.hpp"
+
+// Entries are compared and stored as raw bytes, so mustn't have padding
+static_assert(std::is_trivially_copyable_v<DeviceCache::Entry>);
+static_assert(
+  sizeof(DeviceCache::Entry)
+  == (8 * sizeof(uint32_t)) + sizeof(OTDIPC::Messages::DeviceInfo));
+
+bool DeviceCache::Entry::operator==(const Entry& other) const {
+  return std::memcmp(this, &other, sizeof(Entry)) == 0;
+}
+
+DeviceCache::DeviceCache(std::filesystem::path path) : mPath(std::move(path)) {
+  std::ifstream file(mPath, std::ios::binary);
+  if (!file) {
+    return;
+  }
+
+  Header header {};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (
+    !file
+    || std::memcmp(header.magic, Header::Magic, sizeof(header.magic)) != 0
+    || header.version != Header::CurrentVersion
+    || header.entrySize != sizeof(Entry)) {
+    Log::Error("Ignoring device cache `{}`: wrong format", mPath.string());
+    return;
+  }
+
+  // There are rarely more than two; don't trust a corrupt count
+  constexpr uint32_t MaxEntries = 64;
+  mEntries.resize(std::min(header.entryCount, MaxEntries));
+  file.read(
+    reinterpret_cast<char*>(mEntries.data()),
+    static_cast<std::streamsize>(mEntries.size() * sizeof(Entry)));
+  if (!file) {
+    Log::Error("Ignoring device cache `{}`: truncated", mPath.string());
+    mEntries.clear();
+  }
+  mSeen.resize(mEntries.size());
+}
+
+std::span<const DeviceCache::Entry> DeviceCache::GetEntries() const {
+  return mEntries;
+}
+
+const DeviceCache::Entry* DeviceCache::Find(
+  const std::string_view persistentId,
+  const uint32_t index) const {
+  const auto it = std::ranges::find_if(mEntries, [=](auto& entry) {
+    return entry.mIndex == index
+      && entry.mInfo.GetPersistentId() == persistentId;
+  });
+  return (it == mEntries.end()) ? nullptr : &*it;
+}
+
+bool DeviceCache::Update(const Entry& entry) {
+  const auto existing = Find(entry.mInfo.GetPersistentId(), entry.mIndex);
+  if (!existing) {
+    mEntries.push_back(entry);
+    mSeen.push_back(true);
+    mDirty = true;
+    return true;
+  }
+
+  const auto index = static_cast<std::size_t>(existing - mEntries.data());
+  mSeen[index] = true;
+  if (*existing == entry) {
+    return false;
+  }
+  mEntries[index] = entry;
+  mDirty = true;
+  return true;
+}
+
+void DeviceCache::RemoveUnseen() {
+  for (std::size_t i = mEntries.size(); i-- > 0;) {
+    if (mSeen[i]) {
+      continue;
+    }
+    mEntries.erase(mEntries.begin() + static_cast<std::ptrdiff_t>(i));
+    mSeen.erase(mSeen.begin() + static_cast<std::ptrdiff_t>(i));
+    mDirty = true;
+  }
+}
+
+void DeviceCache::Save() {
+  if (!mDirty) {
+    return;
+  }
+
+  // Write then rename, so that a crash can't leave a partial file
+  auto temporary = mPath;
+  temporary += ".tmp";
+  std::error_code ec;
+  std::filesystem::create_directories(mPath.parent_path(), ec);
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    Header header {
+      .version = Header::CurrentVersion,
+      .entrySize = sizeof(Entry),
+      .entryCount = static_cast<uint32_t>(mEntries.size()),
+    };
+    std::memcpy(header.magic, Header::Magic, sizeof(header.magic));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(
+      reinterpret_cast<const char*>(mEntries.data()),
+      static_cast<std::streamsize>(mEntries.size() * sizeof(Entry)));
+    if (!file) {
+      Log::Error("Failed to write device cache `{}`", temporary.string());
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporary, mPath, ec);
+  if (ec) {
+    Log::Error(
+      "Failed to replace device cache `{}`: {}",
+      mPath.string(),
+      ec.message());
+    return;
+  }
+  mDirty = false;
+}
@@ -0,0 +1,81 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <OTDIPC/DeviceInfo.hpp>
+
+// What we learned about each WinTab device last time, keyed by persistent ID
+// (usually the PnP ID) and WinTab device index; two tablets of the same model
+// have the same PnP ID.
+//
+// Some drivers are slow or flaky while the system is starting up; with this,
+// clients can be told about each tablet as soon as WinTab reports its ID,
+// and the live values only need checking against it.
+//
+// The file is a `Header` followed by `Header::entryCount` `Entry`s.
+class DeviceCache final {
+ public:
+  struct Header {
+    static constexpr char Magic[8] {'W', 'T', 'D', 'E', 'V', 'C', 'A', 'P'};
+    static constexpr uint32_t CurrentVersion = 1;
+
+    char magic[8] {};
+    uint32_t version {};
+    uint32_t entrySize {};
+    uint32_t entryCount {};
+  };
+
+  enum Quirks : uint32_t {
+    // `IFC_NDEVICES` is zero, but there is a device
+    ReportsNoDevices = 1 << 0,
+    // No `WTI_DDCTXS` default context for this device; we used
+    // `WTI_DEFCONTEXT`
+    NoDeviceContext = 1 << 1,
+  };
+
+  struct Entry {
+    // WinTab's device index
+    uint32_t mIndex {};
+    uint32_t mQuirks {};
+    // Requested packet data for the express keys extension, if any
+    uint32_t mExtensionPacketData {};
+    int32_t mMinX {};
+    int32_t mMaxX {};
+    int32_t mMinY {};
+    int32_t mMaxY {};
+    int32_t mMaxPressure {};
+    OTDIPC::Messages::DeviceInfo mInfo {};
+
+    bool operator==(const Entry&) const;
+  };
+
+  DeviceCache() = delete;
+  // Missing or unreadable files are treated as empty
+  explicit DeviceCache(std::filesystem::path);
+
+  [[nodiscard]]
+  std::span<const Entry> GetEntries() const;
+  [[nodiscard]]
+  const Entry* Find(std::string_view persistentId, uint32_t index) const;
+
+  // Add or replace the entry with the same persistent ID and index; returns
+  // false if nothing changed
+  bool Update(const Entry&);
+  // Forget devices that we haven't seen since the cache was loaded
+  void RemoveUnseen();
+
+  // Only writes the file if anything changed
+  void Save();
+
+ private:
+  std::filesystem::path mPath;
+  std::vector<Entry> mEntries;
+  std::vector<bool> mSeen;
+  bool mDirty {false};
+};
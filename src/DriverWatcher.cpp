@@ -0,0 +1,138 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "DriverWatcher.hpp"
+
+#include <array>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "InjectDll.hpp"
+#include "Log.hpp"
+#include "SharedHookTelemetry.hpp"
+#include "utf8.hpp"
+
+DriverWatcher::DriverWatcher(
+  std::wstring executableFileName,
+  std::filesystem::path dllPath)
+  : mExecutableFileName(std::move(executableFileName)),
+    mName(to_utf8(mExecutableFileName)),
+    mDllPath(std::move(dllPath)) {
+  mStopEvent.reset(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+  THROW_LAST_ERROR_IF_NULL(mStopEvent);
+  mThread = std::jthread([this] { Run(); });
+}
+
+DriverWatcher::~DriverWatcher() {
+  mStopEvent.SetEvent();
+}
+
+bool DriverWatcher::Sleep(const std::chrono::milliseconds duration) {
+  return WaitForSingleObject(
+           mStopEvent.get(), static_cast<DWORD>(duration.count()))
+    == WAIT_TIMEOUT;
+}
+
+void DriverWatcher::Run() {
+  // Used for the handshake; if it's unavailable, we still inject, but can't
+  // confirm that the hooks were installed
+  std::optional<SharedHookTelemetry> telemetry;
+  try {
+    telemetry.emplace();
+  } catch (const std::exception& e) {
+    Log::Error("Failed to open hook telemetry: {}", e.what());
+  }
+
+  bool waiting = false;
+  while (true) {
+    const auto processId = FindProcessByExecutableFileName(mExecutableFileName);
+    if (!processId) {
+      if (!std::exchange(waiting, true)) {
+        Log::Info("Waiting for `{}` to start", mName);
+      }
+      // Process creation isn't waitable without WMI or ETW, but this is a
+      // single snapshot every few seconds
+      if (!Sleep(PollInterval)) {
+        return;
+      }
+      continue;
+    }
+    waiting = false;
+
+    // Opened before injecting, so that we see the exit even if the driver
+    // crashes because of us
+    const wil::unique_process_handle process {
+      OpenProcess(SYNCHRONIZE, FALSE, *processId)};
+    Hijack(*processId, telemetry ? &*telemetry : nullptr);
+
+    if (!process) {
+      // We can't wait for it to exit; keep checking that it's the same one
+      while (FindProcessByExecutableFileName(mExecutableFileName)
+             == processId) {
+        if (!Sleep(PollInterval)) {
+          return;
+        }
+      }
+    } else {
+      const std::array handles {mStopEvent.get(), process.get()};
+      if (
+        WaitForMultipleObjects(
+          static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE)
+        != WAIT_OBJECT_0 + 1) {
+        return;
+      }
+    }
+    Log::Info("`{}` ({}) exited", mName, *processId);
+    if (telemetry) {
+      telemetry->ReleaseExitedProcesses();
+    }
+  }
+}
+
+void DriverWatcher::Hijack(
+  const uint32_t processId,
+  SharedHookTelemetry* const telemetry) {
+  try {
+    InjectDll(
+      processId,
+      mDllPath,
+      std::chrono::duration_cast<std::chrono::milliseconds>(InjectionTimeout));
+    if (telemetry) {
+      WaitForHooks(processId, *telemetry);
+    }
+  } catch (const std::exception& e) {
+    // Retried when the driver restarts
+    Log::Error("Failed to hijack `{}` ({}): {}", mName, processId, e.what());
+  }
+}
+
+void DriverWatcher::WaitForHooks(
+  const uint32_t processId,
+  SharedHookTelemetry& telemetry) {
+  const auto shared = telemetry.Get();
+  if (!shared) {
+    return;
+  }
+
+  constexpr auto Interval = std::chrono::milliseconds(10);
+  for (std::chrono::milliseconds remaining = HandshakeTimeout;
+       remaining.count() > 0;
+       remaining -= Interval) {
+    if (const auto slot = shared->Find(processId)) {
+      switch (slot->hookStatus.load(std::memory_order_acquire)) {
+        case HookTelemetry::HookStatus::Installing:
+          break;
+        case HookTelemetry::HookStatus::Installed:
+          Log::Info("Hooks installed in `{}` ({})", mName, processId);
+          return;
+        case HookTelemetry::HookStatus::Failed:
+          throw std::runtime_error("The DLL failed to install its hooks");
+      }
+    }
+    if (!Sleep(Interval)) {
+      return;
+    }
+  }
+  throw std::runtime_error(
+    "Timed out waiting for the DLL to confirm that its hooks are installed");
+}
@@ -0,0 +1,49 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <wil/resource.h>
+#include <Windows.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+class SharedHookTelemetry;
+
+// Keeps the hijack DLL injected into a driver process, on a background
+// thread.
+//
+// Drivers are restarted on sleep/resume, USB replugs, and so on; whenever the
+// driver process exits, this waits for a new one, and injects into that.
+// Nothing here blocks the caller, including a driver that isn't running yet.
+class DriverWatcher final {
+ public:
+  // How often to look for the driver process, when it isn't running
+  static constexpr auto PollInterval = std::chrono::seconds(2);
+  // How long the driver has to load the DLL, and to install its hooks
+  static constexpr auto InjectionTimeout = std::chrono::seconds(5);
+  static constexpr auto HandshakeTimeout = std::chrono::seconds(5);
+
+  DriverWatcher(std::wstring executableFileName, std::filesystem::path dllPath);
+  ~DriverWatcher();
+
+  DriverWatcher(const DriverWatcher&) = delete;
+  DriverWatcher& operator=(const DriverWatcher&) = delete;
+
+ private:
+  std::wstring mExecutableFileName;
+  std::string mName;
+  std::filesystem::path mDllPath;
+  wil::unique_event mStopEvent;
+  std::jthread mThread;
+
+  void Run();
+  void Hijack(uint32_t processId, SharedHookTelemetry*);
+  void WaitForHooks(uint32_t processId, SharedHookTelemetry&);
+
+  // False if we're stopping
+  bool Sleep(std::chrono::milliseconds);
+};
@@ -0,0 +1,25 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstdint>
+
+#include <OTDIPC/Header.hpp>
+
+// Win32/C# GUID binary layout, as required by `MessageType::Experimental`
+struct ExperimentalGuid {
+  uint32_t data1 {};
+  uint16_t data2 {};
+  uint16_t data3 {};
+  uint8_t data4[8] {};
+
+  constexpr bool operator==(const ExperimentalGuid&) const = default;
+};
+static_assert(sizeof(ExperimentalGuid) == 16);
+
+struct ExperimentalHeader : OTDIPC::Messages::Header {
+  static constexpr auto MESSAGE_TYPE
+    = OTDIPC::Messages::MessageType::Experimental;
+
+  ExperimentalGuid guid {};
+};
@@ -11,27 +11,90 @@ ForegroundOverride::ForegroundOverride()
 
 ForegroundOverride::ForegroundOverride(HWND const window)
   : ForegroundOverride(Disposition::Write) {
-  *mView = window;
+  mRecord->Publish(
+    reinterpret_cast<uintptr_t>(window), GetCurrentProcessId());
+}
+
+ForegroundOverride::~ForegroundOverride() {
+  if (mDisposition == Disposition::Write && mRecord) {
+    mRecord->Publish(0, GetCurrentProcessId());
+  }
+  if (mRecord) {
+    UnmapViewOfFile(mRecord);
+  }
 }
 
 HWND ForegroundOverride::Get() const {
-  const auto lock = mMutex.acquire(nullptr, 0);
-  if (lock) {
-    // We got the mutex, which means the window is gone
+  const auto snapshot = mRecord->TryRead();
+  if (!snapshot) {
+    // Either there's never been a writer, or it's part-way through an update;
+    // in the second case, keep using the previous override until it's done
+    const auto cached = mCachedResult.load(std::memory_order_acquire);
+    return (cached & 1)
+      ? reinterpret_cast<HWND>(mCachedWindow.load(std::memory_order_relaxed))
+      : nullptr;
+  }
+  if (!snapshot->mWindow) {
     return nullptr;
   }
 
-  // We failed to get the mutex, which means it's still owned, and the
-  // override is still in place
-  return IsWindow(*mView) ? *mView : nullptr;
+  // Reads the shared user data page, not a system call
+  const auto now = GetTickCount64();
+  const auto cached = mCachedResult.load(std::memory_order_acquire);
+  if (
+    (cached & ~uint64_t {1}) == snapshot->mGeneration
+    && now < mCacheExpiry.load(std::memory_order_relaxed)) {
+    return (cached & 1) ? reinterpret_cast<HWND>(snapshot->mWindow) : nullptr;
+  }
+  return Revalidate(*snapshot, now);
+}
+
+HWND ForegroundOverride::Revalidate(
+  const ForegroundRecord::Snapshot& snapshot,
+  const uint64_t now) const {
+  const auto window = reinterpret_cast<HWND>(snapshot.mWindow);
+  const auto lock = mRevalidateLock.lock_exclusive();
+
+  // Another thread may have just done this
+  const auto cached = mCachedResult.load(std::memory_order_relaxed);
+  if (
+    (cached & ~uint64_t {1}) == snapshot.mGeneration
+    && now < mCacheExpiry.load(std::memory_order_relaxed)) {
+    return (cached & 1) ? window : nullptr;
+  }
+
+  const bool valid
+    = IsWriterAlive(snapshot.mWriterProcessId) && IsWindow(window);
+  mCachedWindow.store(snapshot.mWindow, std::memory_order_relaxed);
+  mCacheExpiry.store(now + RevalidateInterval, std::memory_order_relaxed);
+  mCachedResult.store(
+    snapshot.mGeneration | (valid ? 1 : 0),
+    std::memory_order_release);
+  return valid ? window : nullptr;
+}
+
+bool ForegroundOverride::IsWriterAlive(const DWORD processId) const {
+  if (processId != mWriterProcessId) {
+    mWriterProcessId = processId;
+    mWriterProcess.reset(OpenProcess(SYNCHRONIZE, FALSE, processId));
+  }
+  if (!mWriterProcess) {
+    // We may not have access to the adapter's process; its window is
+    // destroyed with it though, so `IsWindow()` is enough
+    return true;
+  }
+  return WaitForSingleObject(mWriterProcess.get(), 0) == WAIT_TIMEOUT;
 }
 
-ForegroundOverride::ForegroundOverride(const Disposition d) {
+ForegroundOverride::ForegroundOverride(const Disposition d)
+  : mDisposition(d) {
   const bool readOnly = (d == Disposition::Read);
 
-  mMutex.reset(CreateMutexW(nullptr, FALSE, BuildConfig::MutexName));
-  THROW_LAST_ERROR_IF_NULL(mMutex);
   if (!readOnly) {
+    // Only one adapter can own the override; readers don't need this, as
+    // they use the record's generation instead
+    mMutex.reset(CreateMutexW(nullptr, FALSE, BuildConfig::MutexName));
+    THROW_LAST_ERROR_IF_NULL(mMutex);
     mLock = mMutex.acquire(nullptr, 1000);
     if (!mLock) {
       throw std::runtime_error("Failed to acquire foreground window lock");
@@ -45,14 +108,14 @@ ForegroundOverride::ForegroundOverride(const Disposition d) {
     nullptr,
     PAGE_READWRITE,
     0,
-    sizeof(HWND),
+    sizeof(ForegroundRecord),
     BuildConfig::SHMName));
   THROW_LAST_ERROR_IF_NULL(mMapping);
-  mView = static_cast<HWND*>(MapViewOfFile(
+  mRecord = static_cast<ForegroundRecord*>(MapViewOfFile(
     mMapping.get(),
     readOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS,
     0,
     0,
-    sizeof(HWND)));
-  THROW_LAST_ERROR_IF_NULL(mView);
-}
\ No newline at end of file
+    sizeof(ForegroundRecord)));
+  THROW_LAST_ERROR_IF_NULL(mRecord);
+}
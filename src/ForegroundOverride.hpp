@@ -5,26 +5,58 @@
 #include <wil/resource.h>
 #include <Windows.h>
 
+#include <atomic>
+#include <cstdint>
+
+#include "ForegroundRecord.hpp"
+
 class ForegroundOverride final {
 public:
   // Read-only
   ForegroundOverride();
   // Write-only
   explicit ForegroundOverride(HWND window);
+  ~ForegroundOverride();
 
-  // May return nullptr
+  // May return nullptr.
+  //
+  // Called from hooked functions in driver processes, from any thread; this
+  // doesn't usually make any system calls, as the writer and window are only
+  // rechecked when the record changes, or every `RevalidateInterval`.
   [[nodiscard]]
   HWND Get() const;
 
 private:
+  static constexpr uint64_t RevalidateInterval = 100;// ms
+
   enum class Disposition {
     Read,
     Write
   };
   explicit ForegroundOverride(Disposition);
 
+  [[nodiscard]]
+  HWND Revalidate(const ForegroundRecord::Snapshot&, uint64_t now) const;
+  [[nodiscard]]
+  bool IsWriterAlive(DWORD processId) const;
+
+  Disposition mDisposition;
+  // Writer-only; the record has a single writer
   wil::unique_mutex mMutex;
-  wil::unique_handle mMapping;
   wil::mutex_release_scope_exit mLock;
-  HWND* mView { nullptr };
-};
\ No newline at end of file
+
+  wil::unique_handle mMapping;
+  ForegroundRecord* mRecord { nullptr };
+
+  // Reader-only cache of the last check: `generation | isValid`, as
+  // published generations are always even, and when it expires, in
+  // `GetTickCount64()` milliseconds
+  mutable std::atomic<uint64_t> mCachedResult { 0 };
+  mutable std::atomic<uint64_t> mCacheExpiry { 0 };
+  mutable std::atomic<uint64_t> mCachedWindow { 0 };
+
+  // Reader-only, and only used with `mRevalidateLock` held
+  mutable wil::srwlock mRevalidateLock;
+  mutable wil::unique_process_handle mWriterProcess;
+  mutable DWORD mWriterProcessId { 0 };
+};
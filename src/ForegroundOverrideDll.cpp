@@ -3,10 +3,15 @@
 
 #include <Windows.h>
 #include "ForegroundOverride.hpp"
+#include "SharedHookTelemetry.hpp"
 
 #include <MinHook.h>
+#include <intrin.h>
 #include <concepts>
+#include <filesystem>
 #include <format>
+#include <optional>
+#include <utility>
 
 namespace {
 HWND GetOverride() {
@@ -14,6 +19,49 @@ HWND GetOverride() {
   return override.Get();
 }
 
+std::string GetExecutableName() {
+  wchar_t path[MAX_PATH] {};
+  GetModuleFileNameW(nullptr, path, MAX_PATH);
+  const auto name = std::filesystem::path {path}.filename().wstring();
+  std::string ret(
+    WideCharToMultiByte(
+      CP_UTF8,
+      0,
+      name.data(),
+      static_cast<int>(name.size()),
+      nullptr,
+      0,
+      nullptr,
+      nullptr),
+    '\0');
+  WideCharToMultiByte(
+    CP_UTF8,
+    0,
+    name.data(),
+    static_cast<int>(name.size()),
+    ret.data(),
+    static_cast<int>(ret.size()),
+    nullptr,
+    nullptr);
+  return ret;
+}
+
+// Telemetry, and the handshake with the adapter, are best-effort; the hooks
+// work without them
+std::optional<SharedHookTelemetry> gTelemetry;
+HookTelemetry::Process* gTelemetrySlot {nullptr};
+
+void RecordHookCall(
+  const HookTelemetry::Hook hook,
+  const uint64_t startTicks,
+  const HWND result) {
+  const auto ticks = __rdtsc() - startTicks;
+  if (gTelemetrySlot) {
+    HookTelemetry::Record(
+      gTelemetrySlot->hooks[std::to_underlying(hook)], result != nullptr, ticks);
+  }
+}
+
 template <class... Args>
 void dprint(std::format_string<Args...> fmt, Args&&... args) {
   const auto msg = std::format(fmt, std::forward<Args>(args)...);
@@ -23,7 +71,10 @@ void dprint(std::format_string<Args...> fmt, Args&&... args) {
 
 decltype(&GetForegroundWindow) previous_GetForegroundWindow {nullptr};
 HWND WINAPI hooked_GetForegroundWindow() {
-  if (const auto value = GetOverride()) {
+  const auto start = __rdtsc();
+  const auto value = GetOverride();
+  RecordHookCall(HookTelemetry::Hook::GetForegroundWindow, start, value);
+  if (value) {
     return value;
   }
   return previous_GetForegroundWindow();
@@ -34,7 +85,10 @@ static_assert(std::same_as<
 
 decltype(&WindowFromPoint) previous_WindowFromPoint {nullptr};
 HWND WINAPI hooked_WindowFromPoint(const POINT point) {
-  if (const auto value = GetOverride()) {
+  const auto start = __rdtsc();
+  const auto value = GetOverride();
+  RecordHookCall(HookTelemetry::Hook::WindowFromPoint, start, value);
+  if (value) {
     return value;
   }
   return previous_WindowFromPoint(point);
@@ -42,21 +96,59 @@ HWND WINAPI hooked_WindowFromPoint(const POINT point) {
 static_assert(
   std::same_as<decltype(&WindowFromPoint), decltype(&hooked_WindowFromPoint)>);
 
-void InstallHooks() {
-  MH_Initialize();
-  MH_CreateHook(
-    reinterpret_cast<void*>(&GetForegroundWindow),
-    reinterpret_cast<void*>(&hooked_GetForegroundWindow),
-    reinterpret_cast<void**>(&previous_GetForegroundWindow));
-  MH_CreateHook(
-    reinterpret_cast<void*>(&WindowFromPoint),
-    reinterpret_cast<void*>(&hooked_WindowFromPoint),
-    reinterpret_cast<void**>(&previous_WindowFromPoint));
-  MH_EnableHook(MH_ALL_HOOKS);
+void OpenTelemetry() {
+  try {
+    gTelemetry.emplace();
+  } catch (const std::exception& e) {
+    dprint("Failed to open hook telemetry: {}", e.what());
+    return;
+  }
+  const auto telemetry = gTelemetry->Get();
+  if (!telemetry) {
+    dprint("Hook telemetry has an incompatible layout");
+    return;
+  }
+  gTelemetrySlot = telemetry->Claim(GetCurrentProcessId(), GetExecutableName());
+  if (!gTelemetrySlot) {
+    dprint("No free hook telemetry slots");
+  }
+}
+
+void CloseTelemetry() {
+  if (gTelemetrySlot) {
+    HookTelemetry::Release(*std::exchange(gTelemetrySlot, nullptr));
+  }
+  gTelemetry.reset();
+}
+
+bool InstallHooks() {
+  OpenTelemetry();
+  const bool installed = MH_Initialize() == MH_OK
+    && MH_CreateHook(
+         reinterpret_cast<void*>(&GetForegroundWindow),
+         reinterpret_cast<void*>(&hooked_GetForegroundWindow),
+         reinterpret_cast<void**>(&previous_GetForegroundWindow))
+      == MH_OK
+    && MH_CreateHook(
+         reinterpret_cast<void*>(&WindowFromPoint),
+         reinterpret_cast<void*>(&hooked_WindowFromPoint),
+         reinterpret_cast<void**>(&previous_WindowFromPoint))
+      == MH_OK
+    && MH_EnableHook(MH_ALL_HOOKS) == MH_OK;
+
+  // Tell the adapter, which is waiting for this
+  if (gTelemetrySlot) {
+    gTelemetrySlot->hookStatus.store(
+      installed ? HookTelemetry::HookStatus::Installed
+                : HookTelemetry::HookStatus::Failed,
+      std::memory_order_release);
+  }
+  return installed;
 }
 
 void UninstallHooks() {
   MH_Uninitialize();
+  CloseTelemetry();
 }
 
 }// namespace
@@ -69,8 +161,11 @@ BOOL WINAPI DllMain(
     case DLL_PROCESS_ATTACH:
       dprint("Injecting into process");
       DisableThreadLibraryCalls(instance);
-      InstallHooks();
-      dprint("Added hooks");
+      if (InstallHooks()) {
+        dprint("Added hooks");
+      } else {
+        dprint("Failed to add hooks");
+      }
       break;
     case DLL_PROCESS_DETACH: {
       const auto terminating = static_cast<bool>(lpvReserved);
@@ -0,0 +1,89 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+// The foreground window override, in memory that's shared between the adapter
+// and every driver process that the hijack DLL has been injected into.
+//
+// Drivers call the hooked functions hundreds or thousands of times per second,
+// so reads are a seqlock: no locks, and no system calls. There's a single
+// writer at a time; readers retry if the record changes while they're
+// reading it.
+//
+// This is platform-neutral; liveness of the writer, and of the window, are
+// up to the caller.
+struct ForegroundRecord {
+  static constexpr uint32_t Magic = 0x56524746;// 'FGRV'
+  static constexpr uint32_t Version = 1;
+
+  // Attempts before giving up; the writer only holds the record for a few
+  // stores, but it may have crashed while doing so
+  static constexpr int MaxReadAttempts = 64;
+
+  struct Snapshot {
+    // Changes on every `Publish()`
+    uint64_t mGeneration {};
+    // An `HWND` on Windows; zero for no override
+    uint64_t mWindow {};
+    uint32_t mWriterProcessId {};
+  };
+
+  // Zero until the first `Publish()`
+  std::atomic<uint32_t> magic;
+  std::atomic<uint32_t> version;
+
+  // Odd while the writer is changing the record
+  std::atomic<uint64_t> generation;
+  // Atomic so that racing reads are well-defined; they're discarded if the
+  // generation changes
+  std::atomic<uint64_t> window;
+  std::atomic<uint32_t> writerProcessId;
+
+  // Writer: replace the override; a zero `window` clears it
+  void Publish(const uint64_t newWindow, const uint32_t processId) {
+    // If a previous writer crashed mid-write, the generation is already odd,
+    // and stays odd until we're done
+    const auto begin = generation.load(std::memory_order_relaxed) | 1;
+    generation.store(begin, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    window.store(newWindow, std::memory_order_relaxed);
+    writerProcessId.store(processId, std::memory_order_relaxed);
+    version.store(Version, std::memory_order_relaxed);
+
+    generation.store(begin + 1, std::memory_order_release);
+    magic.store(Magic, std::memory_order_release);
+  }
+
+  // Reader: a consistent copy of the record, or nullopt if it's never been
+  // written, or the writer didn't finish
+  [[nodiscard]]
+  std::optional<Snapshot> TryRead() const {
+    if (
+      magic.load(std::memory_order_acquire) != Magic
+      || version.load(std::memory_order_relaxed) != Version) {
+      return std::nullopt;
+    }
+    for (int i = 0; i < MaxReadAttempts; ++i) {
+      const auto begin = generation.load(std::memory_order_acquire);
+      if (begin & 1) {
+        continue;
+      }
+      const Snapshot ret {
+        .mGeneration = begin,
+        .mWindow = window.load(std::memory_order_relaxed),
+        .mWriterProcessId = writerProcessId.load(std::memory_order_relaxed),
+      };
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (generation.load(std::memory_order_relaxed) == begin) {
+        return ret;
+      }
+    }
+    return std::nullopt;
+  }
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
@@ -0,0 +1,128 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "FrameParser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using OTDIPC::Messages::Header;
+
+FrameParser::FrameParser(
+  const std::span<std::byte> buffer,
+  const OversizedMessages oversizedMessages)
+  : mBuffer(buffer),
+    mOversizedMessages(oversizedMessages) {
+  if (buffer.size() < sizeof(Header)) {
+    throw std::invalid_argument("FrameParser buffer is too small");
+  }
+  if (reinterpret_cast<uintptr_t>(buffer.data()) % Alignment != 0) {
+    throw std::invalid_argument("FrameParser buffer is misaligned");
+  }
+}
+
+std::span<std::byte> FrameParser::GetReceiveSpace() noexcept {
+  if (mBegin != 0) {
+    Compact();
+  }
+  return mBuffer.subspan(mEnd);
+}
+
+void FrameParser::Commit(const std::size_t byteCount) noexcept {
+  mEnd += byteCount;
+}
+
+std::expected<Header*, FrameParser::Error> FrameParser::Next() noexcept {
+  while (true) {
+    if (mSkipRemaining) {
+      const auto skipped
+        = std::min<uint64_t>(mSkipRemaining, mEnd - mBegin);
+      mBegin += static_cast<std::size_t>(skipped);
+      mSkipRemaining -= skipped;
+      if (mSkipRemaining) {
+        mBegin = mEnd = 0;
+        return nullptr;
+      }
+    }
+
+    const auto available = mEnd - mBegin;
+    if (available < sizeof(Header)) {
+      return nullptr;
+    }
+
+    // Each message ends wherever the previous one said; odd-sized messages
+    // like `DebugMessage` leave the next one misaligned
+    if (mBegin % Alignment != 0) {
+      Compact();
+    }
+    const auto header = reinterpret_cast<Header*>(mBuffer.data() + mBegin);
+    if (header->size < sizeof(Header)) {
+      return std::unexpected {Error::InvalidSize};
+    }
+    if (header->size > mBuffer.size()) {
+      if (mOversizedMessages == OversizedMessages::Reject) {
+        return std::unexpected {Error::TooLarge};
+      }
+      ++mSkippedMessageCount;
+      mSkipRemaining = header->size;
+      continue;
+    }
+    if (available < header->size) {
+      return nullptr;
+    }
+
+    mBegin += header->size;
+    return header;
+  }
+}
+
+uint64_t FrameParser::GetSkippedMessageCount() const noexcept {
+  return mSkippedMessageCount;
+}
+
+void FrameParser::Compact() noexcept {
+  const auto available = mEnd - mBegin;
+  if (available) {
+    std::memmove(mBuffer.data(), mBuffer.data() + mBegin, available);
+  }
+  mBegin = 0;
+  mEnd = available;
+}
+
+void ReceiveBufferPool::Deleter::operator()(std::byte* const buffer) const {
+  if (mPool) {
+    mPool->Release(buffer);
+  } else {
+    delete[] buffer;
+  }
+}
+
+ReceiveBufferPool::ReceiveBufferPool(const std::size_t bufferSize)
+  : mBufferSize(bufferSize) {
+  // `Release()` is called from a deleter, so mustn't allocate
+  mFree.reserve(MaxFreeBuffers);
+}
+
+ReceiveBufferPool::~ReceiveBufferPool() = default;
+
+ReceiveBufferPool::Buffer ReceiveBufferPool::Acquire() {
+  const std::unique_lock lock(mMutex);
+  if (mFree.empty()) {
+    return Buffer {new std::byte[mBufferSize], Deleter {this}};
+  }
+  auto ret = std::move(mFree.back());
+  mFree.pop_back();
+  return Buffer {ret.release(), Deleter {this}};
+}
+
+std::size_t ReceiveBufferPool::GetBufferSize() const noexcept {
+  return mBufferSize;
+}
+
+void ReceiveBufferPool::Release(std::byte* const buffer) {
+  std::unique_ptr<std::byte[]> owned {buffer};
+  const std::unique_lock lock(mMutex);
+  if (mFree.size() < MaxFreeBuffers) {
+    mFree.push_back(std::move(owned));
+  }
+}
@@ -0,0 +1,119 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <OTDIPC/Header.hpp>
+
+// Splits a client's byte stream into OTD-IPC messages, without allocating.
+//
+// Bytes are received straight into a fixed-size buffer, as many as fit, and
+// complete messages are handed out in place. The buffer size is the maximum
+// message size; larger messages are either skipped without being stored, or
+// rejected.
+class FrameParser final {
+ public:
+  enum class OversizedMessages {
+    Skip,
+    Reject,
+  };
+
+  enum class Error {
+    // Smaller than a header; we can't tell where the next message starts
+    InvalidSize,
+    // Larger than the buffer, with `OversizedMessages::Reject`
+    TooLarge,
+  };
+
+  // Messages are handed out in place, so must be suitably aligned for any
+  // message struct
+  static constexpr std::size_t Alignment = alignof(uint64_t);
+
+  FrameParser() = delete;
+  // `buffer` must be aligned to `Alignment`, and be at least as large as a
+  // `Header`; it must outlive the parser
+  FrameParser(std::span<std::byte> buffer, OversizedMessages);
+
+  // Where to receive into next; never empty
+  [[nodiscard]]
+  std::span<std::byte> GetReceiveSpace() noexcept;
+  // `byteCount` bytes were written to the start of `GetReceiveSpace()`
+  void Commit(std::size_t byteCount) noexcept;
+
+  // The next complete message, or nullptr if more bytes are needed; the
+  // message is valid until the next call to `GetReceiveSpace()` or `Next()`
+  [[nodiscard]]
+  std::expected<OTDIPC::Messages::Header*, Error> Next() noexcept;
+
+  [[nodiscard]]
+  uint64_t GetSkippedMessageCount() const noexcept;
+
+ private:
+  std::span<std::byte> mBuffer;
+  OversizedMessages mOversizedMessages {};
+
+  // Received but not yet parsed: [mBegin, mEnd)
+  std::size_t mBegin {};
+  std::size_t mEnd {};
+
+  // Bytes of an oversized message that haven't been received yet
+  uint64_t mSkipRemaining {};
+  uint64_t mSkippedMessageCount {};
+
+  // Move unparsed bytes to the start of the buffer
+  void Compact() noexcept;
+};
+
+// Reuses receive buffers between connections, so that clients connecting and
+// disconnecting don't allocate each time
+class ReceiveBufferPool final {
+ public:
+  class Deleter {
+   public:
+    Deleter() = default;
+    explicit Deleter(ReceiveBufferPool* pool) : mPool(pool) {
+    }
+
+    void operator()(std::byte*) const;
+
+   private:
+    ReceiveBufferPool* mPool {};
+  };
+  using Buffer = std::unique_ptr<std::byte[], Deleter>;
+
+  ReceiveBufferPool() = delete;
+  explicit ReceiveBufferPool(std::size_t bufferSize);
+  // Every buffer must have been returned
+  ~ReceiveBufferPool();
+
+  ReceiveBufferPool(const ReceiveBufferPool&) = delete;
+  ReceiveBufferPool(ReceiveBufferPool&&) = delete;
+  ReceiveBufferPool& operator=(const ReceiveBufferPool&) = delete;
+  ReceiveBufferPool& operator=(ReceiveBufferPool&&) = delete;
+
+  // Returned to the pool when destroyed
+  [[nodiscard]]
+  Buffer Acquire();
+
+  [[nodiscard]]
+  std::size_t GetBufferSize() const noexcept;
+
+ private:
+  // There are rarely more clients than this at once
+  static constexpr std::size_t MaxFreeBuffers = 4;
+
+  std::size_t mBufferSize {};
+  // Clients are usually created and destroyed on the reactor thread, but
+  // not always
+  std::mutex mMutex;
+  std::vector<std::unique_ptr<std::byte[]>> mFree;
+
+  void Release(std::byte*);
+};
@@ -0,0 +1,41 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "HookTelemetry.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "Percentiles.hpp"
+
+static_assert(HookTelemetry::CycleBucket(0) == 0);
+static_assert(HookTelemetry::CycleBucket(1) == 0);
+static_assert(HookTelemetry::CycleBucket(2) == 1);
+static_assert(HookTelemetry::CycleBucket(255) == 7);
+static_assert(
+  HookTelemetry::CycleBucket(~uint64_t {0})
+  == HookTelemetry::CycleBucketCount - 1);
+
+HookTelemetry::Summary HookTelemetry::TakeSummary(HookCounters& counters) {
+  Summary ret {
+    .mHits = counters.hits.exchange(0, std::memory_order_relaxed),
+    .mCycles = counters.cycles.exchange(0, std::memory_order_relaxed),
+  };
+
+  std::array<uint64_t, CycleBucketCount> buckets {};
+  for (std::size_t i = 0; i < CycleBucketCount; ++i) {
+    buckets[i]
+      = counters.cycleBuckets[i].exchange(0, std::memory_order_relaxed);
+    ret.mCalls += buckets[i];
+  }
+  // Calls that race with this may be split across two summaries
+  ret.mHits = std::min(ret.mHits, ret.mCalls);
+  ret.mMaxCycles = FindPercentiles(
+    buckets,
+    ret.mCalls,
+    [](const std::size_t i) { return (uint64_t {2} << i) - 1; },
+    {
+      {0.5, &ret.mP50Cycles},
+      {0.99, &ret.mP99Cycles},
+    });
+  return ret;
+}
@@ -0,0 +1,148 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+
+// Call counts and costs of the hooks installed by the hijack DLL, in memory
+// that's shared between the adapter and the driver processes.
+//
+// Each driver process claims a slot, and updates it from its hooks; the
+// adapter takes summaries, which resets the counters, in the style of
+// `LatencyHistogram::TakeSummary()`.
+//
+// The slot is also the DLL's handshake with the adapter: `hookStatus` says
+// whether the hooks were installed.
+//
+// Costs are in timestamp counter ticks, as that's cheap to read in the hooks;
+// converting them to time is up to the reader.
+struct HookTelemetry {
+  static constexpr uint64_t LayoutId = (uint64_t {0x4d544b48} << 32)// 'HKTM'
+    | 2;
+  static constexpr std::size_t MaxProcesses = 8;
+  // Bucket N counts calls that took [2^N, 2^(N+1)) ticks
+  static constexpr std::size_t CycleBucketCount = 32;
+
+  enum class Hook : uint8_t {
+    GetForegroundWindow,
+    WindowFromPoint,
+  };
+  static constexpr std::size_t HookCount = 2;
+
+  enum class HookStatus : uint32_t {
+    Installing,
+    Installed,
+    Failed,
+  };
+
+  struct alignas(64) HookCounters {
+    // Calls that returned the override, rather than the original result
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> cycles;
+    // The total is the number of calls
+    std::atomic<uint64_t> cycleBuckets[CycleBucketCount];
+  };
+
+  struct alignas(64) Process {
+    // Claimed by swapping in the process ID; zero if free
+    std::atomic<uint32_t> claimedBy;
+    // Set to `claimedBy` once the rest of the slot is ready
+    std::atomic<uint32_t> processId;
+    std::atomic<HookStatus> hookStatus;
+    char executableName[52];
+    HookCounters hooks[HookCount];
+  };
+
+  struct Summary {
+    uint64_t mCalls {};
+    uint64_t mHits {};
+    uint64_t mCycles {};
+    // Upper bounds; the buckets are powers of two
+    uint64_t mP50Cycles {};
+    uint64_t mP99Cycles {};
+    uint64_t mMaxCycles {};
+  };
+
+  // Zero in a new mapping; set by the first process that attaches
+  std::atomic<uint64_t> layout;
+  Process processes[MaxProcesses];
+
+  // False if the mapping was created by an incompatible version
+  [[nodiscard]]
+  bool Attach() {
+    uint64_t expected = 0;
+    return layout.compare_exchange_strong(expected, LayoutId)
+      || expected == LayoutId;
+  }
+
+  // Driver process: claim a slot; null if they're all taken
+  [[nodiscard]]
+  Process* Claim(const uint32_t processId, const std::string_view name) {
+    for (auto&& process: processes) {
+      uint32_t expected = 0;
+      if (!process.claimedBy.compare_exchange_strong(expected, processId)) {
+        continue;
+      }
+      for (auto&& hook: process.hooks) {
+        std::ignore = TakeSummary(hook);
+      }
+      process.hookStatus.store(
+        HookStatus::Installing, std::memory_order_relaxed);
+      std::ranges::fill(process.executableName, '\0');
+      std::ranges::copy_n(
+        name.begin(),
+        std::min(name.size(), sizeof(process.executableName) - 1),
+        process.executableName);
+      process.processId.store(processId, std::memory_order_release);
+      return &process;
+    }
+    return nullptr;
+  }
+
+  // Adapter: the slot for a process, if it has one
+  [[nodiscard]]
+  Process* Find(const uint32_t processId) {
+    for (auto&& process: processes) {
+      if (process.processId.load(std::memory_order_acquire) == processId) {
+        return &process;
+      }
+    }
+    return nullptr;
+  }
+
+  // Either side: free a slot, when its process exits
+  static void Release(Process& process) {
+    process.processId.store(0, std::memory_order_relaxed);
+    process.claimedBy.store(0, std::memory_order_release);
+  }
+
+  // Driver process: any thread, from inside a hook
+  static void Record(
+    HookCounters& counters,
+    const bool hit,
+    const uint64_t cycles) noexcept {
+    if (hit) {
+      counters.hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    counters.cycles.fetch_add(cycles, std::memory_order_relaxed);
+    counters.cycleBuckets[CycleBucket(cycles)].fetch_add(
+      1, std::memory_order_relaxed);
+  }
+
+  // Adapter: everything recorded since the previous call, and reset
+  [[nodiscard]]
+  static Summary TakeSummary(HookCounters&);
+
+  static constexpr std::size_t CycleBucket(const uint64_t cycles) {
+    return std::min<std::size_t>(
+      std::bit_width(cycles | 1) - 1, CycleBucketCount - 1);
+  }
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<HookTelemetry::HookStatus>::is_always_lock_free);
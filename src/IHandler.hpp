@@ -2,6 +2,9 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <algorithm>
+#include <span>
+
 #include <OTDIPC/DeviceInfo.hpp>
 #include <OTDIPC/State.hpp>
 
@@ -10,4 +13,19 @@ struct IHandler {
 
   virtual void SetDevice(const OTDIPC::Messages::DeviceInfo& device) = 0;
   virtual void SetState(const OTDIPC::Messages::State& state) = 0;
-};
\ No newline at end of file
+
+  // Several states that were received together, oldest first.
+  //
+  // Handlers that can send a batch more cheaply than individual states should
+  // override this.
+  virtual void SetStates(std::span<const OTDIPC::Messages::State> states) {
+    for (auto&& state: states) {
+      SetState(state);
+    }
+  }
+
+  // Called once per message pump iteration; handlers that stage their output
+  // should send it now.
+  virtual void Flush() {
+  }
+};
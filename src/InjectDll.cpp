@@ -10,11 +10,16 @@
 #include <ntstatus.h>
 #include <wil/resource.h>
 
-#include <print>
+#include <format>
+
+#include "Log.hpp"
 
 namespace fs = std::filesystem;
 
-void InjectDll(const uint32_t processId, const std::filesystem::path& dllPath) {
+void InjectDll(
+  const uint32_t processId,
+  const std::filesystem::path& dllPath,
+  const std::chrono::milliseconds timeout) {
   THROW_HR_IF(E_INVALIDARG, !fs::exists(dllPath));
   const std::wstring dllName = dllPath.filename().wstring();
   const std::wstring fullPath = fs::absolute(dllPath).wstring();
@@ -37,7 +42,7 @@ void InjectDll(const uint32_t processId, const std::filesystem::path& dllPath) {
       wchar_t szModName[MAX_PATH];
       if (GetModuleBaseNameW(process.get(), modules[i], szModName, MAX_PATH)) {
         if (_wcsicmp(szModName, dllName.c_str()) == 0) {
-          std::println(
+          Log::Info(
             "DLL already loaded in process {}, skipping hijack", processId);
           return;
         }
@@ -50,7 +55,7 @@ void InjectDll(const uint32_t processId, const std::filesystem::path& dllPath) {
     process.get(), nullptr, pathSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
   THROW_LAST_ERROR_IF_NULL(remoteMemory);
 
-  const auto freeRemoteMemory = wil::scope_exit(
+  auto freeRemoteMemory = wil::scope_exit(
     [&] { VirtualFreeEx(process.get(), remoteMemory, 0, MEM_RELEASE); });
 
   // 5. Write the path to the allocated memory
@@ -73,11 +78,20 @@ void InjectDll(const uint32_t processId, const std::filesystem::path& dllPath) {
   THROW_LAST_ERROR_IF_NULL(remoteThread);
 
   // Wait for LoadLibraryW to finish
-  WaitForSingleObject(remoteThread.get(), INFINITE);
+  if (
+    WaitForSingleObject(remoteThread.get(), static_cast<DWORD>(timeout.count()))
+    != WAIT_OBJECT_0) {
+    // It may still read the path, so we can't free it
+    freeRemoteMemory.release();
+    throw std::runtime_error(std::format(
+      "Timed out waiting for process {} to load {}",
+      processId,
+      dllPath.filename().string()));
+  }
   DWORD exitCode {};
   GetExitCodeThread(remoteThread.get(), &exitCode);
 
-  std::println(
+  Log::Info(
     "Injected {} into process {}", dllPath.filename().string(), processId);
 }
 
@@ -90,9 +104,8 @@ SYSTEM_PROCESS_INFORMATION* next(SYSTEM_PROCESS_INFORMATION* it) {
     reinterpret_cast<uintptr_t>(it) + it->NextEntryOffset);
 }
 
-void InjectDllByExecutableFileName(
-  std::wstring_view executableFileName,
-  const std::filesystem::path& dllPath) {
+std::optional<uint32_t> FindProcessByExecutableFileName(
+  std::wstring_view executableFileName) {
   std::string processInfoBuffer(
     sizeof(SYSTEM_PROCESS_INFORMATION) * 1024, '\0');
   ULONG infoByteCount {static_cast<ULONG>(processInfoBuffer.size())};
@@ -116,11 +129,8 @@ void InjectDllByExecutableFileName(
     }
     const std::wstring_view name { ntName.Buffer, ntName.Length / sizeof(wchar_t) };
     if (name == executableFileName) {
-      const auto pid = static_cast<DWORD>(std::bit_cast<uintptr_t>(process->UniqueProcessId));
-      InjectDll(pid, dllPath);
-      return;
+      return static_cast<uint32_t>(std::bit_cast<uintptr_t>(process->UniqueProcessId));
     }
   }
-
-  throw std::runtime_error("Could not find target driver process to inject");
+  return std::nullopt;
 }
\ No newline at end of file
@@ -2,10 +2,19 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
+#include <string_view>
 
-void InjectDll(uint32_t processID, const std::filesystem::path& dllPath);
+// Throws if `LoadLibraryW()` hasn't returned in the target process within
+// `timeout`
+void InjectDll(
+  uint32_t processID,
+  const std::filesystem::path& dllPath,
+  std::chrono::milliseconds timeout);
 
-void InjectDllByExecutableFileName(
-  std::wstring_view executableFileName,
-  const std::filesystem::path& dllPath);
\ No newline at end of file
+[[nodiscard]]
+std::optional<uint32_t> FindProcessByExecutableFileName(
+  std::wstring_view executableFileName);
\ No newline at end of file
@@ -0,0 +1,59 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "InputFrame.hpp"
+
+#include <cstring>
+
+InputFrameSample ToInputFrameSample(
+  const OTDIPC::Messages::State& state,
+  const uint64_t timestamp) {
+  return {
+    .timestamp = timestamp,
+    .validBits = state.validBits & ~PredictedStateBit,
+    .x = state.x,
+    .y = state.y,
+    .pressure = state.pressure,
+    .penButtons = state.penButtons,
+    .auxButtons = state.auxButtons,
+    .hoverDistance = state.hoverDistance,
+    .penIsNearSurface = state.penIsNearSurface,
+    .flags = static_cast<uint8_t>(
+      IsPredicted(state) ? InputFrameSample::Predicted : 0),
+  };
+}
+
+void AppendInputFrame(
+  SendBuffer& buffer,
+  const uint32_t tabletId,
+  const std::span<const InputFrameSample> samples) {
+  InputFrame frame {};
+  frame.messageType = InputFrame::MESSAGE_TYPE;
+  frame.size
+    = static_cast<uint32_t>(sizeof(InputFrame) + samples.size_bytes());
+  frame.nonPersistentTabletId = tabletId;
+  frame.guid = InputFrame::GUID;
+  frame.sampleCount = static_cast<uint32_t>(samples.size());
+  frame.sampleSize = sizeof(InputFrameSample);
+
+  buffer.Append(frame);
+  buffer.Append(samples.data(), samples.size_bytes());
+}
+
+bool HelloAdvertises(
+  const OTDIPC::Messages::Hello& hello,
+  const ExperimentalGuid& guid) {
+  if (hello.header.size <= sizeof(hello)) {
+    return false;
+  }
+  const auto count
+    = (hello.header.size - sizeof(hello)) / sizeof(ExperimentalGuid);
+  const auto guids = reinterpret_cast<const std::byte*>(&hello + 1);
+  for (std::size_t i = 0; i < count; ++i) {
+    ExperimentalGuid it {};
+    std::memcpy(&it, guids + (i * sizeof(it)), sizeof(it));
+    if (it == guid) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,90 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <OTDIPC/Hello.hpp>
+#include <OTDIPC/State.hpp>
+#include "ExperimentalMessage.hpp"
+#include "SendBuffer.hpp"
+
+// Several samples in a single `MessageType::Experimental` message, oldest
+// first, similar to historical samples in Android's MotionEvent.
+//
+// Clients opt in by appending the GUIDs of the experimental messages they
+// support to their `Hello`; a `Hello` with `header.size > sizeof(Hello)` is
+// followed by `(header.size - sizeof(Hello)) / 16` GUIDs. Clients that don't
+// opt in get individual `State` messages.
+struct InputFrameSample {
+  enum Flags : uint8_t {
+    // Extrapolated by `PenPredictor`, rather than reported by the tablet; it
+    // should be replaced by the next real sample. The timestamp is when the
+    // prediction was made, not the time it's for.
+    Predicted = 1 << 0,
+  };
+
+  // Microseconds, from an arbitrary per-process epoch
+  uint64_t timestamp {};
+
+  OTDIPC::Messages::State::ValidMask validBits {};
+  float x {};
+  float y {};
+  uint32_t pressure {};
+  uint32_t penButtons {};
+  uint32_t auxButtons {};
+  uint32_t hoverDistance {};
+  uint8_t penIsNearSurface {};
+  uint8_t flags {};
+  uint8_t reserved[2] {};
+};
+static_assert(sizeof(InputFrameSample) == 40);
+
+struct InputFrame : ExperimentalHeader {
+  // {5F1B6F5E-3A2C-4C8E-9D41-7B2E0A6C9F13}
+  static constexpr ExperimentalGuid GUID {
+    0x5f1b6f5e,
+    0x3a2c,
+    0x4c8e,
+    {0x9d, 0x41, 0x7b, 0x2e, 0x0a, 0x6c, 0x9f, 0x13},
+  };
+
+  uint32_t sampleCount {};
+  // `sizeof(InputFrameSample)`; samples may grow in future versions
+  uint32_t sampleSize {};
+  uint32_t reserved {};
+
+  // Followed by `sampleCount` samples of `sampleSize` bytes each
+};
+static_assert(sizeof(InputFrame) == 40);
+static_assert(sizeof(InputFrame) % alignof(InputFrameSample) == 0);
+
+// Set in `State::validBits` by `PenPredictor`. This is never sent in a
+// `State` message: clients that don't support `InputFrame` can't tell
+// predictions apart from real samples, so they don't get them at all.
+inline constexpr auto PredictedStateBit
+  = static_cast<OTDIPC::Messages::State::ValidMask>(1u << 31);
+
+[[nodiscard]]
+constexpr bool IsPredicted(const OTDIPC::Messages::State& state) {
+  return (state.validBits & PredictedStateBit) == PredictedStateBit;
+}
+
+// Moves `PredictedStateBit` to `InputFrameSample::flags`
+[[nodiscard]]
+InputFrameSample ToInputFrameSample(
+  const OTDIPC::Messages::State& state,
+  uint64_t timestamp);
+
+// Append a complete InputFrame message containing `samples`
+void AppendInputFrame(
+  SendBuffer& buffer,
+  uint32_t tabletId,
+  std::span<const InputFrameSample> samples);
+
+// Whether the GUID list after a client's `Hello` includes `guid`
+[[nodiscard]]
+bool HelloAdvertises(
+  const OTDIPC::Messages::Hello& hello,
+  const ExperimentalGuid& guid);
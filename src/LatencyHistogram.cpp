@@ -0,0 +1,63 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "LatencyHistogram.hpp"
+
+#include <utility>
+
+#include "Percentiles.hpp"
+
+static_assert(
+  LatencyHistogram::BucketIndex(
+    LatencyHistogram::BucketUpperBound(LatencyHistogram::BucketCount - 1))
+  == LatencyHistogram::BucketCount - 1);
+static_assert(
+  LatencyHistogram::BucketIndex(LatencyHistogram::BucketUpperBound(100) + 1)
+  == 101);
+
+LatencyHistogram::Summary LatencyHistogram::TakeSummary() {
+  std::array<uint64_t, BucketCount> counts {};
+  Summary ret {};
+  for (std::size_t i = 0; i < BucketCount; ++i) {
+    counts[i] = mCounts[i].exchange(0, std::memory_order_relaxed);
+    ret.mCount += counts[i];
+  }
+
+  ret.mMax = FindPercentiles(
+    counts,
+    ret.mCount,
+    [](const std::size_t i) {
+      return std::chrono::nanoseconds(
+        static_cast<int64_t>(BucketUpperBound(i)));
+    },
+    {
+      {0.5, &ret.mP50},
+      {0.99, &ret.mP99},
+      {0.999, &ret.mP999},
+    });
+  return ret;
+}
+
+LatencyHistogram& GetLatencyHistogram(const LatencyStage stage) {
+  static std::array<
+    LatencyHistogram,
+    std::to_underlying(LatencyStage::EndToEnd) + 1>
+    histograms;
+  return histograms.at(std::to_underlying(stage));
+}
+
+namespace {
+thread_local LatencyHistogram::Clock::time_point gArrivalTime {};
+}// namespace
+
+LatencyHistogram::Clock::time_point GetArrivalTime() noexcept {
+  return gArrivalTime;
+}
+
+ScopedArrivalTime::ScopedArrivalTime(
+  const LatencyHistogram::Clock::time_point arrivedAt) noexcept
+  : mPrevious(std::exchange(gArrivalTime, arrivedAt)) {
+}
+
+ScopedArrivalTime::~ScopedArrivalTime() {
+  gArrivalTime = mPrevious;
+}
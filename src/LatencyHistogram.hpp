@@ -0,0 +1,111 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear histogram of durations, in the style of HdrHistogram.
+//
+// Values are in nanoseconds, with each power of two split into 32 linear
+// sub-buckets, so reported values are within ~3% of the recorded ones.
+// `Record()` is a single relaxed atomic increment, so it can be called from
+// any thread without locks.
+class LatencyHistogram final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr unsigned SubBucketBits = 5;
+  // Values of 2^41ns (~37 minutes) or more are counted in the last bucket
+  static constexpr unsigned MaxShift = 35;
+  static constexpr std::size_t BucketCount = (MaxShift + 2) << SubBucketBits;
+
+  struct Summary {
+    uint64_t mCount {};
+    std::chrono::nanoseconds mP50 {};
+    std::chrono::nanoseconds mP99 {};
+    std::chrono::nanoseconds mP999 {};
+    std::chrono::nanoseconds mMax {};
+  };
+
+  void Record(const std::chrono::nanoseconds value) noexcept {
+    const auto count = value.count();
+    mCounts[BucketIndex(count > 0 ? static_cast<uint64_t>(count) : 0)]
+      .fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Summarize everything recorded since the previous call, and reset.
+  //
+  // Values recorded concurrently are included in either this summary or the
+  // next one, but never lost.
+  [[nodiscard]]
+  Summary TakeSummary();
+
+  static constexpr std::size_t BucketIndex(const uint64_t value) {
+    if (value < (2u << SubBucketBits)) {
+      return static_cast<std::size_t>(value);
+    }
+    const auto shift = static_cast<unsigned>(std::bit_width(value))
+      - (SubBucketBits + 1);
+    if (shift > MaxShift) {
+      return BucketCount - 1;
+    }
+    return (static_cast<std::size_t>(shift) << SubBucketBits)
+      + static_cast<std::size_t>(value >> shift);
+  }
+
+  // The highest value that is counted in the bucket
+  static constexpr uint64_t BucketUpperBound(const std::size_t index) {
+    if (index < (2u << SubBucketBits)) {
+      return index;
+    }
+    const auto shift = (index >> SubBucketBits) - 1;
+    const auto mantissa = index - (shift << SubBucketBits);
+    return ((static_cast<uint64_t>(mantissa) + 1) << shift) - 1;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, BucketCount> mCounts {};
+};
+
+enum class LatencyStage {
+  // `WintabTablet::ProcessMessage()` entry to decoded `State`
+  Decode,
+  // Queued by `V1Server::SetState()` to written to the pipe
+  V1Send,
+  // Queued by `V2Server::SetState()` to written to client sockets
+  V2Send,
+  // `WintabTablet::ProcessMessage()` entry to written by a server, including
+  // every pipeline stage and the queue; recorded by each server that sends
+  // the state
+  EndToEnd,
+};
+
+// Process-wide histogram for the given stage
+LatencyHistogram& GetLatencyHistogram(LatencyStage);
+
+// When the WinTab message whose states are being handled on this thread
+// arrived, or a default-constructed time point if there isn't one, e.g. while
+// replaying a trace.
+//
+// Handlers are called synchronously, so this lets the servers measure
+// `EndToEnd` without passing a timestamp through every pipeline stage.
+[[nodiscard]]
+LatencyHistogram::Clock::time_point GetArrivalTime() noexcept;
+
+// Sets `GetArrivalTime()` for this thread until destroyed
+class ScopedArrivalTime final {
+ public:
+  explicit ScopedArrivalTime(LatencyHistogram::Clock::time_point) noexcept;
+  ~ScopedArrivalTime();
+
+  ScopedArrivalTime(const ScopedArrivalTime&) = delete;
+  ScopedArrivalTime& operator=(const ScopedArrivalTime&) = delete;
+
+ private:
+  LatencyHistogram::Clock::time_point mPrevious;
+};
@@ -0,0 +1,210 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "Log.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+// Per-format-string rate limiting; format strings are literals, so they're
+// keyed by address
+struct Site {
+  std::atomic<const char*> mFormat {nullptr};
+  std::atomic<int64_t> mWindowStart {};
+  std::atomic<uint32_t> mCount {};
+  std::atomic<uint32_t> mSuppressed {};
+};
+// There are fewer log calls than this in the whole program; if it's full,
+// further messages aren't limited
+constexpr std::size_t MaxSites = 128;
+std::array<Site, MaxSites> gSites;
+
+Log::Ring gRing;
+std::atomic<bool> gIsAsync {false};
+std::atomic<uint64_t> gDropped {};
+
+// Only set by producers if it wasn't already, so that a burst of messages
+// only notifies once
+std::atomic<bool> gPending {false};
+std::mutex gWakeMutex;
+std::condition_variable_any gWake;
+
+int64_t NowMilliseconds() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+Site* FindSite(const std::string_view format) {
+  const auto key = format.data();
+  const auto hash = std::hash<const void*> {}(key);
+  for (std::size_t i = 0; i < MaxSites; ++i) {
+    auto& site = gSites[(hash + i) % MaxSites];
+    auto existing = site.mFormat.load(std::memory_order_acquire);
+    if (
+      !existing
+      && site.mFormat.compare_exchange_strong(
+        existing, key, std::memory_order_acq_rel)) {
+      return &site;
+    }
+    if (existing == key) {
+      return &site;
+    }
+  }
+  return nullptr;
+}
+
+FILE* GetStream(const Log::Level level) {
+  return (level == Log::Level::Error) ? stderr : stdout;
+}
+
+void Print(const Log::Level level, const std::string_view line) {
+  std::fwrite(line.data(), 1, line.size(), GetStream(level));
+}
+
+void FormatLine(const Log::Record& record, std::string& line) {
+  line.clear();
+  try {
+    record.mFormatter(record, line);
+  } catch (const std::format_error& e) {
+    line = std::format("Failed to format `{}`: {}", record.mFormat, e.what());
+  }
+  line += '\n';
+}
+
+// Reports messages that were rate-limited or dropped since the last call
+void ReportLosses(std::string& line) {
+  for (auto&& site: gSites) {
+    const auto format = site.mFormat.load(std::memory_order_acquire);
+    if (!format || site.mSuppressed.load(std::memory_order_relaxed) == 0) {
+      continue;
+    }
+    const auto suppressed
+      = site.mSuppressed.exchange(0, std::memory_order_relaxed);
+    line.clear();
+    std::format_to(
+      std::back_inserter(line),
+      "Suppressed {} more messages like `{}`\n",
+      suppressed,
+      format);
+    Print(Log::Level::Error, line);
+  }
+
+  if (const auto dropped = gDropped.exchange(0, std::memory_order_relaxed)) {
+    line = std::format("Log buffer full; dropped {} messages\n", dropped);
+    Print(Log::Level::Error, line);
+  }
+}
+
+}// namespace
+
+namespace Log::Detail {
+
+bool Admit(const std::string_view format) {
+  const auto site = FindSite(format);
+  if (!site) {
+    return true;
+  }
+
+  const auto now = NowMilliseconds();
+  const auto window
+    = std::chrono::duration_cast<std::chrono::milliseconds>(Window).count();
+  auto start = site->mWindowStart.load(std::memory_order_relaxed);
+  if (
+    now - start >= window
+    && site->mWindowStart.compare_exchange_strong(
+      start, now, std::memory_order_relaxed)) {
+    site->mCount.store(0, std::memory_order_relaxed);
+  }
+  if (site->mCount.fetch_add(1, std::memory_order_relaxed) < Burst) {
+    return true;
+  }
+  site->mSuppressed.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool IsAsync() {
+  return gIsAsync.load(std::memory_order_acquire);
+}
+
+Ring& GetRing() {
+  return gRing;
+}
+
+void Submitted(const bool queued) {
+  if (!queued) {
+    gDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // A notification can be missed if it races with the flusher going to
+  // sleep; that only delays the message until the flusher's next timeout
+  if (!gPending.exchange(true, std::memory_order_acq_rel)) {
+    gWake.notify_one();
+  }
+}
+
+void WriteNow(const Record& record) {
+  std::string line;
+  FormatLine(record, line);
+  Print(record.mLevel, line);
+  std::fflush(GetStream(record.mLevel));
+}
+
+}// namespace Log::Detail
+
+namespace Log {
+
+Flusher::Flusher() {
+  if (gIsAsync.exchange(true, std::memory_order_acq_rel)) {
+    throw std::logic_error("There can only be one Log::Flusher");
+  }
+  mThread = std::jthread([this](const std::stop_token st) { Run(st); });
+}
+
+Flusher::~Flusher() {
+  // Anything logged after this is written immediately; the final drain picks
+  // up anything already queued
+  gIsAsync.store(false, std::memory_order_release);
+  mThread.request_stop();
+  mThread.join();
+}
+
+void Flusher::Run(const std::stop_token st) {
+  while (true) {
+    {
+      std::unique_lock lock(gWakeMutex);
+      gWake.wait_for(lock, st, Window, [] {
+        return gPending.load(std::memory_order_acquire);
+      });
+    }
+    const auto stopping = st.stop_requested();
+    gPending.store(false, std::memory_order_release);
+    Drain(stopping);
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void Flusher::Drain(const bool final) {
+  gRing.ConsumeAll([this](const Record& record) {
+    FormatLine(record, mLine);
+    Print(record.mLevel, mLine);
+  });
+  // At most once per window, so that a flood is one line per window
+  const auto now = std::chrono::steady_clock::now();
+  if (final || now - mLastLossReport >= Window) {
+    mLastLossReport = now;
+    ReportLosses(mLine);
+  }
+  // One write per stream per drain, rather than one per message
+  std::fflush(stdout);
+  std::fflush(stderr);
+}
+
+}// namespace Log
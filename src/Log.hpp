@@ -0,0 +1,230 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "MpscRing.hpp"
+
+// Console logging that doesn't block the caller on the console.
+//
+// `Log::Info()` and `Log::Error()` take the same arguments as
+// `std::println()`, but only copy the arguments into a fixed-size record in
+// a lock-free ring; a `Log::Flusher` thread formats and writes them. Strings
+// are copied, and truncated if the record is full; anything else must be
+// trivially copyable.
+//
+// Each format string is rate-limited to `Log::Burst` messages per
+// `Log::Window`; the flusher reports how many were suppressed.
+//
+// Without a running `Flusher`, messages are written immediately, as
+// `std::println()` would.
+namespace Log {
+
+enum class Level : uint8_t {
+  Info,// stdout
+  Error,// stderr
+};
+
+constexpr uint32_t Burst = 20;
+constexpr auto Window = std::chrono::seconds(1);
+
+// A log call, with its arguments encoded but not yet formatted
+struct Record {
+  static constexpr std::size_t PayloadCapacity = 448;
+
+  void (*mFormatter)(const Record&, std::string& out) {nullptr};
+  std::string_view mFormat;
+  Level mLevel {};
+  std::array<std::byte, PayloadCapacity> mPayload {};
+};
+
+using Ring = MpscRing<Record, 256>;
+
+// Formats and writes records from the ring until destroyed; there must only
+// be one at a time
+class Flusher final {
+ public:
+  Flusher();
+  ~Flusher();
+
+  Flusher(const Flusher&) = delete;
+  Flusher(Flusher&&) = delete;
+  Flusher& operator=(const Flusher&) = delete;
+  Flusher& operator=(Flusher&&) = delete;
+
+ private:
+  std::string mLine;
+  std::chrono::steady_clock::time_point mLastLossReport {};
+  std::jthread mThread;
+
+  void Run(std::stop_token);
+  // Writes everything that's ready
+  void Drain(bool final);
+};
+
+namespace Detail {
+
+template <class T>
+concept StringLike = std::convertible_to<const T&, std::string_view>;
+
+// What each argument is stored as, and decoded to
+template <class T>
+using Stored = std::conditional_t<
+  StringLike<std::remove_cvref_t<T>>,
+  std::string_view,
+  std::remove_cvref_t<T>>;
+
+template <class T>
+concept Storable = std::same_as<T, std::string_view>
+  || (std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>);
+
+// Strings are a 16-bit length, then the bytes; everything else is its bytes
+template <class T>
+constexpr std::size_t FixedSize
+  = std::same_as<T, std::string_view> ? sizeof(uint16_t) : sizeof(T);
+
+class Encoder final {
+ public:
+  Encoder(Record& record, const std::size_t fixedSize)
+    : mIt(record.mPayload.data()),
+      mEnd(record.mPayload.data() + record.mPayload.size()),
+      mReserved(fixedSize) {
+  }
+
+  template <class T>
+  void Encode(const T& value) {
+    mReserved -= FixedSize<T>;
+    if constexpr (std::same_as<T, std::string_view>) {
+      // Leave room for the arguments after this one
+      const auto available = static_cast<std::size_t>(mEnd - mIt) - mReserved
+        - sizeof(uint16_t);
+      const auto size
+        = static_cast<uint16_t>(std::min(value.size(), available));
+      Write(&size, sizeof(size));
+      Write(value.data(), size);
+    } else {
+      Write(&value, sizeof(value));
+    }
+  }
+
+ private:
+  std::byte* mIt {};
+  std::byte* mEnd {};
+  std::size_t mReserved {};
+
+  void Write(const void* data, const std::size_t size) {
+    std::memcpy(mIt, data, size);
+    mIt += size;
+  }
+};
+
+class Decoder final {
+ public:
+  explicit Decoder(const Record& record) : mIt(record.mPayload.data()) {
+  }
+
+  template <class T>
+  T Decode() {
+    if constexpr (std::same_as<T, std::string_view>) {
+      const auto size = Decode<uint16_t>();
+      const std::string_view ret {
+        reinterpret_cast<const char*>(mIt), size};
+      mIt += size;
+      return ret;
+    } else {
+      std::array<std::byte, sizeof(T)> bytes;
+      std::memcpy(bytes.data(), mIt, sizeof(T));
+      mIt += sizeof(T);
+      return std::bit_cast<T>(bytes);
+    }
+  }
+
+ private:
+  const std::byte* mIt {};
+};
+
+template <class... Args>
+void Format(const Record& record, std::string& out) {
+  Decoder decoder(record);
+  // Braced initialization is evaluated left-to-right
+  std::tuple<Args...> decoded {decoder.Decode<Args>()...};
+  std::apply(
+    [&](auto&... args) {
+      std::vformat_to(
+        std::back_inserter(out),
+        record.mFormat,
+        std::make_format_args(args...));
+    },
+    decoded);
+}
+
+// False if this format string has been logged too often recently
+bool Admit(std::string_view format);
+// False if there's no running `Flusher`
+bool IsAsync();
+Ring& GetRing();
+// Wakes the flusher, or counts the record as dropped if it wasn't queued
+void Submitted(bool queued);
+void WriteNow(const Record&);
+
+template <class... Args>
+void Write(
+  const Level level,
+  const std::string_view format,
+  const Stored<Args>&... args) {
+  static_assert(
+    (Storable<Stored<Args>> && ...),
+    "Log arguments must be strings or trivially copyable");
+  constexpr auto fixedSize = (std::size_t {} + ... + FixedSize<Stored<Args>>);
+  static_assert(fixedSize <= Record::PayloadCapacity);
+
+  if (!Admit(format)) {
+    return;
+  }
+
+  const auto fill = [&](Record& record) {
+    record.mFormatter = &Format<Stored<Args>...>;
+    record.mFormat = format;
+    record.mLevel = level;
+    Encoder encoder(record, fixedSize);
+    (encoder.Encode<Stored<Args>>(args), ...);
+  };
+
+  if (IsAsync()) {
+    Submitted(GetRing().TryPush(fill));
+    return;
+  }
+  Record record;
+  fill(record);
+  WriteNow(record);
+}
+
+}// namespace Detail
+
+template <class... Args>
+void Info(std::format_string<Args...> format, Args&&... args) {
+  Detail::Write<Args...>(Level::Info, format.get(), args...);
+}
+
+template <class... Args>
+void Error(std::format_string<Args...> format, Args&&... args) {
+  Detail::Write<Args...>(Level::Error, format.get(), args...);
+}
+
+}// namespace Log
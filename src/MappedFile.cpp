@@ -0,0 +1,104 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "MappedFile.hpp"
+
+#include <system_error>
+
+#ifdef _WIN32
+// clang-format off
+#include <Windows.h>
+#include <wil/resource.h>
+// clang-format on
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+struct MappedFile::Platform {
+  wil::unique_hfile mFile;
+  wil::unique_handle mMapping;
+  wil::unique_mapview_ptr<const std::byte> mView;
+
+  explicit Platform(const std::filesystem::path& path) {
+    mFile.reset(CreateFileW(
+      path.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr));
+    THROW_LAST_ERROR_IF(!mFile);
+  }
+
+  std::span<const std::byte> Map() {
+    LARGE_INTEGER size {};
+    THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(mFile.get(), &size));
+    if (size.QuadPart == 0) {
+      // Mapping an empty file fails
+      return {};
+    }
+
+    mMapping.reset(
+      CreateFileMappingW(mFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    THROW_LAST_ERROR_IF_NULL(mMapping);
+    mView.reset(static_cast<const std::byte*>(
+      MapViewOfFile(mMapping.get(), FILE_MAP_READ, 0, 0, 0)));
+    THROW_LAST_ERROR_IF_NULL(mView);
+    return {mView.get(), static_cast<std::size_t>(size.QuadPart)};
+  }
+};
+#else
+struct MappedFile::Platform {
+  int mFile {-1};
+  void* mView {MAP_FAILED};
+  std::size_t mSize {};
+
+  explicit Platform(const std::filesystem::path& path) {
+    mFile = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (mFile == -1) {
+      throw std::system_error(errno, std::generic_category(), "open");
+    }
+  }
+
+  ~Platform() {
+    if (mView != MAP_FAILED) {
+      munmap(mView, mSize);
+    }
+    close(mFile);
+  }
+
+  std::span<const std::byte> Map() {
+    struct stat info {};
+    if (fstat(mFile, &info) == -1) {
+      throw std::system_error(errno, std::generic_category(), "fstat");
+    }
+    mSize = static_cast<std::size_t>(info.st_size);
+    if (mSize == 0) {
+      // Mapping an empty file fails
+      return {};
+    }
+
+    mView = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+    if (mView == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    madvise(mView, mSize, MADV_SEQUENTIAL);
+    return {static_cast<const std::byte*>(mView), mSize};
+  }
+};
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+  : mPlatform(std::make_unique<Platform>(path)) {
+  mBytes = mPlatform->Map();
+}
+
+MappedFile::~MappedFile() = default;
+
+std::span<const std::byte> MappedFile::GetBytes() const {
+  return mBytes;
+}
@@ -0,0 +1,27 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+// A read-only memory mapping of an entire file
+class MappedFile final {
+ public:
+  MappedFile() = delete;
+  explicit MappedFile(const std::filesystem::path&);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]]
+  std::span<const std::byte> GetBytes() const;
+
+ private:
+  struct Platform;
+  std::unique_ptr<Platform> mPlatform;
+  std::span<const std::byte> mBytes;
+};
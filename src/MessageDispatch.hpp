@@ -0,0 +1,197 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+
+#include <OTDIPC/Header.hpp>
+#include "ExperimentalMessage.hpp"
+
+// Anything with a `MESSAGE_TYPE`; `Hello` has a `Header` member rather than
+// deriving from it
+template <class T>
+concept DispatchableMessage = requires {
+  { T::MESSAGE_TYPE } -> std::convertible_to<OTDIPC::Messages::MessageType>;
+};
+
+// Routes received messages to typed handlers, using tables built at compile
+// time.
+//
+// Messages are looked up by `MessageType`, then experimental messages are
+// looked up by GUID; both are constant-time. Each route records the minimum
+// size of its message, so handlers are only ever called with a complete
+// struct. Routes are checked when the table is built, so a duplicate type or
+// GUID fails to compile.
+//
+// Handlers are called as `std::invoke(handler, self, args..., message)`, so
+// may be member functions of `Self`.
+template <class Self, class... Args>
+class MessageDispatcher final {
+ public:
+  using Header = OTDIPC::Messages::Header;
+  using MessageType = OTDIPC::Messages::MessageType;
+
+  enum class Result {
+    Handled,
+    // No route for the `MessageType`
+    UnknownType,
+    // No route for an experimental message's GUID
+    UnknownExperimental,
+    // Smaller than the route's message struct
+    TooSmall,
+  };
+
+  class Route {
+   public:
+    // `MinSize` is for variable-length messages whose struct includes
+    // the first element, like `DebugMessage`
+    template <
+      DispatchableMessage T,
+      auto Handler,
+      std::size_t MinSize = sizeof(T)>
+    static consteval Route For() {
+      static_assert(MinSize >= sizeof(Header));
+      Route ret;
+      ret.mType = T::MESSAGE_TYPE;
+      ret.mMinSize = MinSize;
+      ret.mThunk = [](Self& self, Args... args, Header& header) {
+        std::invoke(
+          Handler,
+          self,
+          std::forward<Args>(args)...,
+          *reinterpret_cast<T*>(&header));
+      };
+      if constexpr (std::derived_from<T, ExperimentalHeader>) {
+        static_assert(
+          requires { T::GUID; }, "Experimental messages must have a GUID");
+        static_assert(MinSize >= sizeof(ExperimentalHeader));
+        ret.mGuid = T::GUID;
+      }
+      return ret;
+    }
+
+   private:
+    friend class MessageDispatcher;
+    using Thunk = void (*)(Self&, Args..., Header&);
+
+    MessageType mType {};
+    ExperimentalGuid mGuid {};
+    std::size_t mMinSize {};
+    Thunk mThunk {};
+  };
+
+  consteval MessageDispatcher(const std::initializer_list<Route> routes) {
+    for (const auto& route: routes) {
+      if (route.mType == MessageType::Experimental) {
+        AddExperimental(route);
+        continue;
+      }
+      const auto index = static_cast<std::size_t>(route.mType);
+      if (index >= mByType.size()) {
+        throw std::logic_error("Message type is out of range");
+      }
+      if (mByType[index].mThunk) {
+        throw std::logic_error("Message type is already routed");
+      }
+      mByType[index] = route;
+    }
+  }
+
+  Result operator()(Self& self, Args... args, Header& header) const {
+    const auto index = static_cast<std::size_t>(header.messageType);
+    if (index >= mByType.size()) {
+      return Result::UnknownType;
+    }
+
+    const Route* route = &mByType[index];
+    if (header.messageType == MessageType::Experimental) {
+      if (header.size < sizeof(ExperimentalHeader)) {
+        return Result::TooSmall;
+      }
+      route = FindExperimental(reinterpret_cast<ExperimentalHeader&>(header));
+      if (!route) {
+        return Result::UnknownExperimental;
+      }
+    } else if (!route->mThunk) {
+      return Result::UnknownType;
+    }
+
+    if (header.size < route->mMinSize) {
+      return Result::TooSmall;
+    }
+    route->mThunk(self, std::forward<Args>(args)..., header);
+    return Result::Handled;
+  }
+
+ private:
+  // OTD-IPC currently has 6 message types; newer ones are `UnknownType`
+  // until they're added
+  static constexpr std::size_t TypeCount = 16;
+  // Open addressing, so this must be a power of two, and larger than the
+  // number of experimental routes
+  static constexpr std::size_t ExperimentalCapacity = 16;
+  static_assert(std::has_single_bit(ExperimentalCapacity));
+
+  std::array<Route, TypeCount> mByType {};
+  std::array<Route, ExperimentalCapacity> mExperimental {};
+  // The longest probe sequence of any route, so that unknown GUIDs don't
+  // scan the whole table
+  std::size_t mMaxProbes {};
+
+  static constexpr std::size_t Hash(const ExperimentalGuid& guid) {
+    // GUIDs are usually random, but sequential ones only differ in a few
+    // bits, so fold in all of it; the top bits of the product are the best
+    // mixed
+    constexpr uint32_t K = 0x9e3779b1;
+    constexpr auto Pack = [](const uint8_t* const it) {
+      return static_cast<uint32_t>(it[0]) | (static_cast<uint32_t>(it[1]) << 8)
+        | (static_cast<uint32_t>(it[2]) << 16)
+        | (static_cast<uint32_t>(it[3]) << 24);
+    };
+    // Rotated so that differences in the same bits of each word don't
+    // cancel out
+    const auto hash = guid.data1
+      ^ std::rotl((static_cast<uint32_t>(guid.data2) << 16) | guid.data3, 8)
+      ^ std::rotl(Pack(guid.data4), 16) ^ std::rotl(Pack(guid.data4 + 4), 24);
+    return (hash * K) >> (32 - std::countr_zero(ExperimentalCapacity));
+  }
+
+  consteval void AddExperimental(const Route& route) {
+    const auto start = Hash(route.mGuid);
+    for (std::size_t probe = 0; probe < ExperimentalCapacity; ++probe) {
+      auto& slot = mExperimental[(start + probe) % ExperimentalCapacity];
+      if (!slot.mThunk) {
+        slot = route;
+        mMaxProbes = std::max(mMaxProbes, probe + 1);
+        return;
+      }
+      if (slot.mGuid == route.mGuid) {
+        throw std::logic_error("Experimental GUID is already routed");
+      }
+    }
+    throw std::logic_error("Too many experimental routes");
+  }
+
+  const Route* FindExperimental(const ExperimentalHeader& header) const {
+    const auto start = Hash(header.guid);
+    for (std::size_t probe = 0; probe < mMaxProbes; ++probe) {
+      const auto& slot = mExperimental[(start + probe) % ExperimentalCapacity];
+      if (!slot.mThunk) {
+        return nullptr;
+      }
+      if (slot.mGuid == header.guid) {
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+};
@@ -0,0 +1,105 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+
+// Bounded lock-free queue for any number of producer threads, and exactly one
+// consumer thread.
+//
+// Each slot has a sequence number, so producers only contend on the tail
+// index, and a slot that's still being written stops the consumer without
+// blocking anyone. As with `SpscRing`, neither side ever blocks; producers get
+// `false` back if the ring is full.
+template <class T, std::size_t Capacity>
+  requires(std::has_single_bit(Capacity) && std::is_trivially_copyable_v<T>)
+class MpscRing final {
+ public:
+  MpscRing() {
+    for (std::size_t i = 0; i < Capacity; ++i) {
+      mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscRing(const MpscRing&) = delete;
+  MpscRing(MpscRing&&) = delete;
+  MpscRing& operator=(const MpscRing&) = delete;
+  MpscRing& operator=(MpscRing&&) = delete;
+
+  // Any thread; `fill` writes the item in place, as items are usually large
+  template <std::invocable<T&> F>
+  [[nodiscard]]
+  bool TryPush(F&& fill) {
+    auto tail = mTail.load(std::memory_order_relaxed);
+    while (true) {
+      auto& slot = mSlots[tail & Mask];
+      const auto sequence = slot.mSequence.load(std::memory_order_acquire);
+      const auto delta = static_cast<std::ptrdiff_t>(sequence - tail);
+      if (delta < 0) {
+        // Not yet consumed since the last lap
+        return false;
+      }
+      if (delta > 0) {
+        // Another producer claimed it
+        tail = mTail.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (mTail.compare_exchange_weak(
+            tail, tail + 1, std::memory_order_relaxed)) {
+        fill(slot.mValue);
+        slot.mSequence.store(tail + 1, std::memory_order_release);
+        return true;
+      }
+    }
+  }
+
+  [[nodiscard]]
+  bool TryPush(const T& value) {
+    return TryPush([&value](T& slot) { slot = value; });
+  }
+
+  // Consumer only; invokes `f` on everything that is ready, in order, and
+  // stops at the first slot that a producer is still writing.
+  //
+  // Returns the number of items consumed.
+  template <std::invocable<const T&> F>
+  std::size_t ConsumeAll(F&& f) {
+    const auto head = mHead;
+    while (true) {
+      auto& slot = mSlots[mHead & Mask];
+      if (slot.mSequence.load(std::memory_order_acquire) != mHead + 1) {
+        break;
+      }
+      f(slot.mValue);
+      slot.mSequence.store(mHead + Capacity, std::memory_order_release);
+      ++mHead;
+    }
+    return mHead - head;
+  }
+
+  static constexpr std::size_t capacity() noexcept {
+    return Capacity;
+  }
+
+ private:
+  static constexpr std::size_t Mask = Capacity - 1;
+  static constexpr std::size_t CacheLineSize = 64;
+
+  // Producers writing neighboring slots shouldn't share a cache line
+  struct alignas(CacheLineSize) Slot {
+    std::atomic<std::size_t> mSequence {};
+    T mValue {};
+  };
+
+  // Written by producers
+  alignas(CacheLineSize) std::atomic<std::size_t> mTail {0};
+  // Only used by the consumer
+  alignas(CacheLineSize) std::size_t mHead {0};
+
+  std::array<Slot, Capacity> mSlots {};
+};
@@ -0,0 +1,47 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <initializer_list>
+#include <span>
+#include <vector>
+
+#include "IHandler.hpp"
+
+// Forwards everything to each of several handlers, in order
+class MultiHandler final : public IHandler {
+ public:
+  MultiHandler() = delete;
+  ~MultiHandler() override = default;
+
+  MultiHandler(std::initializer_list<IHandler*> handlers) : mNext {handlers} {
+  }
+
+  void push_back(IHandler* handler) {
+    mNext.push_back(handler);
+  }
+
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override {
+    for (auto&& handler: mNext) {
+      handler->SetDevice(device);
+    }
+  }
+  void SetState(const OTDIPC::Messages::State& state) override {
+    for (auto&& handler: mNext) {
+      handler->SetState(state);
+    }
+  }
+  void SetStates(std::span<const OTDIPC::Messages::State> states) override {
+    for (auto&& handler: mNext) {
+      handler->SetStates(states);
+    }
+  }
+  void Flush() override {
+    for (auto&& handler: mNext) {
+      handler->Flush();
+    }
+  }
+
+ private:
+  std::vector<IHandler*> mNext;
+};
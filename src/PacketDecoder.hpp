@@ -0,0 +1,119 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <OTDIPC/State.hpp>
+
+// Platform-neutral half of WinTab packet handling.
+//
+// This deliberately doesn't include WINTAB.H, so that it can be used (and
+// benchmarked) against recorded packet arrays on other platforms; anything
+// with the same member names as WinTab's `PACKET` works.
+namespace PacketBits {
+// Values of WinTab's `PK_*` macros; WintabTablet.cpp static_asserts that these
+// match
+constexpr uint32_t Changed = 0x0008;
+constexpr uint32_t Buttons = 0x0040;
+constexpr uint32_t X = 0x0080;
+constexpr uint32_t Y = 0x0100;
+constexpr uint32_t Z = 0x0200;
+constexpr uint32_t NormalPressure = 0x0400;
+}// namespace PacketBits
+
+template <class T>
+concept PenPacket = requires(const T& packet) {
+  packet.pkChanged;
+  packet.pkButtons;
+  packet.pkX;
+  packet.pkY;
+  packet.pkZ;
+  packet.pkNormalPressure;
+};
+
+// Merge a single packet into `state`
+template <PenPacket T>
+void ApplyPacket(
+  const T& packet,
+  const float maxY,
+  OTDIPC::Messages::State& state) {
+  using Bits = OTDIPC::Messages::State::ValidMask;
+
+  const auto changed = static_cast<uint32_t>(packet.pkChanged);
+  if (changed & PacketBits::X) {
+    state.x = static_cast<float>(packet.pkX);
+    state.validBits |= Bits::PositionX;
+  }
+  if (changed & PacketBits::Y) {
+    state.y = maxY - static_cast<float>(packet.pkY);
+    state.validBits |= Bits::PositionY;
+  }
+  if (changed & PacketBits::Z) {
+    state.hoverDistance = static_cast<uint32_t>(packet.pkZ);
+    state.validBits |= Bits::HoverDistance;
+  }
+  if (changed & PacketBits::NormalPressure) {
+    state.pressure = static_cast<uint32_t>(packet.pkNormalPressure);
+    state.validBits |= Bits::Pressure;
+  }
+  if (changed & PacketBits::Buttons) {
+    state.penButtons = static_cast<uint32_t>(packet.pkButtons);
+    state.validBits |= Bits::PenButtons;
+  }
+}
+
+// Merge a `WT_PROXIMITY` context enter/leave into `state`
+inline void ApplyProximity(
+  const bool isNearSurface,
+  OTDIPC::Messages::State& state) {
+  state.penIsNearSurface = isNearSurface;
+  state.validBits |= OTDIPC::Messages::State::ValidMask::PenIsNearSurface;
+}
+
+// WinTab's `nControl` is a byte, but only the first 16 express keys are
+// tracked in `State::auxButtons`, as they always have been
+constexpr uint8_t MaxExpressKeys = 16;
+
+// Merge an express key event into `state`; returns false without changing
+// `state` if `control` isn't below `MaxExpressKeys`
+inline bool ApplyExpressKey(
+  const uint8_t control,
+  const bool pressed,
+  OTDIPC::Messages::State& state) {
+  using Bits = OTDIPC::Messages::State::ValidMask;
+
+  if (control >= MaxExpressKeys) {
+    return false;
+  }
+  const auto mask = static_cast<uint32_t>(1u << control);
+  if (pressed) {
+    state.auxButtons |= mask;
+  } else {
+    state.auxButtons &= ~mask;
+  }
+  state.validBits |= Bits::AuxButtons;
+  return true;
+}
+
+// Apply every packet in order, writing a snapshot of the accumulated state
+// after each one to `out`.
+//
+// Returns the number of snapshots written, which is limited by the size of
+// `out`.
+template <PenPacket T>
+std::size_t DecodePackets(
+  const std::span<const T> packets,
+  const float maxY,
+  OTDIPC::Messages::State& state,
+  const std::span<OTDIPC::Messages::State> out) {
+  const auto count = std::min(packets.size(), out.size());
+  for (std::size_t i = 0; i < count; ++i) {
+    ApplyPacket(packets[i], maxY, state);
+    out[i] = state;
+  }
+  return count;
+}
@@ -0,0 +1,333 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "PacketTrace.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using Kind = PacketTraceEvent::Kind;
+
+// Write to disk in chunks of roughly this size
+constexpr std::size_t WriteChunkSize = 64 * 1024;
+
+constexpr uint8_t KindMask = 0b11;
+constexpr unsigned DeviceShift = 2;
+static_assert(PacketTraceEvent::MaxDevices == (0xff >> DeviceShift) + 1);
+
+// `pkChanged` bits with a delta-encoded value, in encoding order
+constexpr std::array DeltaFields {
+  PacketBits::Buttons,
+  PacketBits::X,
+  PacketBits::Y,
+  PacketBits::Z,
+  PacketBits::NormalPressure,
+};
+
+uint64_t ZigZag(const int64_t value) {
+  return (static_cast<uint64_t>(value) << 1)
+    ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(const uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+int64_t GetFieldValue(const TracedPacket& packet, const uint32_t bit) {
+  switch (bit) {
+    case PacketBits::Buttons:
+      return packet.pkButtons;
+    case PacketBits::X:
+      return packet.pkX;
+    case PacketBits::Y:
+      return packet.pkY;
+    case PacketBits::Z:
+      return packet.pkZ;
+    case PacketBits::NormalPressure:
+      return packet.pkNormalPressure;
+    default:
+      std::unreachable();
+  }
+}
+
+void SetFieldValue(TracedPacket& packet, const uint32_t bit, int64_t value) {
+  switch (bit) {
+    case PacketBits::Buttons:
+      packet.pkButtons = static_cast<uint32_t>(value);
+      return;
+    case PacketBits::X:
+      packet.pkX = static_cast<int32_t>(value);
+      return;
+    case PacketBits::Y:
+      packet.pkY = static_cast<int32_t>(value);
+      return;
+    case PacketBits::Z:
+      packet.pkZ = static_cast<int32_t>(value);
+      return;
+    case PacketBits::NormalPressure:
+      packet.pkNormalPressure = static_cast<uint32_t>(value);
+      return;
+    default:
+      std::unreachable();
+  }
+}
+
+}// namespace
+
+OTDIPC::Messages::DeviceInfo PacketTraceEvent::GetDevice() const {
+  OTDIPC::Messages::DeviceInfo ret {};
+  std::memcpy(&ret, mDeviceBytes.data(), sizeof(ret));
+  return ret;
+}
+
+PacketTraceWriter::PacketTraceWriter(const std::filesystem::path& path)
+  : mFile(path, std::ios::binary | std::ios::trunc),
+    mStart(std::chrono::steady_clock::now()) {
+  if (!mFile) {
+    throw std::runtime_error("Failed to open packet trace for writing");
+  }
+  mPending.reserve(WriteChunkSize + sizeof(OTDIPC::Messages::DeviceInfo) + 64);
+
+  PacketTraceHeader header {
+    .version = PacketTraceHeader::CurrentVersion,
+    .headerSize = sizeof(PacketTraceHeader),
+  };
+  std::memcpy(header.magic, PacketTraceHeader::Magic, sizeof(header.magic));
+  WriteBytes(&header, sizeof(header));
+}
+
+PacketTraceWriter::~PacketTraceWriter() {
+  mFile.write(
+    reinterpret_cast<const char*>(mPending.data()),
+    static_cast<std::streamsize>(mPending.size()));
+}
+
+void PacketTraceWriter::WriteDevice(
+  const OTDIPC::Messages::DeviceInfo& info,
+  const uint8_t device) {
+  BeginRecord(Kind::Device, device);
+  WriteBytes(&info, sizeof(info));
+}
+
+void PacketTraceWriter::WritePacket(
+  const TracedPacket& packet,
+  const uint8_t device) {
+  BeginRecord(Kind::Packet, device);
+  auto& last = mLastPackets[device];
+  WriteVarint(packet.pkChanged);
+  for (const auto bit: DeltaFields) {
+    if (!(packet.pkChanged & bit)) {
+      continue;
+    }
+    const auto value = GetFieldValue(packet, bit);
+    WriteVarint(ZigZag(value - GetFieldValue(last, bit)));
+    SetFieldValue(last, bit, value);
+  }
+}
+
+void PacketTraceWriter::WriteExpressKey(
+  const uint8_t control,
+  const bool pressed,
+  const uint8_t device) {
+  BeginRecord(Kind::ExpressKey, device);
+  const std::array bytes {
+    static_cast<std::byte>(control),
+    static_cast<std::byte>(pressed),
+  };
+  WriteBytes(bytes.data(), bytes.size());
+}
+
+void PacketTraceWriter::WriteProximity(
+  const bool isNearSurface,
+  const uint8_t device) {
+  BeginRecord(Kind::Proximity, device);
+  WriteVarint(isNearSurface);
+}
+
+void PacketTraceWriter::BeginRecord(const Kind kind, const uint8_t device) {
+  if (device >= PacketTraceEvent::MaxDevices) {
+    throw std::out_of_range("Too many devices for a packet trace");
+  }
+  if (mPending.size() >= WriteChunkSize) {
+    mFile.write(
+      reinterpret_cast<const char*>(mPending.data()),
+      static_cast<std::streamsize>(mPending.size()));
+    mPending.clear();
+  }
+
+  const auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - mStart);
+  mPending.push_back(static_cast<std::byte>(
+    std::to_underlying(kind) | (device << DeviceShift)));
+  WriteVarint(static_cast<uint64_t>((now - mLastTime).count()));
+  mLastTime = now;
+}
+
+void PacketTraceWriter::WriteVarint(uint64_t value) {
+  while (value >= 0x80) {
+    mPending.push_back(static_cast<std::byte>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  mPending.push_back(static_cast<std::byte>(value));
+}
+
+void PacketTraceWriter::WriteBytes(const void* data, const std::size_t size) {
+  const auto bytes = static_cast<const std::byte*>(data);
+  mPending.insert(mPending.end(), bytes, bytes + size);
+}
+
+PacketTraceReader::PacketTraceReader(const std::span<const std::byte> trace)
+  : mRemaining(trace) {
+  PacketTraceHeader header {};
+  if (trace.size() < sizeof(header)) {
+    throw std::runtime_error("Packet trace is truncated");
+  }
+  std::memcpy(&header, trace.data(), sizeof(header));
+  if (
+    std::memcmp(header.magic, PacketTraceHeader::Magic, sizeof(header.magic))
+    != 0) {
+    throw std::runtime_error("Not a packet trace");
+  }
+  // Version 2 only added device indices, which are always 0 in version 1
+  if (
+    header.version < 1 || header.version > PacketTraceHeader::CurrentVersion) {
+    throw std::runtime_error("Unsupported packet trace version");
+  }
+  if (header.headerSize < sizeof(header) || header.headerSize > trace.size()) {
+    throw std::runtime_error("Packet trace header is invalid");
+  }
+  mRemaining = trace.subspan(header.headerSize);
+}
+
+std::optional<PacketTraceEvent> PacketTraceReader::Next() {
+  if (mRemaining.empty()) {
+    return std::nullopt;
+  }
+
+  const auto tag = ReadByte();
+  PacketTraceEvent ret {
+    .mKind = static_cast<Kind>(tag & KindMask),
+    .mDevice = static_cast<uint8_t>(tag >> DeviceShift),
+  };
+  mLastTime += std::chrono::microseconds(ReadVarint());
+  ret.mTime = mLastTime;
+
+  switch (ret.mKind) {
+    case Kind::Device:
+      if (mRemaining.size() < sizeof(OTDIPC::Messages::DeviceInfo)) {
+        throw std::runtime_error("Packet trace is truncated");
+      }
+      ret.mDeviceBytes
+        = mRemaining.first(sizeof(OTDIPC::Messages::DeviceInfo));
+      mRemaining = mRemaining.subspan(ret.mDeviceBytes.size());
+      break;
+    case Kind::Packet: {
+      auto& last = mLastPackets[ret.mDevice];
+      const auto changed = static_cast<uint32_t>(ReadVarint());
+      for (const auto bit: DeltaFields) {
+        if (!(changed & bit)) {
+          continue;
+        }
+        const auto delta = UnZigZag(ReadVarint());
+        SetFieldValue(last, bit, GetFieldValue(last, bit) + delta);
+      }
+      last.pkChanged = changed;
+      ret.mPacket = last;
+      break;
+    }
+    case Kind::ExpressKey:
+      ret.mControl = ReadByte();
+      if (ret.mControl >= MaxExpressKeys) {
+        throw std::runtime_error(
+          "Packet trace contains an invalid express key");
+      }
+      ret.mPressed = ReadByte() != 0;
+      break;
+    case Kind::Proximity:
+      ret.mIsNearSurface = ReadVarint() != 0;
+      break;
+  }
+  return ret;
+}
+
+uint8_t PacketTraceReader::ReadByte() {
+  if (mRemaining.empty()) {
+    throw std::runtime_error("Packet trace is truncated");
+  }
+  const auto ret = std::to_integer<uint8_t>(mRemaining.front());
+  mRemaining = mRemaining.subspan(1);
+  return ret;
+}
+
+uint64_t PacketTraceReader::ReadVarint() {
+  uint64_t ret = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    const auto byte = ReadByte();
+    ret |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return ret;
+    }
+  }
+  throw std::runtime_error("Packet trace contains an invalid varint");
+}
+
+std::size_t ReplayPacketTrace(
+  const std::stop_token st,
+  const std::span<const std::byte> trace,
+  IHandler& handler,
+  const double speed) {
+  PacketTraceReader reader(trace);
+  // Each device has its own state, as `WintabTablet` does
+  struct Device {
+    OTDIPC::Messages::State mState {};
+    float mMaxY {};
+  };
+  std::array<Device, PacketTraceEvent::MaxDevices> devices {};
+  std::size_t count {};
+
+  const auto start = std::chrono::steady_clock::now();
+  std::optional<std::chrono::microseconds> pumpTime;
+  while (const auto event = reader.Next()) {
+    if (pumpTime && event->mTime != *pumpTime) {
+      handler.Flush();
+      if (st.stop_requested()) {
+        break;
+      }
+      if (speed > 0) {
+        std::this_thread::sleep_until(
+          start
+          + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            event->mTime / speed));
+      }
+    }
+    pumpTime = event->mTime;
+    ++count;
+
+    auto& [state, maxY] = devices[event->mDevice];
+    switch (event->mKind) {
+      case Kind::Device: {
+        const auto device = event->GetDevice();
+        maxY = device.maxY;
+        state.nonPersistentTabletId = device.nonPersistentTabletId;
+        handler.SetDevice(device);
+        continue;
+      }
+      case Kind::Packet:
+        ApplyPacket(event->mPacket, maxY, state);
+        break;
+      case Kind::ExpressKey:
+        ApplyExpressKey(event->mControl, event->mPressed, state);
+        break;
+      case Kind::Proximity:
+        ApplyProximity(event->mIsNearSurface, state);
+        break;
+    }
+    handler.SetState(state);
+  }
+  handler.Flush();
+  return count;
+}
@@ -0,0 +1,156 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <vector>
+
+#include <OTDIPC/DeviceInfo.hpp>
+#include "IHandler.hpp"
+#include "PacketDecoder.hpp"
+
+// Compact recordings of raw WinTab input, for reproducing driver-specific
+// bugs and load-testing the servers without a tablet.
+//
+// A trace is a `PacketTraceHeader`, followed by records of:
+// - a tag byte; the low 2 bits are the `PacketTraceEvent::Kind`, and the
+//   rest are the index of the device it's from (always 0 in version 1)
+// - microseconds since the previous record, as a varint
+// - the payload:
+//   - `Device`: the raw `DeviceInfo`
+//   - `Packet`: `pkChanged` as a varint, then for each of the buttons, X, Y,
+//     Z, and pressure bits that are set, the zigzag-encoded difference from
+//     the previous value of that field for the same device, as a varint
+//   - `ExpressKey`: the control number and pressed state, one byte each
+//   - `Proximity`: the `WT_PROXIMITY` context enter/leave flag, as a varint
+//
+// Traces are decoded in place, so a memory-mapped trace can be replayed
+// without copying it.
+struct PacketTraceHeader {
+  static constexpr char Magic[8] {'W', 'T', 'P', 'K', 'T', 'R', 'C', '\0'};
+  static constexpr uint32_t CurrentVersion = 2;
+
+  char magic[8] {};
+  uint32_t version {};
+  uint32_t headerSize {};
+};
+
+// The fields of WinTab's `PACKET` that the adapter requests
+struct TracedPacket {
+  uint32_t pkChanged {};
+  uint32_t pkButtons {};
+  int32_t pkX {};
+  int32_t pkY {};
+  int32_t pkZ {};
+  uint32_t pkNormalPressure {};
+};
+static_assert(PenPacket<TracedPacket>);
+
+struct PacketTraceEvent {
+  enum class Kind : uint8_t {
+    Device = 0,
+    Packet = 1,
+    ExpressKey = 2,
+    Proximity = 3,
+  };
+
+  // Device indices are assigned by whoever writes the trace; `WintabTablet`
+  // uses the WinTab device index
+  static constexpr std::size_t MaxDevices = 64;
+
+  Kind mKind {};
+  uint8_t mDevice {};
+  // Since the start of the trace
+  std::chrono::microseconds mTime {};
+
+  // Only the members for `mKind` are meaningful
+
+  // Points into the trace, as `DeviceInfo` is much larger than everything
+  // else; use `GetDevice()`
+  std::span<const std::byte> mDeviceBytes;
+  TracedPacket mPacket {};
+  uint8_t mControl {};
+  bool mPressed {};
+  bool mIsNearSurface {};
+
+  [[nodiscard]]
+  OTDIPC::Messages::DeviceInfo GetDevice() const;
+};
+
+class PacketTraceWriter final {
+ public:
+  PacketTraceWriter() = delete;
+  explicit PacketTraceWriter(const std::filesystem::path&);
+  ~PacketTraceWriter();
+
+  // `device` must be less than `PacketTraceEvent::MaxDevices`
+  void WriteDevice(const OTDIPC::Messages::DeviceInfo&, uint8_t device = 0);
+  template <PenPacket T>
+  void WritePacket(const T& packet, const uint8_t device = 0) {
+    WritePacket(
+      TracedPacket {
+        .pkChanged = static_cast<uint32_t>(packet.pkChanged),
+        .pkButtons = static_cast<uint32_t>(packet.pkButtons),
+        .pkX = static_cast<int32_t>(packet.pkX),
+        .pkY = static_cast<int32_t>(packet.pkY),
+        .pkZ = static_cast<int32_t>(packet.pkZ),
+        .pkNormalPressure = static_cast<uint32_t>(packet.pkNormalPressure),
+      },
+      device);
+  }
+  void WritePacket(const TracedPacket&, uint8_t device = 0);
+  void WriteExpressKey(uint8_t control, bool pressed, uint8_t device = 0);
+  void WriteProximity(bool isNearSurface, uint8_t device = 0);
+
+ private:
+  void BeginRecord(PacketTraceEvent::Kind, uint8_t device);
+  void WriteVarint(uint64_t);
+  void WriteBytes(const void*, std::size_t);
+
+  std::ofstream mFile;
+  std::vector<std::byte> mPending;
+  std::chrono::steady_clock::time_point mStart;
+  std::chrono::microseconds mLastTime {};
+  std::array<TracedPacket, PacketTraceEvent::MaxDevices> mLastPackets {};
+};
+
+// Decodes a trace in place; `trace` must outlive the reader
+class PacketTraceReader final {
+ public:
+  PacketTraceReader() = delete;
+  explicit PacketTraceReader(std::span<const std::byte> trace);
+
+  // Returns nullopt at the end of the trace, and throws if it is corrupt
+  [[nodiscard]]
+  std::optional<PacketTraceEvent> Next();
+
+ private:
+  uint64_t ReadVarint();
+  uint8_t ReadByte();
+
+  std::span<const std::byte> mRemaining;
+  std::chrono::microseconds mLastTime {};
+  std::array<TracedPacket, PacketTraceEvent::MaxDevices> mLastPackets {};
+};
+
+// Feed a trace through `handler`, decoding it as `WintabTablet` would.
+//
+// `speed` is relative to the original recording; 0 replays as fast as
+// possible. Events recorded in the same microsecond are passed to the
+// handler before a single `Flush()`, like a single message pump iteration.
+//
+// Returns the number of events that were replayed.
+std::size_t ReplayPacketTrace(
+  std::stop_token,
+  std::span<const std::byte> trace,
+  IHandler& handler,
+  double speed);
@@ -0,0 +1,219 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "PenPredictor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "InputFrame.hpp"
+
+namespace {
+// A longer gap than this is a new stroke, so the old velocity is meaningless
+constexpr auto MaxSampleGap = std::chrono::milliseconds(50);
+// Tablets report at a few hundred Hz at most, so samples closer together than
+// this were queued and handled at once
+constexpr auto MinSampleInterval = std::chrono::milliseconds(2);
+
+// Weight of the newest sample in the smoothed velocity and acceleration;
+// acceleration is the difference of two noisy velocities, so it's smoothed
+// more heavily
+constexpr double VelocitySmoothing = 0.5;
+constexpr double AccelerationSmoothing = 0.25;
+
+bool HasPosition(const OTDIPC::Messages::State& state) {
+  return state.HasData(OTDIPC::Messages::State::ValidMask::Position)
+    && state.penIsNearSurface;
+}
+
+double Lerp(const double from, const double to, const double weight) {
+  return from + ((to - from) * weight);
+}
+}// namespace
+
+PenPredictor::PenPredictor(IHandler* next, const Config config)
+  : mNext(next),
+    mConfig(config) {
+}
+
+void PenPredictor::SetDevice(const OTDIPC::Messages::DeviceInfo& device) {
+  auto& track = GetTrack(device.nonPersistentTabletId);
+  track = {
+    .mTabletId = device.nonPersistentTabletId,
+    .mMaxX = device.maxX,
+    .mMaxY = device.maxY,
+  };
+  mNext->SetDevice(device);
+}
+
+void PenPredictor::SetState(const OTDIPC::Messages::State& state) {
+  Stage(state);
+  mNext->SetState(state);
+}
+
+void PenPredictor::SetState(
+  const OTDIPC::Messages::State& state,
+  const Clock::time_point at) {
+  auto& track = GetTrack(state.nonPersistentTabletId);
+  mCurrent = static_cast<std::size_t>(&track - mTracks.data());
+  track.mPending = false;
+  Observe(track, state, at);
+  mNext->SetState(state);
+  ForwardPrediction();
+}
+
+void PenPredictor::SetStates(
+  const std::span<const OTDIPC::Messages::State> states) {
+  for (auto&& state: states) {
+    Stage(state);
+  }
+  mNext->SetStates(states);
+}
+
+void PenPredictor::Flush() {
+  Flush(Clock::now());
+}
+
+void PenPredictor::Flush(const Clock::time_point at) {
+  bool observed = false;
+  for (auto&& track: mTracks) {
+    if (std::exchange(track.mPending, false)) {
+      Observe(track, track.mLatest, at);
+      observed = true;
+    }
+  }
+  if (observed) {
+    ForwardPrediction();
+  }
+  mNext->Flush();
+}
+
+PenPredictor::Track& PenPredictor::GetTrack(const uint32_t tabletId) {
+  const auto it = std::ranges::find(mTracks, tabletId, &Track::mTabletId);
+  if (it != mTracks.end()) {
+    return *it;
+  }
+  return mTracks.emplace_back(Track {.mTabletId = tabletId});
+}
+
+void PenPredictor::Stage(const OTDIPC::Messages::State& state) {
+  auto& track = GetTrack(state.nonPersistentTabletId);
+  mCurrent = static_cast<std::size_t>(&track - mTracks.data());
+  if (!HasPosition(state)) {
+    // End the stroke now, even if the pen is back before the flush
+    track.mPending = false;
+    Observe(track, state, Clock::now());
+    return;
+  }
+  track.mLatest = state;
+  track.mPending = true;
+}
+
+void PenPredictor::Observe(
+  Track& track,
+  const OTDIPC::Messages::State& state,
+  const Clock::time_point at) {
+  track.mLatest = state;
+  if (!HasPosition(state)) {
+    track.mBaselineAt.reset();
+    track.mHasVelocity = false;
+    return;
+  }
+
+  const auto restart = [&] {
+    track.mBaselineX = state.x;
+    track.mBaselineY = state.y;
+    track.mBaselineAt = at;
+    track.mHasVelocity = false;
+  };
+  if (!track.mBaselineAt) {
+    restart();
+    return;
+  }
+
+  const auto dt = at - *track.mBaselineAt;
+  if (dt > MaxSampleGap) {
+    restart();
+    return;
+  }
+  if (dt < MinSampleInterval) {
+    // Handled together with the baseline, so `dt` isn't the time between
+    // samples; the next velocity is measured from the baseline instead
+    return;
+  }
+
+  const auto us = std::chrono::duration<double, std::micro>(dt).count();
+  const auto vx = (state.x - track.mBaselineX) / us;
+  const auto vy = (state.y - track.mBaselineY) / us;
+  track.mBaselineX = state.x;
+  track.mBaselineY = state.y;
+  track.mBaselineAt = at;
+  if (!track.mHasVelocity) {
+    track.mHasVelocity = true;
+    track.mVelocityX = vx;
+    track.mVelocityY = vy;
+    track.mAccelerationX = 0;
+    track.mAccelerationY = 0;
+    return;
+  }
+
+  const auto smoothedX = Lerp(track.mVelocityX, vx, VelocitySmoothing);
+  const auto smoothedY = Lerp(track.mVelocityY, vy, VelocitySmoothing);
+  track.mAccelerationX = Lerp(
+    track.mAccelerationX,
+    (smoothedX - track.mVelocityX) / us,
+    AccelerationSmoothing);
+  track.mAccelerationY = Lerp(
+    track.mAccelerationY,
+    (smoothedY - track.mVelocityY) / us,
+    AccelerationSmoothing);
+  track.mVelocityX = smoothedX;
+  track.mVelocityY = smoothedY;
+}
+
+std::optional<OTDIPC::Messages::State> PenPredictor::Predict(
+  const std::chrono::microseconds horizon) const {
+  if (mCurrent >= mTracks.size()) {
+    return std::nullopt;
+  }
+  const auto& track = mTracks[mCurrent];
+  if (!(track.mHasVelocity && track.mBaselineAt)) {
+    return std::nullopt;
+  }
+  if (track.mVelocityX == 0 && track.mVelocityY == 0) {
+    return std::nullopt;
+  }
+
+  const auto h = static_cast<double>(horizon.count());
+  auto dx = track.mVelocityX * h;
+  auto dy = track.mVelocityY * h;
+  if (mConfig.mUseAcceleration) {
+    // Don't let a noisy acceleration dominate, or reverse the direction of
+    // travel
+    const auto ax = 0.5 * track.mAccelerationX * h * h;
+    const auto ay = 0.5 * track.mAccelerationY * h * h;
+    const auto scale
+      = std::min(1.0, std::hypot(dx, dy) / std::max(std::hypot(ax, ay), 1e-9));
+    dx += ax * scale;
+    dy += ay * scale;
+  }
+
+  auto ret = track.mLatest;
+  ret.x = static_cast<float>(track.mLatest.x + dx);
+  ret.y = static_cast<float>(track.mLatest.y + dy);
+  if (track.mMaxX > 0 && track.mMaxY > 0) {
+    ret.x = std::clamp(ret.x, 0.0f, track.mMaxX);
+    ret.y = std::clamp(ret.y, 0.0f, track.mMaxY);
+  }
+  ret.validBits |= PredictedStateBit;
+  return ret;
+}
+
+void PenPredictor::ForwardPrediction() {
+  if (mConfig.mHorizon <= std::chrono::microseconds::zero()) {
+    return;
+  }
+  if (const auto predicted = Predict(mConfig.mHorizon)) {
+    mNext->SetState(*predicted);
+  }
+}
@@ -0,0 +1,103 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "IHandler.hpp"
+
+// Extrapolates the pen position a little into the future, to hide the
+// latency between the tablet and the client's display.
+//
+// Every state is forwarded unchanged; while the pen is near the surface and
+// moving, each message pump iteration ends with a prediction of where the
+// pen will be `horizon` later, tagged with `PredictedStateBit`. The servers
+// only send predictions to clients that can tell them apart.
+//
+// WinTab doesn't tell us when the pen was sampled, and several queued
+// packets are often handled at once, so states are timestamped when their
+// pump iteration is flushed, not when they're handled.
+//
+// Each tablet is tracked separately.
+class PenPredictor final : public IHandler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Config {
+    std::chrono::microseconds mHorizon {};
+    // If false, only velocity is extrapolated
+    bool mUseAcceleration {true};
+  };
+
+  PenPredictor() = delete;
+  PenPredictor(IHandler* next, Config);
+  ~PenPredictor() override = default;
+
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override;
+  // Observed at the next `Flush()`
+  void SetState(const OTDIPC::Messages::State& state) override;
+  // For drivers that report when the sample was taken, and for replaying
+  // recordings; observed and predicted from immediately
+  void SetState(const OTDIPC::Messages::State& state, Clock::time_point at);
+  void SetStates(std::span<const OTDIPC::Messages::State> states) override;
+  // Observes the latest state from each tablet as of now
+  void Flush() override;
+  // As `Flush()`, with the time of the message pump iteration
+  void Flush(Clock::time_point at);
+
+  // Where the pen is expected to be `horizon` after the latest state from
+  // any tablet; nullopt if the pen is away from the surface, or hasn't moved
+  // yet
+  [[nodiscard]]
+  std::optional<OTDIPC::Messages::State> Predict(
+    std::chrono::microseconds horizon) const;
+
+ private:
+  struct Track {
+    uint32_t mTabletId {};
+    float mMaxX {};
+    float mMaxY {};
+
+    // Predictions extrapolate from here
+    OTDIPC::Messages::State mLatest {};
+    // `mLatest` was set by `SetState()` without a time
+    bool mPending {false};
+
+    // Where velocity is measured from; only moved on once enough time has
+    // passed, so that samples handled together don't shrink the interval.
+    // Empty while the pen is away from the surface.
+    float mBaselineX {};
+    float mBaselineY {};
+    std::optional<Clock::time_point> mBaselineAt;
+    // Tablet units per microsecond, and per microsecond squared; smoothed, as
+    // positions are quantized
+    bool mHasVelocity {false};
+    double mVelocityX {};
+    double mVelocityY {};
+    double mAccelerationX {};
+    double mAccelerationY {};
+  };
+
+  [[nodiscard]]
+  Track& GetTrack(uint32_t tabletId);
+  // Makes `state`'s tablet the current one, and stores it until the next
+  // `Flush()`
+  void Stage(const OTDIPC::Messages::State& state);
+  // Update the motion model without forwarding anything
+  static void Observe(
+    Track& track,
+    const OTDIPC::Messages::State& state,
+    Clock::time_point at);
+  void ForwardPrediction();
+
+  IHandler* mNext {nullptr};
+  Config mConfig {};
+
+  // There are rarely more than two tablets, so this is searched linearly
+  std::vector<Track> mTracks;
+  // The track with the latest state
+  std::size_t mCurrent {};
+};
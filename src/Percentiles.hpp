@@ -0,0 +1,54 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+// Percentiles of a bucketed histogram.
+//
+// Each `{percentile, out}` target is set to `upperBound(i)` for the bucket `i`
+// that contains it; targets must be in ascending order. `total` is the sum of
+// `counts`.
+//
+// Returns the upper bound of the highest non-empty bucket; targets are left
+// alone, and a default value is returned, if `total` is 0.
+template <class UpperBound>
+auto FindPercentiles(
+  const std::span<const uint64_t> counts,
+  const uint64_t total,
+  UpperBound&& upperBound,
+  const std::initializer_list<
+    std::pair<double, std::invoke_result_t<UpperBound&, std::size_t>*>>
+    targets) {
+  std::invoke_result_t<UpperBound&, std::size_t> max {};
+  if (total == 0) {
+    return max;
+  }
+
+  const auto rank = [total](const double percentile) {
+    return std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(percentile * total)));
+  };
+
+  uint64_t seen = 0;
+  auto target = targets.begin();
+  for (std::size_t i = 0; i < counts.size(); ++i) {
+    if (counts[i] == 0) {
+      continue;
+    }
+    seen += counts[i];
+    max = upperBound(i);
+    while (target != targets.end() && seen >= rank(target->first)) {
+      *target->second = max;
+      ++target;
+    }
+  }
+  return max;
+}
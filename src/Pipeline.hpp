@@ -0,0 +1,186 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <concepts>
+#include <span>
+#include <tuple>
+#include <utility>
+
+#include "IHandler.hpp"
+
+// Statically-dispatched alternative to chaining `IHandler`s.
+//
+// A `Pipeline<Stages...>` passes each call through its stages in order, and
+// then to a sink; every call is resolved at compile time, so a sample goes
+// through the whole pipeline in one inlinable function. `final` handlers,
+// like the servers, are devirtualized; `IHandler` still works as a sink, for
+// anything that's only known at runtime.
+
+// Anything with the same members as `IHandler`
+template <class T>
+concept Handler = requires(
+  T& handler,
+  const OTDIPC::Messages::DeviceInfo& device,
+  const OTDIPC::Messages::State& state,
+  std::span<const OTDIPC::Messages::State> states) {
+  handler.SetDevice(device);
+  handler.SetState(state);
+  handler.SetStates(states);
+  handler.Flush();
+};
+
+// Base for pipeline stages; forwards everything to the next stage. Stages
+// hide the members they want to change.
+struct PipelineStage {
+  template <Handler Next>
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device, Next& next) {
+    next.SetDevice(device);
+  }
+
+  template <Handler Next>
+  void SetState(const OTDIPC::Messages::State& state, Next& next) {
+    next.SetState(state);
+  }
+
+  template <Handler Next>
+  void SetStates(
+    const std::span<const OTDIPC::Messages::State> states,
+    Next& next) {
+    next.SetStates(states);
+  }
+
+  template <Handler Next>
+  void Flush(Next& next) {
+    next.Flush();
+  }
+};
+
+// Passes every call to each sink, in order; null sinks are skipped, for
+// optional servers
+template <Handler... Sinks>
+class FanOut final {
+ public:
+  explicit FanOut(Sinks*... sinks) : mSinks {sinks...} {
+  }
+
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) {
+    ForEach([&device](auto& sink) { sink.SetDevice(device); });
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) {
+    ForEach([&state](auto& sink) { sink.SetState(state); });
+  }
+
+  void SetStates(const std::span<const OTDIPC::Messages::State> states) {
+    ForEach([states](auto& sink) { sink.SetStates(states); });
+  }
+
+  void Flush() {
+    ForEach([](auto& sink) { sink.Flush(); });
+  }
+
+ private:
+  std::tuple<Sinks*...> mSinks;
+
+  template <class F>
+  void ForEach(F&& f) {
+    std::apply(
+      [&f](auto*... sinks) {
+        ((sinks ? f(*sinks) : void()), ...);
+      },
+      mSinks);
+  }
+};
+
+// The stages, then the sink; the sink is any `Handler`, and is last
+template <class... Stages>
+class Pipeline;
+
+template <Handler Sink>
+class Pipeline<Sink> final {
+ public:
+  explicit Pipeline(Sink sink) : mSink(std::move(sink)) {
+  }
+
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) {
+    mSink.SetDevice(device);
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) {
+    mSink.SetState(state);
+  }
+
+  void SetStates(const std::span<const OTDIPC::Messages::State> states) {
+    mSink.SetStates(states);
+  }
+
+  void Flush() {
+    mSink.Flush();
+  }
+
+ private:
+  Sink mSink;
+};
+
+template <std::derived_from<PipelineStage> First, class... Rest>
+class Pipeline<First, Rest...> final {
+ public:
+  explicit Pipeline(First first, Rest... rest)
+    : mStage(std::move(first)),
+      mNext(std::move(rest)...) {
+  }
+
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) {
+    mStage.SetDevice(device, mNext);
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) {
+    mStage.SetState(state, mNext);
+  }
+
+  void SetStates(const std::span<const OTDIPC::Messages::State> states) {
+    mStage.SetStates(states, mNext);
+  }
+
+  void Flush() {
+    mStage.Flush(mNext);
+  }
+
+ private:
+  First mStage;
+  Pipeline<Rest...> mNext;
+};
+
+template <class... Stages>
+Pipeline(Stages...) -> Pipeline<Stages...>;
+
+// Exposes a statically-dispatched handler as an `IHandler`, for code that
+// takes one, like `WintabTablet`; that's a single virtual call per sample or
+// batch, then static dispatch from there on
+template <Handler T>
+class HandlerAdapter final : public IHandler {
+ public:
+  explicit HandlerAdapter(T inner) : mInner(std::move(inner)) {
+  }
+  ~HandlerAdapter() override = default;
+
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override {
+    mInner.SetDevice(device);
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) override {
+    mInner.SetState(state);
+  }
+
+  void SetStates(std::span<const OTDIPC::Messages::State> states) override {
+    mInner.SetStates(states);
+  }
+
+  void Flush() override {
+    mInner.Flush();
+  }
+
+ private:
+  T mInner;
+};
@@ -0,0 +1,365 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "Reactor.hpp"
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+// clang-format off
+#include <Windows.h>
+#include <wil/result.h>
+// clang-format on
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+template <class T>
+int64_t CeilMilliseconds(const T duration) {
+  return std::max<int64_t>(
+    0, std::chrono::ceil<std::chrono::milliseconds>(duration).count());
+}
+}// namespace
+
+#ifdef _WIN32
+struct Reactor::Platform {
+  // Parallel arrays, as `WaitForMultipleObjects()` wants just the handles
+  std::vector<HANDLE> mHandles;
+  std::vector<uint64_t> mIDs;
+
+  void Add(const uint64_t id, const Waitable waitable) {
+    if (mHandles.size() >= MAXIMUM_WAIT_OBJECTS) {
+      throw std::runtime_error("Too many handles for the reactor");
+    }
+    mHandles.push_back(waitable);
+    mIDs.push_back(id);
+  }
+
+  void Remove(const uint64_t id, Waitable) {
+    const auto it = std::ranges::find(mIDs, id);
+    if (it == mIDs.end()) {
+      return;
+    }
+    const auto index = it - mIDs.begin();
+    mIDs.erase(it);
+    mHandles.erase(mHandles.begin() + index);
+  }
+
+  void Wait(
+    const std::optional<Clock::duration> timeout,
+    std::vector<uint64_t>& ready) {
+    const auto count = static_cast<DWORD>(mHandles.size());
+    const auto result = WaitForMultipleObjects(
+      count,
+      mHandles.data(),
+      FALSE,
+      timeout ? static_cast<DWORD>(CeilMilliseconds(*timeout)) : INFINITE);
+    if (result == WAIT_TIMEOUT) {
+      return;
+    }
+    if (result >= WAIT_OBJECT_0 + count) {
+      THROW_LAST_ERROR();
+    }
+
+    const auto first = result - WAIT_OBJECT_0;
+    ready.push_back(mIDs[first]);
+    // Only the first signalled handle is reported; check the others, so that
+    // busy handles early in the array can't starve the rest
+    for (auto i = first + 1; i < count; ++i) {
+      if (WaitForSingleObject(mHandles[i], 0) == WAIT_OBJECT_0) {
+        ready.push_back(mIDs[i]);
+      }
+    }
+  }
+
+  // Auto-reset, so waiting resets it
+  static Waitable CreateNotification() {
+    const auto event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    THROW_LAST_ERROR_IF_NULL(event);
+    return event;
+  }
+
+  static void Notify(const Waitable waitable) {
+    SetEvent(waitable);
+  }
+
+  static void ResetNotification(Waitable) {
+  }
+
+  static void CloseNotification(const Waitable waitable) {
+    CloseHandle(waitable);
+  }
+};
+#else
+struct Reactor::Platform {
+  int mEpoll {-1};
+
+  Platform() {
+    mEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpoll == -1) {
+      throw std::system_error(errno, std::system_category(), "epoll_create1");
+    }
+  }
+
+  ~Platform() {
+    close(mEpoll);
+  }
+
+  void Add(const uint64_t id, const Waitable waitable) {
+    epoll_event event {.events = EPOLLIN, .data = {.u64 = id}};
+    if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, waitable, &event) == -1) {
+      throw std::system_error(errno, std::system_category(), "epoll_ctl");
+    }
+  }
+
+  void Remove(uint64_t, const Waitable waitable) {
+    // Fails if the descriptor has already been closed, which also removes it
+    epoll_ctl(mEpoll, EPOLL_CTL_DEL, waitable, nullptr);
+  }
+
+  void Wait(
+    const std::optional<Clock::duration> timeout,
+    std::vector<uint64_t>& ready) {
+    epoll_event events[64];
+    const auto count = epoll_wait(
+      mEpoll,
+      events,
+      std::size(events),
+      timeout ? static_cast<int>(CeilMilliseconds(*timeout)) : -1);
+    if (count == -1) {
+      if (errno == EINTR) {
+        return;
+      }
+      throw std::system_error(errno, std::system_category(), "epoll_wait");
+    }
+    for (int i = 0; i < count; ++i) {
+      ready.push_back(events[i].data.u64);
+    }
+  }
+
+  static Waitable CreateNotification() {
+    const auto fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd == -1) {
+      throw std::system_error(errno, std::system_category(), "eventfd");
+    }
+    return fd;
+  }
+
+  static void Notify(const Waitable waitable) {
+    const uint64_t one = 1;
+    std::ignore = write(waitable, &one, sizeof(one));
+  }
+
+  static void ResetNotification(const Waitable waitable) {
+    uint64_t count {};
+    std::ignore = read(waitable, &count, sizeof(count));
+  }
+
+  static void CloseNotification(const Waitable waitable) {
+    close(waitable);
+  }
+};
+#endif
+
+Reactor::Registration::Registration(Reactor* reactor, const uint64_t id)
+  : mReactor(reactor),
+    mId(id) {
+}
+
+Reactor::Registration::Registration(Registration&& other) noexcept
+  : mReactor(std::exchange(other.mReactor, nullptr)),
+    mId(other.mId) {
+}
+
+Reactor::Registration& Reactor::Registration::operator=(
+  Registration&& other) noexcept {
+  if (this != &other) {
+    reset();
+    mReactor = std::exchange(other.mReactor, nullptr);
+    mId = other.mId;
+  }
+  return *this;
+}
+
+Reactor::Registration::~Registration() {
+  reset();
+}
+
+void Reactor::Registration::reset() {
+  if (mReactor) {
+    std::exchange(mReactor, nullptr)->Remove(mId);
+  }
+}
+
+Reactor::Registration::operator bool() const noexcept {
+  return mReactor != nullptr;
+}
+
+Reactor::Notifier::Notifier(Reactor& reactor, Callback callback)
+  : mWaitable(Platform::CreateNotification()) {
+  try {
+    mRegistration = reactor.Watch(
+      mWaitable,
+      [waitable = mWaitable, callback = std::move(callback)] {
+        Platform::ResetNotification(waitable);
+        callback();
+      });
+  } catch (...) {
+    Platform::CloseNotification(mWaitable);
+    throw;
+  }
+}
+
+Reactor::Notifier::~Notifier() {
+  mRegistration.reset();
+  Platform::CloseNotification(mWaitable);
+}
+
+void Reactor::Notifier::Notify() {
+  Platform::Notify(mWaitable);
+}
+
+Reactor::Reactor() : mPlatform(std::make_unique<Platform>()) {
+  mInvocationsNotifier = CreateNotifier([this] { RunInvocations(); });
+  mThread = std::jthread(std::bind_front(&Reactor::Run, this));
+}
+
+Reactor::~Reactor() {
+  mThread.request_stop();
+  mInvocationsNotifier->Notify();
+  mThread.join();
+  mInvocationsNotifier.reset();
+}
+
+Reactor::Registration Reactor::Watch(
+  const Waitable waitable,
+  Callback callback) {
+  const auto id = mNextId++;
+  mPlatform->Add(id, waitable);
+  mWatches.emplace(
+    id,
+    WatchEntry {
+      .mCallback = std::move(callback),
+      .mWaitable = waitable,
+    });
+  return {this, id};
+}
+
+Reactor::Registration Reactor::AddTimer(
+  const std::chrono::milliseconds interval,
+  Callback callback) {
+  const auto id = mNextId++;
+  mTimers.Add(id, Clock::now() + interval, interval, std::move(callback));
+  return {this, id};
+}
+
+Reactor::Registration Reactor::AddTimer(
+  const Clock::time_point due,
+  Callback callback) {
+  const auto id = mNextId++;
+  mTimers.Add(id, due, {}, std::move(callback));
+  return {this, id};
+}
+
+std::unique_ptr<Reactor::Notifier> Reactor::CreateNotifier(Callback callback) {
+  return std::unique_ptr<Notifier>(new Notifier(*this, std::move(callback)));
+}
+
+void Reactor::Invoke(const std::function<void()>& fn) {
+  if (IsReactorThread()) {
+    fn();
+    return;
+  }
+
+  std::promise<void> done;
+  {
+    const std::unique_lock lock(mInvocationsMutex);
+    mInvocations.push_back([&fn, &done] {
+      try {
+        fn();
+        done.set_value();
+      } catch (...) {
+        done.set_exception(std::current_exception());
+      }
+    });
+  }
+  mInvocationsNotifier->Notify();
+  done.get_future().get();
+}
+
+bool Reactor::IsReactorThread() const {
+  return std::this_thread::get_id() == mThread.get_id();
+}
+
+uint64_t Reactor::GetWakeCount() const {
+  return mWakeCount.load(std::memory_order_relaxed);
+}
+
+void Reactor::Run(const std::stop_token st) {
+  while (!st.stop_requested()) {
+    const auto timeout = RunDueTimers();
+
+    mReady.clear();
+    mPlatform->Wait(timeout, mReady);
+    mWakeCount.fetch_add(1, std::memory_order_relaxed);
+    for (const auto id: mReady) {
+      Dispatch(id);
+    }
+
+    for (const auto id: mRemoved) {
+      mWatches.erase(id);
+    }
+    mRemoved.clear();
+  }
+}
+
+std::optional<Reactor::Clock::duration> Reactor::RunDueTimers() {
+  mTimers.Advance(Clock::now());
+  if (const auto next = mTimers.GetNextDue()) {
+    return *next - Clock::now();
+  }
+  return std::nullopt;
+}
+
+void Reactor::Dispatch(const uint64_t id) {
+  // Nodes are stable, so this remains valid even if the callback adds
+  // registrations
+  const auto it = mWatches.find(id);
+  if (it == mWatches.end() || it->second.mIsRemoved) {
+    return;
+  }
+  it->second.mCallback();
+}
+
+void Reactor::Remove(const uint64_t id) {
+  const auto it = mWatches.find(id);
+  if (it == mWatches.end()) {
+    mTimers.Cancel(id);
+    return;
+  }
+  if (it->second.mIsRemoved) {
+    return;
+  }
+  it->second.mIsRemoved = true;
+  mPlatform->Remove(id, it->second.mWaitable);
+  mRemoved.push_back(id);
+}
+
+void Reactor::RunInvocations() {
+  std::vector<std::function<void()>> invocations;
+  {
+    const std::unique_lock lock(mInvocationsMutex);
+    invocations = std::exchange(mInvocations, {});
+  }
+  for (auto&& it: invocations) {
+    it();
+  }
+}
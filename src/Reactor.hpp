@@ -0,0 +1,140 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "TimerWheel.hpp"
+
+// A single thread that waits on every server's sockets, pipes, and timers,
+// and runs their callbacks.
+//
+// Registrations may only be created or destroyed on the reactor thread - for
+// example, from a callback - so other threads should use `Invoke()`.
+//
+// On Windows, this waits for event handles with `WaitForMultipleObjects()`,
+// so it is limited to 64 registrations; on Linux, it uses epoll.
+class Reactor final {
+ public:
+#ifdef _WIN32
+  using Waitable = void*;// HANDLE of an event
+#else
+  using Waitable = int;// File descriptor
+#endif
+  using Callback = std::function<void()>;
+  using Clock = TimerWheel::Clock;
+
+  // Removes the watch or timer when destroyed
+  class Registration final {
+   public:
+    Registration() = default;
+    Registration(Registration&&) noexcept;
+    Registration& operator=(Registration&&) noexcept;
+    ~Registration();
+
+    void reset();
+    explicit operator bool() const noexcept;
+
+   private:
+    friend class Reactor;
+    Registration(Reactor*, uint64_t id);
+
+    Reactor* mReactor {nullptr};
+    uint64_t mId {};
+  };
+
+  // Wakes the reactor to run a callback; cheaper than `Invoke()` for things
+  // that happen often, like flushing states
+  class Notifier final {
+   public:
+    ~Notifier();
+    Notifier(const Notifier&) = delete;
+    Notifier& operator=(const Notifier&) = delete;
+
+    // May be called from any thread; notifications are coalesced until the
+    // callback runs
+    void Notify();
+
+   private:
+    friend class Reactor;
+    Notifier(Reactor&, Callback);
+
+    Waitable mWaitable {};
+    Registration mRegistration;
+  };
+
+  Reactor();
+  ~Reactor();
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  // Runs `callback` when `waitable` is signalled (Windows), or readable
+  // (elsewhere); it must be level-triggered, or reset by the callback
+  [[nodiscard]]
+  Registration Watch(Waitable, Callback);
+
+  // Runs `callback` every `interval`, starting one interval from now
+  [[nodiscard]]
+  Registration AddTimer(std::chrono::milliseconds interval, Callback);
+  // Runs `callback` once, at the first millisecond tick at or after `due`
+  [[nodiscard]]
+  Registration AddTimer(Clock::time_point due, Callback);
+
+  [[nodiscard]]
+  std::unique_ptr<Notifier> CreateNotifier(Callback);
+
+  // Runs `fn` on the reactor thread, and waits for it; runs it immediately
+  // if already on the reactor thread. Exceptions are rethrown here.
+  void Invoke(const std::function<void()>& fn);
+
+  [[nodiscard]]
+  bool IsReactorThread() const;
+
+  // Number of times the thread has woken up, for benchmarks
+  [[nodiscard]]
+  uint64_t GetWakeCount() const;
+
+ private:
+  struct Platform;
+  struct WatchEntry {
+    Callback mCallback;
+    Waitable mWaitable {};
+    // Watches aren't erased until the current callbacks have finished, as a
+    // callback can remove its own registration
+    bool mIsRemoved {false};
+  };
+
+  void Run(std::stop_token);
+  // Returns the time until the next timer is due
+  std::optional<Clock::duration> RunDueTimers();
+  void Dispatch(uint64_t id);
+  void Remove(uint64_t id);
+  void RunInvocations();
+
+  std::unique_ptr<Platform> mPlatform;
+
+  // Only used on the reactor thread, apart from construction. Watches and
+  // timers share IDs, so a `Registration` can refer to either.
+  uint64_t mNextId {1};
+  std::unordered_map<uint64_t, WatchEntry> mWatches;
+  TimerWheel mTimers;
+  std::vector<uint64_t> mReady;
+  std::vector<uint64_t> mRemoved;
+  std::atomic<uint64_t> mWakeCount {};
+
+  std::mutex mInvocationsMutex;
+  std::vector<std::function<void()>> mInvocations;
+  std::unique_ptr<Notifier> mInvocationsNotifier;
+
+  std::jthread mThread;
+};
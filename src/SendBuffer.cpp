@@ -0,0 +1,50 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "SendBuffer.hpp"
+
+#include <cstring>
+
+SendBuffer::SendBuffer(const std::size_t reserve) {
+  mBuffer.reserve(reserve);
+}
+
+void SendBuffer::Append(const void* const data, const std::size_t size) {
+  // After partial sends, the sent prefix would otherwise grow forever for a
+  // client that never quite catches up; moving the rest down once it's the
+  // smaller half keeps this amortized constant-time
+  if (mOffset && mOffset >= mBuffer.size() / 2) {
+    const auto pending = mBuffer.size() - mOffset;
+    std::memmove(mBuffer.data(), mBuffer.data() + mOffset, pending);
+    mBuffer.resize(pending);
+    mOffset = 0;
+  }
+
+  const auto offset = mBuffer.size();
+  mBuffer.resize(offset + size);
+  std::memcpy(mBuffer.data() + offset, data, size);
+}
+
+std::span<const std::byte> SendBuffer::GetPending() const noexcept {
+  return std::span {mBuffer}.subspan(mOffset);
+}
+
+void SendBuffer::Consume(const std::size_t byteCount) noexcept {
+  mOffset += byteCount;
+  if (mOffset >= mBuffer.size()) {
+    // Keep the capacity so that steady-state operation doesn't allocate
+    clear();
+  }
+}
+
+std::size_t SendBuffer::size() const noexcept {
+  return mBuffer.size() - mOffset;
+}
+
+bool SendBuffer::empty() const noexcept {
+  return size() == 0;
+}
+
+void SendBuffer::clear() noexcept {
+  mBuffer.clear();
+  mOffset = 0;
+}
@@ -0,0 +1,43 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Staging area for outgoing messages, so that everything produced during one
+// message pump iteration can be written to a client with a single call.
+class SendBuffer final {
+ public:
+  SendBuffer() = default;
+  explicit SendBuffer(std::size_t reserve);
+
+  void Append(const void* data, std::size_t size);
+
+  template <class T>
+    requires(!std::is_pointer_v<T> && std::is_trivially_copyable_v<T>)
+  void Append(const T& message) {
+    Append(&message, sizeof(T));
+  }
+
+  // Everything that has been appended, but not yet consumed
+  [[nodiscard]]
+  std::span<const std::byte> GetPending() const noexcept;
+
+  // Mark the first `byteCount` pending bytes as sent; their space is reused
+  // by a later `Append()`
+  void Consume(std::size_t byteCount) noexcept;
+
+  [[nodiscard]]
+  std::size_t size() const noexcept;
+  [[nodiscard]]
+  bool empty() const noexcept;
+
+  void clear() noexcept;
+
+ private:
+  std::vector<std::byte> mBuffer;
+  std::size_t mOffset {};
+};
@@ -0,0 +1,51 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "SharedHookTelemetry.hpp"
+
+#include <build-config.hpp>
+
+SharedHookTelemetry::SharedHookTelemetry() {
+  mMapping.reset(CreateFileMappingW(
+    INVALID_HANDLE_VALUE,
+    nullptr,
+    PAGE_READWRITE,
+    0,
+    sizeof(HookTelemetry),
+    BuildConfig::TelemetrySHMName));
+  THROW_LAST_ERROR_IF_NULL(mMapping);
+  mView = static_cast<HookTelemetry*>(MapViewOfFile(
+    mMapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, sizeof(HookTelemetry)));
+  THROW_LAST_ERROR_IF_NULL(mView);
+  mAttached = mView->Attach();
+}
+
+SharedHookTelemetry::~SharedHookTelemetry() {
+  if (mView) {
+    UnmapViewOfFile(mView);
+  }
+}
+
+HookTelemetry* SharedHookTelemetry::Get() const {
+  return mAttached ? mView : nullptr;
+}
+
+void SharedHookTelemetry::ReleaseExitedProcesses() {
+  if (!mAttached) {
+    return;
+  }
+  for (auto&& process: mView->processes) {
+    const auto processId = process.processId.load(std::memory_order_acquire);
+    if (!processId) {
+      continue;
+    }
+    const wil::unique_process_handle handle {
+      OpenProcess(SYNCHRONIZE, FALSE, processId)};
+    // If we can't open it, it's either gone, or we're not allowed to check;
+    // only release slots for processes that we know have exited
+    if (
+      (!handle && GetLastError() == ERROR_INVALID_PARAMETER)
+      || (handle && WaitForSingleObject(handle.get(), 0) == WAIT_OBJECT_0)) {
+      HookTelemetry::Release(process);
+    }
+  }
+}
@@ -0,0 +1,32 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <wil/resource.h>
+#include <Windows.h>
+
+#include "HookTelemetry.hpp"
+
+// The named mapping containing `HookTelemetry`; opened by both the hijack
+// DLL and the adapter, whichever is first
+class SharedHookTelemetry final {
+public:
+  SharedHookTelemetry();
+  ~SharedHookTelemetry();
+
+  SharedHookTelemetry(const SharedHookTelemetry&) = delete;
+  SharedHookTelemetry& operator=(const SharedHookTelemetry&) = delete;
+
+  // Null if the mapping has an incompatible layout
+  [[nodiscard]]
+  HookTelemetry* Get() const;
+
+  // Adapter: free the slots of driver processes that exited without
+  // releasing them, e.g. because they crashed
+  void ReleaseExitedProcesses();
+
+private:
+  wil::unique_handle mMapping;
+  HookTelemetry* mView { nullptr };
+  bool mAttached { false };
+};
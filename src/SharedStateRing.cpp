@@ -0,0 +1,276 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "SharedStateRing.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#include <format>
+
+#include "utf8.hpp"
+
+// clang-format off
+#include <Windows.h>
+#include <wil/resource.h>
+// clang-format on
+#else
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <climits>
+#include <ctime>
+#endif
+
+#ifdef _WIN32
+struct SharedStateRing::Platform {
+  wil::unique_handle mMapping;
+  wil::unique_mapview_ptr<Layout> mView;
+  // Futexes can't be shared between processes on Windows, and events don't
+  // fit: an auto-reset event only wakes a single reader, and a manual-reset
+  // event stays set after the wake, so idle readers would spin.
+  //
+  // Instead, each wake releases one unit per waiting reader. A reader that
+  // stops waiting before it takes its unit leaves it behind, so a later
+  // `Wait()` may return early; `SharedStateRing::Wait()` checks `wakeCount`
+  // and waits again, consuming the stale unit.
+  wil::unique_handle mSemaphore;
+
+  Platform(const Disposition d, const std::string& name, Layout** layout) {
+    const auto wideName = from_utf8(std::format("Local\\{}", name));
+    const auto semaphoreName = wideName + L".Wake";
+    if (d == Disposition::Write) {
+      mMapping.reset(CreateFileMappingW(
+        INVALID_HANDLE_VALUE,
+        nullptr,
+        PAGE_READWRITE,
+        0,
+        sizeof(Layout),
+        wideName.c_str()));
+      mSemaphore.reset(CreateSemaphoreW(
+        nullptr, 0, MAXLONG, semaphoreName.c_str()));
+    } else {
+      mMapping.reset(
+        OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, wideName.c_str()));
+      mSemaphore.reset(
+        OpenSemaphoreW(SYNCHRONIZE, FALSE, semaphoreName.c_str()));
+    }
+    THROW_LAST_ERROR_IF_NULL(mMapping);
+    THROW_LAST_ERROR_IF_NULL(mSemaphore);
+
+    // Readers need write access too, for `waiterCount`
+    mView.reset(static_cast<Layout*>(MapViewOfFile(
+      mMapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Layout))));
+    THROW_LAST_ERROR_IF_NULL(mView);
+    *layout = mView.get();
+  }
+
+  void Wake(Layout&, const uint32_t waiterCount) {
+    // Fails if the semaphore is saturated by stale units; readers are still
+    // woken by those
+    ReleaseSemaphore(mSemaphore.get(), static_cast<LONG>(waiterCount), nullptr);
+  }
+
+  void Wait(Layout&, uint32_t, const std::chrono::milliseconds timeout) {
+    WaitForSingleObject(
+      mSemaphore.get(), static_cast<DWORD>(timeout.count()));
+  }
+};
+#else
+struct SharedStateRing::Platform {
+  std::string mPath;
+  Disposition mDisposition;
+  void* mView {MAP_FAILED};
+
+  Platform(const Disposition d, const std::string& name, Layout** layout)
+    : mPath("/" + name),
+      mDisposition(d) {
+    const int fd = (d == Disposition::Write)
+      ? shm_open(mPath.c_str(), O_RDWR | O_CREAT, 0600)
+      : shm_open(mPath.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    if (d == Disposition::Write && ftruncate(fd, sizeof(Layout)) == -1) {
+      const auto error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), "ftruncate");
+    }
+    // Readers need write access too, for `waiterCount`
+    mView = mmap(
+      nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const auto error = errno;
+    close(fd);
+    if (mView == MAP_FAILED) {
+      throw std::system_error(error, std::generic_category(), "mmap");
+    }
+    *layout = static_cast<Layout*>(mView);
+  }
+
+  ~Platform() {
+    if (mView != MAP_FAILED) {
+      munmap(mView, sizeof(Layout));
+    }
+    if (mDisposition == Disposition::Write) {
+      shm_unlink(mPath.c_str());
+    }
+  }
+
+  void Wake(Layout& layout, uint32_t) {
+    syscall(
+      SYS_futex, &layout.wakeCount, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+  }
+
+  void Wait(
+    Layout& layout,
+    const uint32_t wakeCount,
+    const std::chrono::milliseconds timeout) {
+    const auto seconds
+      = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    const timespec ts {
+      .tv_sec = static_cast<time_t>(seconds.count()),
+      .tv_nsec = static_cast<long>(
+        std::chrono::nanoseconds(timeout - seconds).count()),
+    };
+    // Returns immediately if `wakeCount` has changed since we read it
+    syscall(
+      SYS_futex, &layout.wakeCount, FUTEX_WAIT, wakeCount, &ts, nullptr, 0);
+  }
+};
+#endif
+
+SharedStateRing::SharedStateRing(const Disposition d, std::string name)
+  : mName(std::move(name)),
+    mDisposition(d) {
+  mPlatform = std::make_unique<Platform>(d, mName, &mLayout);
+
+  if (d == Disposition::Write) {
+    // A previous writer may have crashed; start again from scratch, so that
+    // readers can't see stale records with plausible sequence numbers
+    mLayout->magic.store(0, std::memory_order_release);
+    mLayout->version = Version;
+    mLayout->capacity = Capacity;
+    mLayout->slotSize = sizeof(Slot);
+    mLayout->writeSequence.store(0, std::memory_order_relaxed);
+    for (auto&& slot: mLayout->slots) {
+      slot.sequence.store(0, std::memory_order_relaxed);
+    }
+    mLayout->magic.store(Magic, std::memory_order_release);
+    return;
+  }
+
+  if (
+    mLayout->magic.load(std::memory_order_acquire) != Magic
+    || mLayout->version != Version || mLayout->capacity != Capacity
+    || mLayout->slotSize != sizeof(Slot)) {
+    throw std::runtime_error(
+      "Shared state ring is uninitialized or has an incompatible layout");
+  }
+  mNextSequence = std::max<uint64_t>(
+    mLayout->writeSequence.load(std::memory_order_acquire), 1);
+}
+
+SharedStateRing::~SharedStateRing() = default;
+
+void SharedStateRing::Push(
+  const OTDIPC::Messages::State& state,
+  const uint64_t timestamp) {
+  const auto sequence = mNextSequence++;
+  auto& slot = mLayout->slots[sequence % Capacity];
+  // Standard seqlock write: mark the slot as in-progress, and make sure that
+  // is visible before any of the new contents
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestamp = timestamp;
+  std::memcpy(&slot.state, &state, sizeof(state));
+  slot.sequence.store(sequence, std::memory_order_release);
+
+  // seq_cst, so that this is ordered before `Wake()`'s check of
+  // `waiterCount`
+  mLayout->writeSequence.store(sequence, std::memory_order_seq_cst);
+}
+
+void SharedStateRing::Wake() {
+  mLayout->wakeCount.fetch_add(1, std::memory_order_seq_cst);
+  const auto waiterCount
+    = mLayout->waiterCount.load(std::memory_order_seq_cst);
+  if (waiterCount > 0) {
+    mPlatform->Wake(*mLayout, waiterCount);
+  }
+}
+
+std::optional<SharedStateRing::Record> SharedStateRing::TryRead() {
+  for (int i = 0; i < MaxReadAttempts; ++i) {
+    const auto written = mLayout->writeSequence.load(std::memory_order_acquire);
+    if (mNextSequence > written) {
+      return std::nullopt;
+    }
+    if (written - mNextSequence >= Capacity) {
+      const auto oldest = written - Capacity + 1;
+      mOverrunCount += oldest - mNextSequence;
+      mNextSequence = oldest;
+    }
+
+    // If the slot doesn't have our sequence number, a newer lap has started
+    // writing it, so the record is gone; that write may never finish if the
+    // writer crashed, so don't wait for it
+    const auto& slot = mLayout->slots[mNextSequence % Capacity];
+    if (slot.sequence.load(std::memory_order_acquire) != mNextSequence) {
+      ++mOverrunCount;
+      ++mNextSequence;
+      continue;
+    }
+    // This copy may race with the writer; if it does, the sequence check
+    // below fails and the copy is discarded
+    Record ret {.mSequence = mNextSequence};
+    ret.mTimestamp = slot.timestamp;
+    std::memcpy(&ret.mState, &slot.state, sizeof(ret.mState));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    ++mNextSequence;
+    if (slot.sequence.load(std::memory_order_relaxed) != ret.mSequence) {
+      ++mOverrunCount;
+      continue;
+    }
+    return ret;
+  }
+  return std::nullopt;
+}
+
+bool SharedStateRing::Wait(const std::chrono::milliseconds timeout) {
+  const auto wakeCount = mLayout->wakeCount.load(std::memory_order_seq_cst);
+  const auto available = [this] {
+    return mLayout->writeSequence.load(std::memory_order_seq_cst)
+      >= mNextSequence;
+  };
+
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  mLayout->waiterCount.fetch_add(1, std::memory_order_seq_cst);
+  // The platform wait can return without a new wake, e.g. for a wake that a
+  // previous `Wait()` gave up on, so only a changed `wakeCount` or the
+  // deadline ends the wait
+  while (!available()
+         && mLayout->wakeCount.load(std::memory_order_seq_cst) == wakeCount) {
+    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now());
+    if (remaining <= std::chrono::milliseconds::zero()) {
+      break;
+    }
+    mPlatform->Wait(*mLayout, wakeCount, remaining);
+  }
+  mLayout->waiterCount.fetch_sub(1, std::memory_order_seq_cst);
+  return available();
+}
+
+uint64_t SharedStateRing::GetOverrunCount() const {
+  return mOverrunCount;
+}
+
+const std::string& SharedStateRing::GetName() const {
+  return mName;
+}
@@ -0,0 +1,120 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <OTDIPC/State.hpp>
+
+// Single-writer, multi-reader broadcast of `State` messages through named
+// shared memory.
+//
+// Readers never block the writer: each slot is a seqlock, and a reader that
+// falls more than `Capacity` records behind skips ahead to the oldest record
+// that is still available, counting the records it missed as overruns.
+//
+// The name is platform-neutral; it is mapped to `Local\<name>` on Windows,
+// and `/<name>` for `shm_open()` elsewhere.
+class SharedStateRing final {
+ public:
+  static constexpr uint32_t Magic = 0x474e5253;// 'SRNG'
+  static constexpr uint32_t Version = 2;
+  static constexpr uint32_t Capacity = 1024;
+
+  // Slots `TryRead()` looks at before giving up; the writer may have crashed
+  // mid-`Push()`
+  static constexpr int MaxReadAttempts = 64;
+
+  struct alignas(64) Slot {
+    // 0 while the slot is being written, otherwise the sequence number of
+    // the record it contains
+    std::atomic<uint64_t> sequence;
+    // Microseconds; see InputFrameSample::timestamp
+    uint64_t timestamp;
+    OTDIPC::Messages::State state;
+  };
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+  static_assert(sizeof(Slot) == 64);
+
+  struct Layout {
+    // Written last by the writer; readers reject mappings that don't match
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slotSize;
+
+    // Sequence number of the most recently published record; the first
+    // record is 1
+    alignas(64) std::atomic<uint64_t> writeSequence;
+
+    // Incremented on every wake; readers wait on this with `futex()`, where
+    // available, and otherwise until it changes
+    alignas(64) std::atomic<uint32_t> wakeCount;
+    std::atomic<uint32_t> waiterCount;
+
+    Slot slots[Capacity];
+  };
+
+  struct Record {
+    uint64_t mSequence {};
+    uint64_t mTimestamp {};
+    OTDIPC::Messages::State mState {};
+  };
+
+  enum class Disposition {
+    Read,
+    Write,
+  };
+
+  SharedStateRing() = delete;
+  SharedStateRing(Disposition, std::string name);
+  ~SharedStateRing();
+
+  SharedStateRing(const SharedStateRing&) = delete;
+  SharedStateRing& operator=(const SharedStateRing&) = delete;
+
+  // Writer: publish a record. Readers aren't woken until `Wake()`
+  void Push(const OTDIPC::Messages::State&, uint64_t timestamp);
+  // Writer: wake any readers that are blocked in `Wait()`
+  void Wake();
+
+  // Reader: the next record, if one has been published since the last call.
+  //
+  // Newly-opened readers start at the most recently published record.
+  // Records that are overwritten before they can be read count as overruns;
+  // returns nullopt after `MaxReadAttempts` of them, without waiting for the
+  // writer.
+  [[nodiscard]]
+  std::optional<Record> TryRead();
+  // Reader: wait until `TryRead()` is likely to return a record
+  //
+  // Returns false on timeout
+  [[nodiscard]]
+  bool Wait(std::chrono::milliseconds timeout);
+  // Reader: the total number of records that were overwritten before this
+  // reader could read them
+  [[nodiscard]]
+  uint64_t GetOverrunCount() const;
+
+  [[nodiscard]]
+  const std::string& GetName() const;
+
+ private:
+  struct Platform;
+
+  std::string mName;
+  Disposition mDisposition;
+  std::unique_ptr<Platform> mPlatform;
+  Layout* mLayout {nullptr};
+
+  // Writer: next sequence number to publish
+  // Reader: next sequence number to read
+  uint64_t mNextSequence {1};
+  uint64_t mOverrunCount {};
+};
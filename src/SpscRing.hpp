@@ -0,0 +1,98 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+
+// Bounded lock-free queue for exactly one producer thread and exactly one
+// consumer thread.
+//
+// Neither side ever blocks; the producer gets `false` back if the ring is
+// full, and it's up to the caller to decide what to drop.
+template <class T, std::size_t Capacity>
+  requires(std::has_single_bit(Capacity) && std::is_trivially_copyable_v<T>)
+class SpscRing final {
+ public:
+  SpscRing() = default;
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing(SpscRing&&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+  SpscRing& operator=(SpscRing&&) = delete;
+
+  // Producer only
+  [[nodiscard]]
+  bool TryPush(const T& value) noexcept {
+    const auto tail = mTail.load(std::memory_order_relaxed);
+    if (tail - mCachedHead == Capacity) {
+      mCachedHead = mHead.load(std::memory_order_acquire);
+      if (tail - mCachedHead == Capacity) {
+        return false;
+      }
+    }
+    mSlots[tail & Mask] = value;
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only
+  [[nodiscard]]
+  bool TryPop(T& value) noexcept {
+    const auto head = mHead.load(std::memory_order_relaxed);
+    if (head == mCachedTail) {
+      mCachedTail = mTail.load(std::memory_order_acquire);
+      if (head == mCachedTail) {
+        return false;
+      }
+    }
+    value = mSlots[head & Mask];
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only; invokes `f` on everything that is currently queued, then
+  // releases the slots back to the producer in one go.
+  //
+  // Returns the number of items consumed.
+  template <std::invocable<const T&> F>
+  std::size_t ConsumeAll(F&& f) {
+    const auto head = mHead.load(std::memory_order_relaxed);
+    mCachedTail = mTail.load(std::memory_order_acquire);
+    for (auto it = head; it != mCachedTail; ++it) {
+      f(mSlots[it & Mask]);
+    }
+    mHead.store(mCachedTail, std::memory_order_release);
+    return mCachedTail - head;
+  }
+
+  // Only a snapshot; may be stale by the time it returns
+  [[nodiscard]]
+  bool empty() const noexcept {
+    return mHead.load(std::memory_order_acquire)
+      == mTail.load(std::memory_order_acquire);
+  }
+
+  static constexpr std::size_t capacity() noexcept {
+    return Capacity;
+  }
+
+ private:
+  static constexpr std::size_t Mask = Capacity - 1;
+  // Keep the producer's and consumer's data on separate cache lines
+  static constexpr std::size_t CacheLineSize = 64;
+
+  // Written by the consumer
+  alignas(CacheLineSize) std::atomic<std::size_t> mHead {0};
+  std::size_t mCachedTail {0};
+
+  // Written by the producer
+  alignas(CacheLineSize) std::atomic<std::size_t> mTail {0};
+  std::size_t mCachedHead {0};
+
+  alignas(CacheLineSize) std::array<T, Capacity> mSlots {};
+};
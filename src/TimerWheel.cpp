@@ -0,0 +1,187 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "TimerWheel.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+// Index of the first occupied slot at or after `from`, or `SlotCount`
+template <std::size_t N>
+std::size_t FindOccupied(
+  const std::array<uint64_t, N>& occupied,
+  const std::size_t from) {
+  for (auto word = from / 64; word < N; ++word) {
+    auto bits = occupied[word];
+    if (word == from / 64) {
+      bits &= ~uint64_t {} << (from % 64);
+    }
+    if (bits) {
+      return (word * 64) + std::countr_zero(bits);
+    }
+  }
+  return N * 64;
+}
+}// namespace
+
+TimerWheel::TimerWheel(const Clock::time_point now) : mEpoch(now) {
+}
+
+void TimerWheel::Add(
+  const uint64_t id,
+  const Clock::time_point due,
+  const Clock::duration interval,
+  Callback callback) {
+  // Ticks before `mNextTick` have already been processed
+  const auto tick = std::max(ToDueTick(due), mNextTick);
+  mTimers.emplace(
+    id,
+    Timer {
+      .mCallback = std::move(callback),
+      .mDue = tick,
+      .mInterval = interval,
+    });
+  Insert(id, tick);
+}
+
+void TimerWheel::Cancel(const uint64_t id) {
+  if (mFiring == id) {
+    mFiringCancelled = true;
+    return;
+  }
+  const auto it = mTimers.find(id);
+  if (it == mTimers.end()) {
+    return;
+  }
+  Unlink(id, it->second.mDue);
+  mTimers.erase(it);
+}
+
+void TimerWheel::Advance(const Clock::time_point time) {
+  const auto now = ToTick(time);
+  if (now < mNextTick) {
+    return;
+  }
+
+  // Collect before running anything, so callbacks can freely add and cancel
+  // timers; anything they add is due after `now`. After sleeping for more
+  // than a revolution, every slot is visited once.
+  mDue.clear();
+  const auto count = std::min<Tick>(now - mNextTick + 1, SlotCount);
+  for (Tick i = 0; i < count; ++i) {
+    const auto slot = (mNextTick + i) % SlotCount;
+    if (!(mOccupied[slot / 64] & (uint64_t {1} << (slot % 64)))) {
+      continue;
+    }
+    for (const auto id: mSlots[slot]) {
+      if (mTimers.at(id).mDue <= now) {
+        mDue.push_back(id);
+      }
+    }
+  }
+  mNextTick = now + 1;
+
+  for (const auto id: mDue) {
+    // May have been cancelled by an earlier callback
+    const auto it = mTimers.find(id);
+    if (it == mTimers.end()) {
+      continue;
+    }
+    auto& timer = it->second;
+    Unlink(id, timer.mDue);
+
+    mFiring = id;
+    mFiringCancelled = false;
+    timer.mCallback();
+    mFiring.reset();
+
+    // `timer` is still valid: the map may have rehashed, but nodes are stable,
+    // and cancelling the firing timer is deferred
+    if (mFiringCancelled || timer.mInterval == Clock::duration::zero()) {
+      mTimers.erase(id);
+      continue;
+    }
+    const auto interval = static_cast<Tick>(std::max<int64_t>(
+      1,
+      std::chrono::ceil<std::chrono::milliseconds>(timer.mInterval).count()));
+    timer.mDue += interval;
+    if (timer.mDue <= now) {
+      // Don't try to catch up if we've fallen behind
+      timer.mDue = now + interval;
+    }
+    Insert(id, timer.mDue);
+  }
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::GetNextDue() const {
+  // Slots are visited in tick order, starting at `mNextTick`; the first
+  // timer that's due in this revolution is the next one. Timers on a later
+  // lap are only used if there's nothing sooner.
+  std::optional<Tick> next;
+  const auto revolutionEnd = mNextTick + SlotCount;
+  const auto visit = [&](const std::size_t slot) {
+    for (const auto id: mSlots[slot]) {
+      const auto due = mTimers.at(id).mDue;
+      next = std::min(next.value_or(due), due);
+    }
+    return *next < revolutionEnd;
+  };
+
+  const auto start = mNextTick % SlotCount;
+  for (auto slot = FindOccupied(mOccupied, start); slot < SlotCount;
+       slot = FindOccupied(mOccupied, slot + 1)) {
+    if (visit(slot)) {
+      return ToTimePoint(*next);
+    }
+  }
+  for (auto slot = FindOccupied(mOccupied, 0); slot < start;
+       slot = FindOccupied(mOccupied, slot + 1)) {
+    if (visit(slot)) {
+      return ToTimePoint(*next);
+    }
+  }
+  if (next) {
+    return ToTimePoint(*next);
+  }
+  return std::nullopt;
+}
+
+TimerWheel::Tick TimerWheel::ToTick(const Clock::time_point time) const {
+  if (time <= mEpoch) {
+    return 0;
+  }
+  return static_cast<Tick>(
+    std::chrono::floor<std::chrono::milliseconds>(time - mEpoch).count());
+}
+
+TimerWheel::Tick TimerWheel::ToDueTick(const Clock::time_point time) const {
+  if (time <= mEpoch) {
+    return 0;
+  }
+  return static_cast<Tick>(
+    std::chrono::ceil<std::chrono::milliseconds>(time - mEpoch).count());
+}
+
+TimerWheel::Clock::time_point TimerWheel::ToTimePoint(const Tick tick) const {
+  return mEpoch + (tick * Resolution);
+}
+
+void TimerWheel::Insert(const uint64_t id, const Tick due) {
+  const auto slot = due % SlotCount;
+  mSlots[slot].push_back(id);
+  mOccupied[slot / 64] |= uint64_t {1} << (slot % 64);
+}
+
+void TimerWheel::Unlink(const uint64_t id, const Tick due) {
+  const auto slot = due % SlotCount;
+  auto& ids = mSlots[slot];
+  const auto it = std::ranges::find(ids, id);
+  if (it == ids.end()) {
+    return;
+  }
+  *it = ids.back();
+  ids.pop_back();
+  if (ids.empty()) {
+    mOccupied[slot / 64] &= ~(uint64_t {1} << (slot % 64));
+  }
+}
@@ -0,0 +1,84 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Hashed timer wheel with millisecond resolution; adding, cancelling, and
+// firing a timer are O(1), and finding the next deadline only looks at
+// occupied slots, so the owner can sleep until exactly then.
+//
+// Not thread-safe; the reactor owns one, and only uses it on its thread.
+class TimerWheel final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+
+  // 4 seconds per revolution; timers further out just take more laps
+  static constexpr std::size_t SlotCount = 4096;
+  static constexpr auto Resolution = std::chrono::milliseconds(1);
+
+  explicit TimerWheel(Clock::time_point now = Clock::now());
+
+  // `id` must be unique among active timers; it's the caller's handle for
+  // `Cancel()`. If `interval` is non-zero, the timer repeats.
+  void Add(
+    uint64_t id,
+    Clock::time_point due,
+    Clock::duration interval,
+    Callback);
+  // Safe to call from a timer's own callback
+  void Cancel(uint64_t id);
+
+  // Runs every callback that's due at or before `now`
+  void Advance(Clock::time_point now);
+
+  [[nodiscard]]
+  std::optional<Clock::time_point> GetNextDue() const;
+
+  [[nodiscard]]
+  bool empty() const noexcept {
+    return mTimers.empty();
+  }
+
+ private:
+  using Tick = uint64_t;
+
+  struct Timer {
+    Callback mCallback;
+    Tick mDue {};
+    Clock::duration mInterval {};
+  };
+
+  [[nodiscard]]
+  Tick ToTick(Clock::time_point) const;
+  // Rounded up, so that a timer never fires early
+  [[nodiscard]]
+  Tick ToDueTick(Clock::time_point) const;
+  [[nodiscard]]
+  Clock::time_point ToTimePoint(Tick) const;
+
+  void Insert(uint64_t id, Tick due);
+  void Unlink(uint64_t id, Tick due);
+
+  Clock::time_point mEpoch;
+  // The first tick that hasn't been processed yet
+  Tick mNextTick {};
+
+  std::unordered_map<uint64_t, Timer> mTimers;
+  std::array<std::vector<uint64_t>, SlotCount> mSlots;
+  // One bit per non-empty slot
+  std::array<uint64_t, SlotCount / 64> mOccupied {};
+
+  // The timer whose callback is running, if any; cancelling it is deferred
+  // until the callback returns
+  std::optional<uint64_t> mFiring;
+  bool mFiringCancelled {false};
+  std::vector<uint64_t> mDue;
+};
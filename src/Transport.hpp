@@ -0,0 +1,61 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <variant>
+
+#include "Reactor.hpp"
+
+// Byte streams for the servers; the protocol (handshake, framing, pings)
+// lives in the servers, so that it can be run - and benchmarked - on any
+// backend.
+//
+// Nothing here blocks; the servers watch `GetWaitable()` with the `Reactor`.
+namespace Transport {
+
+struct connection_closed_t {};
+inline constexpr connection_closed_t connection_closed;
+
+using Error = std::variant<connection_closed_t, std::error_code>;
+
+class IConnection {
+ public:
+  virtual ~IConnection() = default;
+
+  // Ready when there may be data to receive, or the peer has disconnected
+  [[nodiscard]]
+  virtual Reactor::Waitable GetWaitable() const = 0;
+
+  // Returns the number of bytes taken by the transport, which is 0 if its
+  // buffers are full
+  [[nodiscard]]
+  virtual std::expected<std::size_t, Error> TrySend(
+    std::span<const std::byte>)
+    = 0;
+
+  // Returns the number of bytes received, which is 0 if there's nothing to
+  // read; fails with `connection_closed` if the peer has disconnected
+  [[nodiscard]]
+  virtual std::expected<std::size_t, Error> TryReceive(std::span<std::byte>)
+    = 0;
+};
+
+class IListener {
+ public:
+  virtual ~IListener() = default;
+
+  // Ready when a client may be waiting
+  [[nodiscard]]
+  virtual Reactor::Waitable GetWaitable() const = 0;
+
+  // Returns nullptr if no client is waiting, or on failure
+  [[nodiscard]]
+  virtual std::unique_ptr<IConnection> TryAccept() = 0;
+};
+
+}// namespace Transport
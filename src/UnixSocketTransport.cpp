@@ -0,0 +1,325 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "UnixSocketTransport.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "Log.hpp"
+
+#ifdef _WIN32
+// clang-format off
+#include <Windows.h>
+#include <winsock2.h>// needed for wil/resource.h to define unique_socket
+#include <afunix.h>
+#include <wil/resource.h>
+#include <wil/result.h>
+// clang-format on
+
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+using UniqueSocket = wil::unique_socket;
+constexpr int SendFlags = 0;
+
+int GetLastSocketError() {
+  return WSAGetLastError();
+}
+
+bool IsRetryable(const int error) {
+  return error == WSAEWOULDBLOCK;
+}
+
+bool IsConnectionReset(const int error) {
+  return error == WSAECONNRESET;
+}
+
+// Sockets are watched with `WSAEventSelect()`, which also makes them
+// non-blocking
+class SocketEvent final {
+ public:
+  SocketEvent() {
+    mEvent.reset(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+    THROW_LAST_ERROR_IF_NULL(mEvent);
+  }
+
+  // Returns false on failure
+  bool Select(const SOCKET socket, const long events) {
+    return WSAEventSelect(socket, mEvent.get(), events) != SOCKET_ERROR;
+  }
+
+  // Reset the event before reading or accepting; if there's more to do
+  // afterwards, WinSock sets it again
+  void Reset(const SOCKET socket) {
+    WSANETWORKEVENTS events {};
+    WSAEnumNetworkEvents(socket, mEvent.get(), &events);
+  }
+
+  Reactor::Waitable GetWaitable(SOCKET) const {
+    return mEvent.get();
+  }
+
+ private:
+  wil::unique_event mEvent;
+};
+
+constexpr long ConnectionEvents = FD_READ | FD_CLOSE;
+constexpr long ListenerEvents = FD_ACCEPT;
+
+// WinSock is reference-counted; every listener and connection holds a
+// reference, so connections can outlive their listener
+struct WinSockSession {
+  WinSockSession() {
+    WSADATA wsaData;
+    if (const auto result = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+      THROW_HR(HRESULT_FROM_WIN32(result));
+    }
+  }
+  ~WinSockSession() {
+    WSACleanup();
+  }
+  WinSockSession(const WinSockSession&) = delete;
+  WinSockSession& operator=(const WinSockSession&) = delete;
+};
+#else
+class UniqueSocket {
+ public:
+  UniqueSocket() = default;
+  explicit UniqueSocket(const int fd) : mFD(fd) {
+  }
+  UniqueSocket(UniqueSocket&& other) noexcept
+    : mFD(std::exchange(other.mFD, -1)) {
+  }
+  UniqueSocket& operator=(UniqueSocket&& other) noexcept {
+    reset(std::exchange(other.mFD, -1));
+    return *this;
+  }
+  ~UniqueSocket() {
+    reset();
+  }
+
+  [[nodiscard]]
+  int get() const noexcept {
+    return mFD;
+  }
+
+  void reset(const int fd = -1) noexcept {
+    if (mFD >= 0) {
+      close(mFD);
+    }
+    mFD = fd;
+  }
+
+  explicit operator bool() const noexcept {
+    return mFD >= 0;
+  }
+
+ private:
+  int mFD {-1};
+};
+
+// Don't raise SIGPIPE if the client has gone away
+constexpr int SendFlags = MSG_NOSIGNAL;
+
+int GetLastSocketError() {
+  return errno;
+}
+
+bool IsRetryable(const int error) {
+  return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+
+bool IsConnectionReset(const int error) {
+  return error == ECONNRESET;
+}
+
+// Sockets are level-triggered, so the descriptor can be watched directly
+class SocketEvent final {
+ public:
+  // Returns false on failure
+  bool Select(const int fd, long) {
+    const auto flags = fcntl(fd, F_GETFL);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+  }
+
+  void Reset(int) {
+  }
+
+  Reactor::Waitable GetWaitable(const int fd) const {
+    return fd;
+  }
+};
+
+constexpr long ConnectionEvents = 0;
+constexpr long ListenerEvents = 0;
+#endif
+
+std::error_code GetLastSocketErrorCode() {
+  return {GetLastSocketError(), std::system_category()};
+}
+
+[[noreturn]]
+void ThrowLastSocketError(const char* what) {
+  throw std::system_error(GetLastSocketErrorCode(), what);
+}
+
+class UnixSocketConnection final : public Transport::IConnection {
+ public:
+  // Returns nullptr on failure
+  static std::unique_ptr<UnixSocketConnection> Create(UniqueSocket socket) {
+    auto ret = std::unique_ptr<UnixSocketConnection>(
+      new UnixSocketConnection(std::move(socket)));
+    if (!ret->mEvent.Select(ret->mSocket.get(), ConnectionEvents)) {
+      Log::Error(
+        "Failed to make client socket non-blocking: {}",
+        GetLastSocketErrorCode().message());
+      return nullptr;
+    }
+    return ret;
+  }
+
+  Reactor::Waitable GetWaitable() const override {
+    return mEvent.GetWaitable(mSocket.get());
+  }
+
+  std::expected<std::size_t, Transport::Error> TrySend(
+    const std::span<const std::byte> data) override {
+    const auto result = send(
+      mSocket.get(),
+      reinterpret_cast<const char*>(data.data()),
+      static_cast<int>(data.size()),
+      SendFlags);
+    if (result < 0) {
+      const auto error = GetLastSocketError();
+      if (IsRetryable(error)) {
+        return 0;
+      }
+      return std::unexpected {std::error_code(error, std::system_category())};
+    }
+    return static_cast<std::size_t>(result);
+  }
+
+  std::expected<std::size_t, Transport::Error> TryReceive(
+    const std::span<std::byte> buffer) override {
+    mEvent.Reset(mSocket.get());
+    const auto result = recv(
+      mSocket.get(),
+      reinterpret_cast<char*>(buffer.data()),
+      static_cast<int>(buffer.size()),
+      0);
+    if (result == 0) {
+      return std::unexpected {Transport::connection_closed};
+    }
+    if (result < 0) {
+      const auto error = GetLastSocketError();
+      if (IsRetryable(error)) {
+        return 0;
+      }
+      if (IsConnectionReset(error)) {
+        return std::unexpected {Transport::connection_closed};
+      }
+      return std::unexpected {std::error_code(error, std::system_category())};
+    }
+    return static_cast<std::size_t>(result);
+  }
+
+ private:
+#ifdef _WIN32
+  WinSockSession mWinSock;
+#endif
+  // Declared first so the socket is closed before its event
+  SocketEvent mEvent;
+  UniqueSocket mSocket;
+
+  explicit UnixSocketConnection(UniqueSocket socket)
+    : mSocket(std::move(socket)) {
+  }
+};
+
+class UnixSocketListener final : public Transport::IListener {
+ public:
+  explicit UnixSocketListener(const std::filesystem::path& path) {
+    mSocket = UniqueSocket(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (!mSocket) {
+      ThrowLastSocketError("socket()");
+    }
+
+    std::error_code ec;
+    // Ensure parent directory exists for socket
+    std::filesystem::create_directories(path.parent_path(), ec);
+    // Delete any existing socket file (Unix socket requirement). `exists()`
+    // is unusable on Unix sockets on Windows, so unconditionally remove and
+    // ignore error https://github.com/microsoft/STL/issues/4077
+    std::filesystem::remove(path, ec);
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+
+    // Copy path to sun_path (max 108 chars usually), leaving a trailing NUL
+    const auto pathStr = path.string();
+    if (pathStr.length() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error("Socket path is too long for AF_UNIX");
+    }
+    std::ranges::copy(pathStr, addr.sun_path);
+
+    if (
+      bind(mSocket.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+      != 0) {
+      ThrowLastSocketError("bind()");
+    }
+
+    if (listen(mSocket.get(), SOMAXCONN) != 0) {
+      ThrowLastSocketError("listen()");
+    }
+
+    if (!mEvent.Select(mSocket.get(), ListenerEvents)) {
+      ThrowLastSocketError("Making listen socket non-blocking");
+    }
+  }
+
+  Reactor::Waitable GetWaitable() const override {
+    return mEvent.GetWaitable(mSocket.get());
+  }
+
+  std::unique_ptr<Transport::IConnection> TryAccept() override {
+    mEvent.Reset(mSocket.get());
+    UniqueSocket socket(accept(mSocket.get(), nullptr, nullptr));
+    if (!socket) {
+      if (const auto error = GetLastSocketError(); !IsRetryable(error)) {
+        Log::Error(
+          "Accepting a client failed: {}",
+          std::system_category().message(error));
+      }
+      return nullptr;
+    }
+    return UnixSocketConnection::Create(std::move(socket));
+  }
+
+ private:
+#ifdef _WIN32
+  WinSockSession mWinSock;
+#endif
+  // Declared first so the socket is closed before its event
+  SocketEvent mEvent;
+  UniqueSocket mSocket;
+};
+
+}// namespace
+
+std::unique_ptr<Transport::IListener> CreateUnixSocketListener(
+  const std::filesystem::path& path) {
+  return std::make_unique<UnixSocketListener>(path);
+}
@@ -0,0 +1,15 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include "Transport.hpp"
+
+// AF_UNIX stream sockets; WinSock on Windows, BSD sockets elsewhere.
+//
+// Anything already at `path` is replaced, and the parent directory is
+// created if needed.
+std::unique_ptr<Transport::IListener> CreateUnixSocketListener(
+  const std::filesystem::path& path);
@@ -0,0 +1,110 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "V1Connection.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <OTDIPC/V1/Header.hpp>
+
+namespace {
+uint32_t GetMessageSize(const std::span<const std::byte> messages) {
+  OTDIPC::V1::Messages::Header header {};
+  std::memcpy(&header, messages.data(), sizeof(header));
+  return header.size;
+}
+}// namespace
+
+V1Connection::V1Connection(IPipe& pipe) : mPipe(pipe) {
+}
+
+void V1Connection::Start() {
+  if (mStatus == Status::Stopped) {
+    Listen();
+  }
+}
+
+void V1Connection::Stop() {
+  if (mStatus == Status::Stopped) {
+    return;
+  }
+  mPipe.Disconnect();
+  mStatus = Status::Stopped;
+  mIsWriting = false;
+  mWriting.clear();
+  mQueued.clear();
+}
+
+bool V1Connection::Queue(const std::span<const std::byte> message) {
+  if (
+    message.size() < sizeof(OTDIPC::V1::Messages::Header)
+    || GetMessageSize(message) != message.size()) {
+    throw std::logic_error("header size mismatch");
+  }
+
+  if (mStatus != Status::Connected) {
+    return false;
+  }
+  if (mWriting.size() + mQueued.size() + message.size() > MaxBacklog) {
+    return false;
+  }
+
+  // `mQueued` is always empty if we're not writing
+  auto& buffer = mIsWriting ? mQueued : mWriting;
+  buffer.Append(message.data(), message.size());
+  return true;
+}
+
+void V1Connection::Pump() {
+  if (mIsWriting || mStatus != Status::Connected) {
+    return;
+  }
+  if (mWriting.empty()) {
+    std::swap(mWriting, mQueued);
+  }
+  if (mWriting.empty()) {
+    return;
+  }
+
+  const auto pending = mWriting.GetPending();
+  mIsWriting = true;
+  if (!mPipe.BeginWrite(pending.first(GetMessageSize(pending)))) {
+    OnDisconnected();
+  }
+}
+
+void V1Connection::OnConnected() {
+  if (mStatus == Status::Listening) {
+    mStatus = Status::Connected;
+  }
+}
+
+void V1Connection::OnWriteComplete() {
+  if (!mIsWriting) {
+    // Already disconnected
+    return;
+  }
+  mIsWriting = false;
+  mWriting.Consume(GetMessageSize(mWriting.GetPending()));
+  Pump();
+}
+
+void V1Connection::OnDisconnected() {
+  if (mStatus == Status::Stopped) {
+    return;
+  }
+  mPipe.Disconnect();
+  mIsWriting = false;
+  mWriting.clear();
+  mQueued.clear();
+  Listen();
+}
+
+V1Connection::Status V1Connection::GetStatus() const noexcept {
+  return mStatus;
+}
+
+void V1Connection::Listen() {
+  mStatus = mPipe.BeginConnect() ? Status::Listening : Status::Stopped;
+}
@@ -0,0 +1,86 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "SendBuffer.hpp"
+
+// Lifecycle and write queue of the single OTD-IPC v1 client.
+//
+// This is separate from the overlapped named pipe I/O that drives it, so it
+// can be exercised against a fake pipe on any platform.
+//
+// Not thread-safe; V1Server only calls it with its mutex held.
+class V1Connection final {
+ public:
+  class IPipe {
+   public:
+    virtual ~IPipe() = default;
+
+    // Start waiting for a client; returns false on failure, otherwise the
+    // owner later calls `OnConnected()` or `OnDisconnected()`
+    [[nodiscard]]
+    virtual bool BeginConnect() = 0;
+
+    // Start writing a single message; `message` remains valid until the owner
+    // calls `OnWriteComplete()` or `OnDisconnected()`. Returns false on
+    // failure.
+    [[nodiscard]]
+    virtual bool BeginWrite(std::span<const std::byte> message) = 0;
+
+    // Drop the client, cancelling any pending I/O
+    virtual void Disconnect() = 0;
+  };
+
+  enum class Status {
+    Stopped,
+    Listening,
+    Connected,
+  };
+
+  // If the client isn't reading, messages are dropped once this much is
+  // queued
+  static constexpr std::size_t MaxBacklog = 64 * 1024;
+
+  V1Connection() = delete;
+  explicit V1Connection(IPipe&);
+
+  void Start();
+  void Stop();
+
+  // Returns false if the message was dropped, as there is no client, or
+  // it isn't keeping up. Nothing is written until `Pump()`.
+  bool Queue(std::span<const std::byte> message);
+  template <class T>
+    requires(!std::is_pointer_v<T> && std::is_trivially_copyable_v<T>)
+  bool Queue(const T& message) {
+    return Queue(std::as_bytes(std::span {&message, 1}));
+  }
+
+  // Start writing the next queued message, if there isn't one in flight
+  void Pump();
+
+  void OnConnected();
+  void OnWriteComplete();
+  // Also used for failed connections; starts listening for the next client
+  void OnDisconnected();
+
+  [[nodiscard]]
+  Status GetStatus() const noexcept;
+
+ private:
+  IPipe& mPipe;
+  Status mStatus {Status::Stopped};
+
+  // Only one write is in flight at a time, as each write is a message on the
+  // pipe. Messages queued while writing go to `mQueued`, so the memory being
+  // written from is never reallocated.
+  bool mIsWriting {false};
+  SendBuffer mWriting {MaxBacklog};
+  SendBuffer mQueued {MaxBacklog};
+
+  void Listen();
+};
@@ -3,161 +3,340 @@
 #include "V1Server.hpp"
 
 #include <algorithm>
-#include <bit>
 #include <wil/resource.h>
+#include "InputFrame.hpp"
+#include "Log.hpp"
+#include "V1Translation.hpp"
 #include "utf8.hpp"
 
 #include <functional>
-#include <print>
-#include <stdexcept>
+#include <tuple>
+#include <utility>
 
 #include <OTDIPC/V1/NamedPipePath.hpp>
 #include <OTDIPC/V1/Ping.hpp>
 
 namespace {
-template <std::derived_from<OTDIPC::V1::Messages::Header> T>
-T CreateMessage(uint16_t vid, uint16_t pid, std::size_t size = sizeof(T)) {
-  T ret {};
-  ret.messageType = T::MESSAGE_TYPE;
-  ret.size = static_cast<uint32_t>(size);
-  ret.vid = vid;
-  ret.pid = pid;
-  return ret;
-}
+// Clients are pinged if nothing else has been written for this long
+constexpr auto PingInterval = std::chrono::seconds(1);
+}// namespace
 
-std::pair<uint16_t, uint16_t> SynthesizeVidPid(
-  const std::string_view persistentId) {
-  // Use FNV-1a to generate a 32-bit hash
-  // Magic numbers from the algorithm
-  constexpr uint32_t OffsetBasis = 0x811c9dc5;
-  constexpr uint32_t Prime = 0x01000193;
+struct V1Server::Pipe final : V1Connection::IPipe {
+  struct Operation {
+    // Manual-reset, as required for overlapped I/O
+    wil::unique_event mEvent;
+    OVERLAPPED mOverlapped {};
+    bool mIsPending {false};
 
-  uint32_t hash = OffsetBasis;
-  for (const auto c: persistentId) {
-    hash ^= std::bit_cast<uint8_t>(c);
-    hash *= Prime;
+    Operation() {
+      mEvent.reset(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+      THROW_LAST_ERROR_IF_NULL(mEvent);
+    }
+
+    OVERLAPPED* Begin() {
+      mOverlapped = {};
+      mOverlapped.hEvent = mEvent.get();
+      mIsPending = true;
+      return &mOverlapped;
+    }
+  };
+
+  wil::unique_hfile mHandle;
+  Operation mConnect;
+  Operation mRead;
+  Operation mWrite;
+  std::byte mReadBuffer {};
+
+  // Returns false if another instance owns the pipe
+  bool Create() {
+    mHandle.reset(CreateNamedPipeW(
+      OTDIPC::V1::NamedPipePathW,
+      PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE | FILE_FLAG_OVERLAPPED,
+      PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT
+        | PIPE_REJECT_REMOTE_CLIENTS,
+      1,// Max instances
+      8192,// Out buffer size
+      0,// In buffer size (outbound only)
+      0,// Default timeout
+      nullptr));
+    if (mHandle) {
+      return true;
+    }
+    const auto error = GetLastError();
+    if (error == ERROR_ACCESS_DENIED || error == ERROR_PIPE_BUSY) {
+      return false;
+    }
+    THROW_LAST_ERROR();
   }
 
-  return {
-    static_cast<uint16_t>(hash & 0xFFFF),
-    static_cast<uint16_t>((hash >> 16) & 0xFFFF)};
-}
-}// namespace
+  void Close() {
+    Disconnect();
+    mHandle.reset();
+  }
 
-V1Server::V1Server() = default;
+  bool BeginConnect() override {
+    if (ConnectNamedPipe(mHandle.get(), mConnect.Begin())) {
+      return true;
+    }
+    switch (GetLastError()) {
+      case ERROR_IO_PENDING:
+        return true;
+      case ERROR_PIPE_CONNECTED:
+        // A client connected before we started waiting, so there's no I/O to
+        // complete; `Complete()` treats this as success
+        mConnect.mIsPending = false;
+        mConnect.mEvent.SetEvent();
+        return true;
+      default:
+        mConnect.mIsPending = false;
+        return false;
+    }
+  }
+
+  // V1 clients never write, so this only completes when they disconnect
+  bool BeginWaitForDisconnect() {
+    if (ReadFile(
+          mHandle.get(), &mReadBuffer, sizeof(mReadBuffer), nullptr,
+          mRead.Begin())) {
+      return true;
+    }
+    if (GetLastError() == ERROR_IO_PENDING) {
+      return true;
+    }
+    mRead.mIsPending = false;
+    return false;
+  }
+
+  bool BeginWrite(const std::span<const std::byte> message) override {
+    if (WriteFile(
+          mHandle.get(),
+          message.data(),
+          static_cast<DWORD>(message.size()),
+          nullptr,
+          mWrite.Begin())) {
+      return true;
+    }
+    if (GetLastError() == ERROR_IO_PENDING) {
+      return true;
+    }
+    mWrite.mIsPending = false;
+    return false;
+  }
+
+  void Disconnect() override {
+    CancelIoEx(mHandle.get(), nullptr);
+    for (auto op: {&mConnect, &mRead, &mWrite}) {
+      if (op->mIsPending) {
+        // The OVERLAPPED must stay valid until the cancellation completes
+        DWORD bytes {};
+        GetOverlappedResult(mHandle.get(), &op->mOverlapped, &bytes, TRUE);
+        op->mIsPending = false;
+      }
+      op->mEvent.ResetEvent();
+    }
+    DisconnectNamedPipe(mHandle.get());
+  }
+
+  // Call once the operation's event is set; returns true on success
+  bool Complete(Operation& op) {
+    op.mEvent.ResetEvent();
+    if (!std::exchange(op.mIsPending, false)) {
+      return true;
+    }
+    DWORD bytes {};
+    return GetOverlappedResult(mHandle.get(), &op.mOverlapped, &bytes, FALSE);
+  }
+};
+
+V1Server::V1Server(Reactor& reactor)
+  : mReactor(reactor),
+    mPipe(std::make_unique<Pipe>()),
+    mConnection(*mPipe) {
+  mReactor.Invoke([this] {
+    mSendNotifier = mReactor.CreateNotifier([this] { SendPending(); });
+  });
+}
 
 V1Server::~V1Server() {
   Stop();
+  mReactor.Invoke([this] { mSendNotifier.reset(); });
 }
 
 void V1Server::Start() {
-  mAcceptThread = std::jthread(std::bind_front(&V1Server::AcceptLoop, this));
-  mPingThread = std::jthread(std::bind_front(&V1Server::PingLoop, this));
+  mReactor.Invoke([this] {
+    // The events outlive the pipe handle, so these don't need to change when
+    // the pipe is recreated
+    auto watch = [this](Pipe::Operation& op, void (V1Server::*handler)()) {
+      return mReactor.Watch(
+        op.mEvent.get(),
+        std::bind_front(&V1Server::OnPipeEvent, this, handler));
+    };
+    mConnectWatch = watch(mPipe->mConnect, &V1Server::OnConnect);
+    mReadWatch = watch(mPipe->mRead, &V1Server::OnRead);
+    mWriteWatch = watch(mPipe->mWrite, &V1Server::OnWrite);
+    mIsStarted = true;
+    TryCreatePipe();
+  });
 }
 
 void V1Server::Stop() {
-  mPingThread = {};
-  mAcceptThread = {};
-  mPipe.reset();
+  mReactor.Invoke([this] {
+    mIsStarted = false;
+    mPingTimer.reset();
+    mRetryTimer.reset();
+    mConnectWatch.reset();
+    mReadWatch.reset();
+    mWriteWatch.reset();
+
+    const std::unique_lock lock(mPipeMutex);
+    mConnection.Stop();
+    mPipe->Close();
+  });
 }
 
-void V1Server::AcceptLoop(const std::stop_token st) {
-  while (!st.stop_requested()) {
-    AcceptOnce(st);
+void V1Server::TryCreatePipe() {
+  if (!mPipe->Create()) {
+    // Another instance is already running
+    ScheduleRetry();
+    return;
   }
+  mRetryTimer.reset();
+
+  const std::unique_lock lock(mPipeMutex);
+  mConnection.Start();
+  PumpLocked();
 }
 
-void V1Server::AcceptOnce(const std::stop_token st) {
-  // Create named pipe instance
-  wil::unique_hfile pipe(CreateNamedPipeW(
-    OTDIPC::V1::NamedPipePathW,
-    PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE,
-    PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT
-      | PIPE_REJECT_REMOTE_CLIENTS,
-    1,// Max instances
-    8192,// Out buffer size
-    0,// In buffer size (outbound only)
-    0,// Default timeout
-    nullptr));
+void V1Server::OnPipeEvent(void (V1Server::*handler)()) {
+  const std::unique_lock lock(mPipeMutex);
+  (this->*handler)();
+  PumpLocked();
+}
 
-  if (!pipe) {
-    const auto error = GetLastError();
-    if (error == ERROR_ACCESS_DENIED || error == ERROR_PIPE_BUSY) {
-      // Another instance is already running
-      std::this_thread::sleep_for(std::chrono::seconds(1));
-      return;
-    }
-    THROW_LAST_ERROR();
+void V1Server::OnConnect() {
+  auto& pipe = *mPipe;
+  if (!pipe.Complete(pipe.mConnect)) {
+    mConnection.OnDisconnected();
+    return;
   }
-
-  // Wait for client connection
-  if (!ConnectNamedPipe(pipe.get(), nullptr)) {
-    const auto error = GetLastError();
-    if (error != ERROR_PIPE_CONNECTED) {
-      return;
-    }
+  mConnection.OnConnected();
+  if (mV1Device.isValid) {
+    SendLocked(mV1Device);
   }
+  if (!pipe.BeginWaitForDisconnect()) {
+    mConnection.OnDisconnected();
+  }
+}
 
-  mPipe = std::move(pipe);
-
-  // Send device info if present
-  if (mV1Device.isValid) {
-    Send(mV1Device);
+void V1Server::OnRead() {
+  auto& pipe = *mPipe;
+  if (pipe.Complete(pipe.mRead) && pipe.BeginWaitForDisconnect()) {
+    // Unexpected data from the client; ignore it
+    return;
   }
+  mConnection.OnDisconnected();
+}
 
-  // Keep pipe open until client disconnects or stop requested
-  // For V1, we just wait - there's no ping mechanism
-  while (!st.stop_requested() && mPipe) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+void V1Server::OnWrite() {
+  auto& pipe = *mPipe;
+  if (pipe.Complete(pipe.mWrite)) {
+    mConnection.OnWriteComplete();
+  } else {
+    mConnection.OnDisconnected();
+  }
+}
 
-    // Check if pipe is still connected
-    DWORD bytes {};
-    if (!PeekNamedPipe(mPipe.get(), nullptr, 0, nullptr, &bytes, nullptr)) {
-      // Pipe disconnected
-      break;
-    }
+void V1Server::PumpLocked() {
+  const auto status = mConnection.GetStatus();
+  // Only wake up for heartbeats while a client is connected
+  if (status != V1Connection::Status::Connected) {
+    mPingTimer.reset();
+  } else if (!mPingTimer) {
+    mPingTimer = mReactor.AddTimer(
+      PingInterval, std::bind_front(&V1Server::SendPing, this));
   }
 
-  mPipe.reset();
+  if (status != V1Connection::Status::Stopped) {
+    mConnection.Pump();
+    return;
+  }
+  if (mIsStarted && !mRetryTimer) {
+    // Couldn't listen for the next client; recreate the pipe
+    mPipe->Close();
+    ScheduleRetry();
+  }
 }
 
-void V1Server::PingLoop(const std::stop_token st) {
-  while (!st.stop_requested()) {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    auto msg
-      = CreateMessage<OTDIPC::V1::Messages::Ping>(mV1Device.vid, mV1Device.pid);
-    msg.sequenceNumber = ++mPingSequenceNumber;
-    Send(msg);
+void V1Server::ScheduleRetry() {
+  if (!mRetryTimer) {
+    mRetryTimer = mReactor.AddTimer(
+      std::chrono::seconds(1),
+      std::bind_front(&V1Server::TryCreatePipe, this));
   }
 }
 
-bool V1Server::SendRaw(const OTDIPC::V1::Messages::Header* data, size_t size) {
-  if (data->size != size) {
-    throw std::logic_error("header size mismatch");
+void V1Server::SendPing() {
+  // States show the client is alive, and a failed write disconnects it, so
+  // there's no need to ping while the pen is moving
+  if (LatencyHistogram::Clock::now() - mLastStateSentAt < PingInterval) {
+    return;
   }
 
-  if (!mPipe) {
-    return false;
+  const std::unique_lock lock(mPipeMutex);
+  auto msg = CreateMessage<OTDIPC::V1::Messages::Ping>(
+    mV1Device.vid, mV1Device.pid);
+  msg.sequenceNumber = ++mPingSequenceNumber;
+  if (SendLocked(msg)) {
+    PumpLocked();
   }
+}
 
-  DWORD written = 0;
-  if (!WriteFile(
-        mPipe.get(), data, static_cast<DWORD>(size), &written, nullptr)) {
-    mPipe.reset();
-    return false;
+void V1Server::SendPending() {
+  {
+    const std::unique_lock lock(mPipeMutex);
+    auto& latency = GetLatencyHistogram(LatencyStage::V1Send);
+    auto& endToEnd = GetLatencyHistogram(LatencyStage::EndToEnd);
+    mStateQueue.ConsumeAll([&](const auto& it) {
+      if (it.mState.nonPersistentTabletId != mTabletId) {
+        return;
+      }
+      if (SendStateLocked(it.mState)) {
+        mLastStateSentAt = LatencyHistogram::Clock::now();
+        latency.Record(mLastStateSentAt - it.mQueuedAt);
+        if (it.mArrivedAt != LatencyHistogram::Clock::time_point {}) {
+          endToEnd.Record(mLastStateSentAt - it.mArrivedAt);
+        }
+      }
+    });
+    PumpLocked();
   }
 
-  return written == size;
+  const auto dropCount = mDroppedStateCount.load(std::memory_order_relaxed);
+  if (dropCount != mReportedDropCount) {
+    Log::Error(
+      "Dropped {} states as the reactor isn't keeping up",
+      dropCount - mReportedDropCount);
+    mReportedDropCount = dropCount;
+  }
+}
+
+bool V1Server::SendRawLocked(
+  const OTDIPC::V1::Messages::Header* data,
+  size_t size) {
+  return mConnection.Queue({reinterpret_cast<const std::byte*>(data), size});
 }
 
 void V1Server::SetDevice(const OTDIPC::V2::Messages::DeviceInfo& device) {
-  const auto [vid, pid] = SynthesizeVidPid(device.GetPersistentId());
+  std::unique_lock lock(mPipeMutex);
+  if (!mTabletId) {
+    mTabletId = device.nonPersistentTabletId;
+  } else if (device.nonPersistentTabletId != *mTabletId) {
+    Log::Info(
+      "OTD-IPC v1 only supports one tablet; ignoring `{}`", device.GetName());
+    return;
+  }
 
-  mV1Device = CreateMessage<OTDIPC::V1::Messages::DeviceInfo>(vid, pid);
-  mV1Device.isValid = true;
-  mV1Device.maxX = device.maxX;
-  mV1Device.maxY = device.maxY;
-  mV1Device.maxPressure = device.maxPressure;
+  mV1Device = ToV1DeviceInfo(device);
 
   // Copy name, ensuring null termination
   const auto name = from_utf8(device.GetName());
@@ -167,46 +346,28 @@ void V1Server::SetDevice(const OTDIPC::V2::Messages::DeviceInfo& device) {
     std::min(name.size(), std::size(mV1Device.name)),
     mV1Device.name);
 
-  Send(mV1Device);
+  if (SendLocked(mV1Device)) {
+    lock.unlock();
+    mSendNotifier->Notify();
+  }
 }
 
 void V1Server::SetState(const OTDIPC::V2::Messages::State& state) {
-  mV1State
-    = CreateMessage<OTDIPC::V1::Messages::State>(mV1Device.vid, mV1Device.pid);
-
-  using ValidMask = OTDIPC::V2::Messages::State::ValidMask;
-
-  mV1State.positionValid = state.HasData(ValidMask::Position);
-  if (mV1State.positionValid) {
-    mV1State.x = state.x;
-    mV1State.y = state.y;
+  // V1 clients can't tell predictions from real samples
+  if (IsPredicted(state)) {
+    return;
   }
-
-  mV1State.pressureValid = state.HasData(ValidMask::Pressure);
-  if (mV1State.pressureValid) {
-    mV1State.pressure = state.pressure;
-  }
-
-  mV1State.penButtonsValid = state.HasData(ValidMask::PenButtons);
-  if (mV1State.penButtonsValid) {
-    mV1State.penButtons = state.penButtons;
-    // V1 requires that the pen tip is not a button
-    // V2 requires that the pen tip is button 0
-    mV1State.penButtons &= ~1;
-  }
-
-  mV1State.auxButtonsValid = state.HasData(ValidMask::AuxButtons);
-  if (mV1State.auxButtonsValid) {
-    mV1State.auxButtons = state.auxButtons;
+  if (!mStateQueue.TryPush(
+        {state, LatencyHistogram::Clock::now(), GetArrivalTime()})) {
+    mDroppedStateCount.fetch_add(1, std::memory_order_relaxed);
   }
+}
 
-  const bool hasProximityData = state.HasData(ValidMask::PenIsNearSurface)
-    || state.HasData(ValidMask::HoverDistance);
-  mV1State.proximityValid = hasProximityData;
-  if (hasProximityData) {
-    mV1State.nearProximity = state.penIsNearSurface;
-    mV1State.hoverDistance = state.hoverDistance;
-  }
+void V1Server::Flush() {
+  mSendNotifier->Notify();
+}
 
-  Send(mV1State);
-}
\ No newline at end of file
+bool V1Server::SendStateLocked(const OTDIPC::V2::Messages::State& state) {
+  mV1State = ToV1State(state, mV1Device);
+  return SendLocked(mV1State);
+}
@@ -2,20 +2,30 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <thread>
 
+// clang-format off
+#include <Windows.h>
 #include <wil/resource.h>
+// clang-format on
 
 #include <OTDIPC/DeviceInfo.hpp>
 #include <OTDIPC/State.hpp>
 #include <OTDIPC/V1/DeviceInfo.hpp>
 #include <OTDIPC/V1/State.hpp>
 #include "IHandler.hpp"
+#include "LatencyHistogram.hpp"
+#include "Reactor.hpp"
+#include "SpscRing.hpp"
+#include "V1Connection.hpp"
 
+// All pipe I/O is started and completed on the reactor thread
 class V1Server final : public IHandler {
  public:
-  V1Server();
+  explicit V1Server(Reactor&);
   ~V1Server() override;
 
   void Start();
@@ -23,23 +33,72 @@ class V1Server final : public IHandler {
 
   void SetDevice(const OTDIPC::V2::Messages::DeviceInfo& device) override;
   void SetState(const OTDIPC::V2::Messages::State& state) override;
+  void Flush() override;
+
  private:
-  void AcceptLoop(std::stop_token);
-  void AcceptOnce(std::stop_token);
-  void PingLoop(std::stop_token);
+  struct QueuedState {
+    OTDIPC::V2::Messages::State mState;
+    LatencyHistogram::Clock::time_point mQueuedAt;
+    // From `GetArrivalTime()`; for `LatencyStage::EndToEnd`
+    LatencyHistogram::Clock::time_point mArrivedAt;
+  };
+
+  struct Pipe;
+
+  // Reactor callbacks
+  void TryCreatePipe();
+  void OnPipeEvent(void (V1Server::*handler)());
+  void SendPing();
+  void SendPending();
+
+  // Caller must hold mPipeMutex, and be on the reactor thread
+  void OnConnect();
+  void OnRead();
+  void OnWrite();
+  // Starts the next write, or recreates the pipe if we can't listen
+  void PumpLocked();
+  void ScheduleRetry();
 
-  bool SendRaw(const OTDIPC::V1::Messages::Header* data, size_t size);
+  bool SendStateLocked(const OTDIPC::V2::Messages::State& state);
+
+  // Caller must hold mPipeMutex; the message is written once the reactor is
+  // notified with `mSendNotifier`
+  bool SendRawLocked(const OTDIPC::V1::Messages::Header* data, size_t size);
   template <class T>
     requires(!std::is_pointer_v<T>)
-  bool Send(const T& data) {
-    return SendRaw(&data, sizeof(T));
+  bool SendLocked(const T& data) {
+    return SendRawLocked(&data, sizeof(T));
   }
 
-  std::jthread mAcceptThread;
-  std::jthread mPingThread;
+  Reactor& mReactor;
+
+  // Only used on the reactor thread
+  Reactor::Registration mConnectWatch;
+  Reactor::Registration mReadWatch;
+  Reactor::Registration mWriteWatch;
+  // Only registered while a client is connected
+  Reactor::Registration mPingTimer;
+  LatencyHistogram::Clock::time_point mLastStateSentAt {};
+  // Only registered while waiting to recreate the pipe
+  Reactor::Registration mRetryTimer;
+  bool mIsStarted {false};
+  uint64_t mReportedDropCount {};
+
+  // Written by the WinTab thread, read by the reactor; the WinTab thread
+  // never waits on the pipe
+  SpscRing<QueuedState, 1024> mStateQueue;
+  std::atomic<uint64_t> mDroppedStateCount {};
+  std::unique_ptr<Reactor::Notifier> mSendNotifier;
+
+  std::unique_ptr<Pipe> mPipe;
 
-  wil::unique_hfile mPipe;
+  // Guards everything below, which is used from the WinTab and reactor
+  // threads
+  std::mutex mPipeMutex;
+  V1Connection mConnection;
 
+  // OTD-IPC v1 only has one tablet, so only the first is served
+  std::optional<uint32_t> mTabletId;
   OTDIPC::V1::Messages::DeviceInfo mV1Device {};
   OTDIPC::V1::Messages::State mV1State {};
 
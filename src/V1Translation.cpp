@@ -0,0 +1,78 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#include "V1Translation.hpp"
+
+#include <bit>
+
+std::pair<uint16_t, uint16_t> SynthesizeVidPid(
+  const std::string_view persistentId) {
+  // Use FNV-1a to generate a 32-bit hash
+  // Magic numbers from the algorithm
+  constexpr uint32_t OffsetBasis = 0x811c9dc5;
+  constexpr uint32_t Prime = 0x01000193;
+
+  uint32_t hash = OffsetBasis;
+  for (const auto c: persistentId) {
+    hash ^= std::bit_cast<uint8_t>(c);
+    hash *= Prime;
+  }
+
+  return {
+    static_cast<uint16_t>(hash & 0xFFFF),
+    static_cast<uint16_t>((hash >> 16) & 0xFFFF)};
+}
+
+OTDIPC::V1::Messages::DeviceInfo ToV1DeviceInfo(
+  const OTDIPC::V2::Messages::DeviceInfo& device) {
+  const auto [vid, pid] = SynthesizeVidPid(device.GetPersistentId());
+
+  auto ret = CreateMessage<OTDIPC::V1::Messages::DeviceInfo>(vid, pid);
+  ret.isValid = true;
+  ret.maxX = device.maxX;
+  ret.maxY = device.maxY;
+  ret.maxPressure = device.maxPressure;
+  return ret;
+}
+
+OTDIPC::V1::Messages::State ToV1State(
+  const OTDIPC::V2::Messages::State& state,
+  const OTDIPC::V1::Messages::DeviceInfo& device) {
+  auto ret
+    = CreateMessage<OTDIPC::V1::Messages::State>(device.vid, device.pid);
+
+  using ValidMask = OTDIPC::V2::Messages::State::ValidMask;
+
+  ret.positionValid = state.HasData(ValidMask::Position);
+  if (ret.positionValid) {
+    ret.x = state.x;
+    ret.y = state.y;
+  }
+
+  ret.pressureValid = state.HasData(ValidMask::Pressure);
+  if (ret.pressureValid) {
+    ret.pressure = state.pressure;
+  }
+
+  ret.penButtonsValid = state.HasData(ValidMask::PenButtons);
+  if (ret.penButtonsValid) {
+    ret.penButtons = state.penButtons;
+    // V1 requires that the pen tip is not a button
+    // V2 requires that the pen tip is button 0
+    ret.penButtons &= ~1;
+  }
+
+  ret.auxButtonsValid = state.HasData(ValidMask::AuxButtons);
+  if (ret.auxButtonsValid) {
+    ret.auxButtons = state.auxButtons;
+  }
+
+  const bool hasProximityData = state.HasData(ValidMask::PenIsNearSurface)
+    || state.HasData(ValidMask::HoverDistance);
+  ret.proximityValid = hasProximityData;
+  if (hasProximityData) {
+    ret.nearProximity = state.penIsNearSurface;
+    ret.hoverDistance = state.hoverDistance;
+  }
+
+  return ret;
+}
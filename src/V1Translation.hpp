@@ -0,0 +1,40 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include <OTDIPC/DeviceInfo.hpp>
+#include <OTDIPC/State.hpp>
+#include <OTDIPC/V1/DeviceInfo.hpp>
+#include <OTDIPC/V1/State.hpp>
+
+// Platform-neutral conversion of OTD-IPC v2 messages to v1, for V1Server
+
+template <std::derived_from<OTDIPC::V1::Messages::Header> T>
+T CreateMessage(uint16_t vid, uint16_t pid, std::size_t size = sizeof(T)) {
+  T ret {};
+  ret.messageType = T::MESSAGE_TYPE;
+  ret.size = static_cast<uint32_t>(size);
+  ret.vid = vid;
+  ret.pid = pid;
+  return ret;
+}
+
+// v1 identifies devices by VID/PID, but v2 only has an opaque persistent ID
+std::pair<uint16_t, uint16_t> SynthesizeVidPid(std::string_view persistentId);
+
+// Everything except `name`, which needs converting to UTF-16
+[[nodiscard]]
+OTDIPC::V1::Messages::DeviceInfo ToV1DeviceInfo(
+  const OTDIPC::V2::Messages::DeviceInfo&);
+
+[[nodiscard]]
+OTDIPC::V1::Messages::State ToV1State(
+  const OTDIPC::V2::Messages::State&,
+  const OTDIPC::V1::Messages::DeviceInfo&);
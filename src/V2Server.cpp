@@ -2,48 +2,60 @@
 // SPDX-License-Identifier: MIT
 #include "V2Server.hpp"
 
-#include <afunix.h>
-#include <expected>
-#include <shlobj.h>
-#include <wil/filesystem.h>
-#include <wil/result.h>
-#include <winsock2.h>
-#include <ws2tcpip.h>
-
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <format>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <print>
+#include <stdexcept>
+#include <tuple>
 #include <variant>
 
-#include <OTDIPC/DebugMessage.hpp>
-#include <OTDIPC/Hello.hpp>
 #include <OTDIPC/Ping.hpp>
-
-#pragma comment(lib, "ws2_32.lib")
+#include "Log.hpp"
+#include "MessageDispatch.hpp"
+#include "UnixSocketTransport.hpp"
 
 namespace {
 
 constexpr uint64_t ProtocolVersion = 0x02'20260205'01;
 constexpr uint8_t CompatibilityVersion = 1;
 
+// Send early if this much is staged without a `Flush()`; a pump iteration
+// only usually produces a few hundred bytes
+constexpr std::size_t FlushThreshold = 16 * 1024;
+// If a client's unsent backlog reaches this, it's marked as lagging, and we
+// stop queueing states for it unless buttons change
+constexpr std::size_t MaxClientBacklog = 64 * 1024;
+// Lagging clients still get button changes, pings, and device and debug
+// messages; if the backlog reaches this anyway, the client has stopped
+// reading, and is disconnected
+constexpr std::size_t MaxClientBufferedBytes = 1024 * 1024;
+// How often we retry clients with a backlog
+constexpr auto BacklogRetryInterval = std::chrono::milliseconds(5);
+// Clients are pinged if nothing else has been sent for this long
+constexpr auto PingInterval = std::chrono::seconds(1);
+// Limits for `DeliveryPacing::intervalMicroseconds`
+constexpr auto MinPacingInterval = std::chrono::milliseconds(1);
+constexpr auto MaxPacingInterval = std::chrono::seconds(1);
+// Timers fire on the first millisecond tick after their deadline, so paced
+// states are sent this far ahead of the client's
+constexpr auto PacingLead = std::chrono::milliseconds(1);
+// For InputFrameSample::timestamp, and the shared memory ring
+uint64_t ToMicroseconds(const LatencyHistogram::Clock::time_point time) {
+  return static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      time.time_since_epoch())
+      .count());
+}
+
 template<std::size_t N>
 std::string_view TruncateNulls(const char (&in)[N]) {
   return std::string_view(in, strnlen(in, N));
 }
 
-// Helper to get LocalAppData/otd-ipc/servers/v2
-std::filesystem::path GetDiscoveryDir() {
-  wil::unique_cotaskmem_string localAppData;
-  if (SUCCEEDED(SHGetKnownFolderPath(
-        FOLDERID_LocalAppData, 0, nullptr, &localAppData))) {
-    std::filesystem::path path(localAppData.get());
-    return path / "otd-ipc" / "servers" / "v2";
-  }
-  throw std::runtime_error("Failed to resolve %LOCALAPPDATA%");
-}
-
 template <std::derived_from<OTDIPC::Messages::Header> T>
 void InitHeader(T& msg, uint32_t tabletId, std::size_t size = sizeof(T)) {
   msg.messageType = T::MESSAGE_TYPE;
@@ -51,32 +63,39 @@ void InitHeader(T& msg, uint32_t tabletId, std::size_t size = sizeof(T)) {
   msg.nonPersistentTabletId = tabletId;
 }
 
-struct socket_closed_t {};
-struct wsa_error_t {
-  int value {};
-};
-inline constexpr socket_closed_t socket_closed;
-
-std::expected<void, std::variant<socket_closed_t, wsa_error_t>>
-ReadNBytes(SOCKET socket, void* const buffer, const std::size_t count) {
-  auto p = buffer;
-  auto toRead = count;
-  while (toRead > 0) {
-    const int result
-      = recv(socket, static_cast<char*>(p), static_cast<int>(toRead), 0);
-    if (result == 0) {
-      return std::unexpected {socket_closed};
-    }
-    if (result == SOCKET_ERROR) {
-      const auto error = WSAGetLastError();
-      if (error == WSAECONNRESET) {
-        return std::unexpected {socket_closed};
-      }
-      return std::unexpected {wsa_error_t {error}};
-    }
-    toRead -= result;
+void LogTransportError(
+  const std::string_view operation,
+  const Transport::Error& error) {
+  if (const auto code = std::get_if<std::error_code>(&error)) {
+    Log::Error(
+      "{} client failed: {} ({})",
+      operation,
+      code->message(),
+      code->value());
+  }
+}
+
+// Transitions that clients must see, even if they're not keeping up
+bool IsEdge(
+  const OTDIPC::Messages::State& before,
+  const OTDIPC::Messages::State& after) {
+  return before.penButtons != after.penButtons
+    || before.auxButtons != after.auxButtons
+    || before.penIsNearSurface != after.penIsNearSurface
+    || before.validBits != after.validBits;
+}
+
+// Devices and per-tablet states are kept in small vectors, as there are
+// rarely more than two tablets
+template <std::derived_from<OTDIPC::Messages::Header> T>
+void InsertOrAssign(std::vector<T>& items, const T& item) {
+  const auto it = std::ranges::find(
+    items, item.nonPersistentTabletId, &T::nonPersistentTabletId);
+  if (it == items.end()) {
+    items.push_back(item);
+  } else {
+    *it = item;
   }
-  return {};
 }
 
 template <std::size_t N>
@@ -87,190 +106,638 @@ void CopyTo(char (&dest)[N], const std::string_view src) {
 
 }// namespace
 
-V2Server::V2Server(Config config, const DefaultBehavior defaultBehavior)
-  : mConfig(std::move(config)), mDefaultBehavior(defaultBehavior) {
-  // Initialize WinSock
-  WSADATA wsaData;
-  int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-  if (result != 0) {
-    THROW_HR(HRESULT_FROM_WIN32(result));
+struct V2Server::Client {
+  std::unique_ptr<Transport::IConnection> mConnection;
+  // Declared after the connection, so it's removed before the connection is
+  // closed
+  Reactor::Registration mWatch;
+  SendBuffer mSendBuffer {FlushThreshold};
+
+  // Returned to the pool when the client is destroyed
+  ReceiveBufferPool::Buffer mReceiveBuffer;
+  std::optional<FrameParser> mParser;
+
+  // Set if the client's `Hello` advertises support
+  bool mWantsInputFrames {false};
+
+  // While lagging, we only queue states that change buttons or proximity;
+  // the latest skipped state for each tablet is sent once the backlog clears
+  bool mIsLagging {false};
+
+  // Each tablet has its own buttons and proximity
+  struct Tablet {
+    uint32_t mId {};
+    OTDIPC::Messages::State mLastQueuedState {};
+    std::optional<QueuedState> mSkippedState;
+    // Latest wins while paced; sent at the next deadline
+    std::optional<QueuedState> mPacedState;
+    std::optional<QueuedState> mPacedPrediction;
+  };
+  std::vector<Tablet> mTablets;
+
+  // Set by a `DeliveryPacing` message; only used on the reactor thread
+  struct Pacing {
+    LatencyHistogram::Clock::duration mInterval {};
+    LatencyHistogram::Clock::time_point mNextDeadline {};
+    // Only registered while there's something to send
+    Reactor::Registration mTimer;
+  };
+  std::optional<Pacing> mPacing;
+
+  // Removed by the next `SendPending()`
+  bool mIsDisconnected {false};
+
+  Tablet& GetTablet(const uint32_t id) {
+    const auto it = std::ranges::find(mTablets, id, &Tablet::mId);
+    if (it != mTablets.end()) {
+      return *it;
+    }
+    return mTablets.emplace_back(Tablet {.mId = id});
   }
+
+  [[nodiscard]]
+  bool HasPacedStates() const {
+    return std::ranges::any_of(mTablets, [](const Tablet& it) {
+      return it.mPacedState || it.mPacedPrediction;
+    });
+  }
+};
+
+V2Server::V2Server(
+  Reactor& reactor,
+  Config config,
+  const DefaultBehavior defaultBehavior)
+  : mConfig(std::move(config)),
+    mDefaultBehavior(defaultBehavior),
+    mReactor(reactor),
+    mReceiveBuffers(mConfig.maxMessageSize) {
+  if (mConfig.maxMessageSize < sizeof(OTDIPC::Messages::Hello)) {
+    throw std::invalid_argument("maxMessageSize is too small for a Hello");
+  }
+  mBatch.reserve(decltype(mStateQueue)::capacity());
+  mFrameSamples.reserve(decltype(mStateQueue)::capacity());
+  mReactor.Invoke([this] {
+    mSendNotifier = mReactor.CreateNotifier([this] { SendPending(); });
+  });
 }
 
 V2Server::~V2Server() {
   Stop();
-  WSACleanup();
+  mReactor.Invoke([this] { mSendNotifier.reset(); });
 }
 
 void V2Server::Start() {
-  // 1. Setup Socket
-  mListenSocket.reset(socket(AF_UNIX, SOCK_STREAM, 0));
-  if (!mListenSocket) {
-    THROW_LAST_ERROR();
-  }
+  Start(CreateUnixSocketListener(mConfig.socketPath));
+}
 
-  // Delete existing socket file if it exists (Unix socket requirement)
-  std::error_code ec;
-  if (std::filesystem::exists(mConfig.socketPath, ec)) {
-    std::filesystem::remove(mConfig.socketPath, ec);
+void V2Server::Start(std::unique_ptr<Transport::IListener> listener) {
+  try {
+    mStateRing = std::make_unique<SharedStateRing>(
+      SharedStateRing::Disposition::Write,
+      std::format("{}.States", mConfig.implementationId));
+  } catch (const std::exception& e) {
+    Log::Error("Failed to create shared memory state ring: {}", e.what());
   }
 
-  // Ensure parent directory exists for socket
-  std::filesystem::create_directories(mConfig.socketPath.parent_path(), ec);
-  // `exists()` is unusable on Unix sockets on Windows, so unconditionally
-  // remove and ignore error https://github.com/microsoft/STL/issues/4077
-  std::filesystem::remove(mConfig.socketPath, ec);
+  PublishDiscovery();
 
-  sockaddr_un addr = {};
-  addr.sun_family = AF_UNIX;
+  mReactor.Invoke([this, &listener] {
+    mListener = std::move(listener);
+    mListenerWatch = mReactor.Watch(
+      mListener->GetWaitable(),
+      std::bind_front(&V2Server::AcceptClients, this));
+  });
+}
 
-  // Copy path to sun_path (max 108 chars usually)
-  std::string pathStr = mConfig.socketPath.string();
-  if (pathStr.length() >= sizeof(addr.sun_path)) {
-    throw std::runtime_error("Socket path is too long for AF_UNIX");
+void V2Server::SendPing() {
+  // States show the connection is alive, and a failed send removes the
+  // client, so there's no need to ping while the pen is moving
+  if (LatencyHistogram::Clock::now() - mLastStateSentAt < PingInterval) {
+    return;
   }
-  strncpy_s(addr.sun_path, pathStr.c_str(), _TRUNCATE);
 
-  if (
-    bind(mListenSocket.get(), (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-    THROW_LAST_ERROR();
+  OTDIPC::Messages::Ping ping = {};
+  InitHeader(ping, 0);
+  ping.sequenceNumber = ++mPingSequenceNumber;
+  if (Send(ping)) {
+    SendPending();
   }
+}
+
+void V2Server::Stop() {
+  mReactor.Invoke([this] {
+    mPingTimer.reset();
+    mBacklogTimer.reset();
+    mListenerWatch.reset();
+    mListener.reset();
+    mStateRing.reset();
+
+    const std::unique_lock lock(mClientsMutex);
+    mClients.clear();
+  });
+}
 
-  if (listen(mListenSocket.get(), 1) == SOCKET_ERROR) {
-    THROW_LAST_ERROR();
+void V2Server::SendPending() {
+  bool haveBacklog = false;
+  std::vector<std::unique_ptr<Client>> disconnected;
+  {
+    const std::unique_lock lock(mClientsMutex);
+    mBatch.clear();
+    mStateQueue.ConsumeAll([this](const auto& queued) {
+      auto& state = mBatch.emplace_back(queued).mState;
+      InitHeader(state, state.nonPersistentTabletId);
+    });
+    for (auto&& queued: mBatch) {
+      // Predictions are only for clients that can replace them with the real
+      // samples that follow
+      if (IsPredicted(queued.mState)) {
+        continue;
+      }
+      InsertOrAssign(mLatestStates, queued.mState);
+      if (mStateRing) {
+        mStateRing->Push(queued.mState, ToMicroseconds(queued.mQueuedAt));
+      }
+    }
+    if (mStateRing && !mBatch.empty()) {
+      mStateRing->Wake();
+    }
+    for (auto&& client: mClients) {
+      if (mBatch.empty()) {
+        break;
+      }
+      if (client->mPacing) {
+        PaceStates(*client, mBatch);
+        continue;
+      }
+      if (client->mWantsInputFrames) {
+        QueueFrame(*client, mBatch);
+        continue;
+      }
+      for (auto&& queued: mBatch) {
+        QueueState(*client, queued);
+      }
+    }
+
+    for (auto&& client: mClients) {
+      haveBacklog |= FlushClient(*client);
+    }
+    if (!(mBatch.empty() || mClients.empty())) {
+      const auto sentAt = LatencyHistogram::Clock::now();
+      mLastStateSentAt = sentAt;
+      auto& latency = GetLatencyHistogram(LatencyStage::V2Send);
+      auto& endToEnd = GetLatencyHistogram(LatencyStage::EndToEnd);
+      for (auto&& queued: mBatch) {
+        latency.Record(sentAt - queued.mQueuedAt);
+        if (queued.mArrivedAt != LatencyHistogram::Clock::time_point {}) {
+          endToEnd.Record(sentAt - queued.mArrivedAt);
+        }
+      }
+    }
+
+    const auto [first, last] = std::ranges::partition(
+      mClients, [](const auto& it) { return !it->mIsDisconnected; });
+    disconnected.assign(
+      std::make_move_iterator(first), std::make_move_iterator(last));
+    mClients.erase(first, last);
+    if (mClients.empty()) {
+      // Nobody to ping, so don't wake up
+      mPingTimer.reset();
+    }
+  }
+  if (!disconnected.empty()) {
+    Log::Info("Client has disconnected");
   }
 
-  PublishDiscovery();
+  // Retry clients with a backlog until they catch up
+  if (!haveBacklog) {
+    mBacklogTimer.reset();
+  } else if (!mBacklogTimer) {
+    mBacklogTimer = mReactor.AddTimer(
+      BacklogRetryInterval, std::bind_front(&V2Server::SendPending, this));
+  }
 
-  mAcceptThread = std::jthread(std::bind_front(&V2Server::AcceptLoop, this));
-  mPingThread = std::jthread(std::bind_front(&V2Server::PingLoop, this));
+  const auto dropCount = mDroppedStateCount.load(std::memory_order_relaxed);
+  if (dropCount != mReportedDropCount) {
+    Log::Error(
+      "Dropped {} states as the reactor isn't keeping up",
+      dropCount - mReportedDropCount);
+    mReportedDropCount = dropCount;
+  }
 }
 
-void V2Server::PingLoop(const std::stop_token st) {
-  while (!st.stop_requested()) {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    if (st.stop_requested()) {
-      break;
+bool V2Server::AdmitState(Client& client, const QueuedState& queued) {
+  const auto& msg = queued.mState;
+  auto& tablet = client.GetTablet(msg.nonPersistentTabletId);
+  const bool isEdge = IsEdge(tablet.mLastQueuedState, msg);
+
+  if (client.mIsLagging && !isEdge) {
+    tablet.mSkippedState = queued;
+    return false;
+  }
+
+  if (client.mSendBuffer.size() >= MaxClientBacklog && !client.mIsLagging) {
+    Log::Error("Client isn't keeping up; only sending button changes");
+    client.mIsLagging = true;
+    if (!isEdge) {
+      tablet.mSkippedState = queued;
+      return false;
     }
+  }
+
+  tablet.mLastQueuedState = msg;
+  tablet.mSkippedState.reset();
+  return true;
+}
+
+void V2Server::QueueState(Client& client, const QueuedState& queued) {
+  if (IsPredicted(queued.mState)) {
+    return;
+  }
+  if (AdmitState(client, queued)) {
+    client.mSendBuffer.Append(queued.mState);
+  }
+}
 
-    if (!mClientSocket) {
+void V2Server::QueueFrame(
+  Client& client,
+  const std::span<const QueuedState> batch) {
+  // Each frame is for a single tablet
+  mFrameSamples.clear();
+  auto tabletId
+    = batch.empty() ? 0 : batch.front().mState.nonPersistentTabletId;
+  for (auto&& queued: batch) {
+    if (queued.mState.nonPersistentTabletId != tabletId) {
+      if (!mFrameSamples.empty()) {
+        AppendInputFrame(client.mSendBuffer, tabletId, mFrameSamples);
+        mFrameSamples.clear();
+      }
+      tabletId = queued.mState.nonPersistentTabletId;
+    }
+    if (IsPredicted(queued.mState)) {
+      // Superseded by the next real sample, so not worth sending to a client
+      // that's behind
+      if (!client.mIsLagging) {
+        mFrameSamples.push_back(
+          ToInputFrameSample(queued.mState, ToMicroseconds(queued.mQueuedAt)));
+      }
       continue;
     }
-
-    static uint64_t seq = 0;
-    OTDIPC::Messages::Ping ping = {};
-    InitHeader(ping, 0);
-    ping.sequenceNumber = ++seq;
-    Send(ping);
+    if (AdmitState(client, queued)) {
+      mFrameSamples.push_back(
+        ToInputFrameSample(queued.mState, ToMicroseconds(queued.mQueuedAt)));
+    }
+  }
+  if (!mFrameSamples.empty()) {
+    AppendInputFrame(client.mSendBuffer, tabletId, mFrameSamples);
   }
 }
 
-void V2Server::Stop() {
-  mListenSocket.reset();
-  mPingThread = {};
-  mAcceptThread = {};
+void V2Server::SetPacing(Client& client, const DeliveryPacing& msg) {
+  const std::unique_lock lock(mClientsMutex);
+  if (msg.intervalMicroseconds == 0) {
+    if (client.mPacing) {
+      Log::Info("Client turned off pacing");
+      QueuePaced(client);
+      client.mPacing.reset();
+      mSendNotifier->Notify();
+    }
+    return;
+  }
+
+  const auto interval = std::clamp<LatencyHistogram::Clock::duration>(
+    std::chrono::microseconds(msg.intervalMicroseconds),
+    MinPacingInterval,
+    MaxPacingInterval);
+  Log::Info(
+    "Client requested a state every {}",
+    std::chrono::duration_cast<std::chrono::microseconds>(interval));
+
+  auto& pacing = client.mPacing ? *client.mPacing : client.mPacing.emplace();
+  pacing.mInterval = interval;
+  pacing.mNextDeadline = msg.nextDeadline
+    ? LatencyHistogram::Clock::time_point(
+        std::chrono::microseconds(msg.nextDeadline))
+    : LatencyHistogram::Clock::now() + interval;
+  pacing.mTimer.reset();
+  if (client.HasPacedStates()) {
+    SchedulePacedDelivery(client);
+  }
 }
 
-void V2Server::AcceptLoop(const std::stop_token st) {
-  while (!st.stop_requested()) {
-    AcceptOnce(st);
+void V2Server::PaceStates(
+  Client& client,
+  const std::span<const QueuedState> batch) {
+  for (auto&& queued: batch) {
+    auto& tablet = client.GetTablet(queued.mState.nonPersistentTabletId);
+    if (IsPredicted(queued.mState)) {
+      if (client.mWantsInputFrames) {
+        tablet.mPacedPrediction = queued;
+      }
+      continue;
+    }
+    tablet.mPacedPrediction.reset();
+    if (!IsEdge(tablet.mLastQueuedState, queued.mState)) {
+      tablet.mPacedState = queued;
+      continue;
+    }
+    // Button and proximity changes can't wait for the next frame; as states
+    // are complete, this supersedes anything that was waiting
+    tablet.mPacedState.reset();
+    if (client.mWantsInputFrames) {
+      QueueFrame(client, {&queued, 1});
+    } else {
+      QueueState(client, queued);
+    }
+  }
+  if (client.HasPacedStates()) {
+    SchedulePacedDelivery(client);
   }
-  mListenSocket.reset();
 }
 
-void V2Server::AcceptOnce(const std::stop_token st) {
-  // Block waiting for a client
-  wil::unique_socket client(accept(mListenSocket.get(), nullptr, nullptr));
+void V2Server::QueuePaced(Client& client) {
+  for (auto&& tablet: client.mTablets) {
+    std::array<QueuedState, 2> frame {};
+    std::size_t count = 0;
+    if (tablet.mPacedState) {
+      frame[count++] = *std::exchange(tablet.mPacedState, std::nullopt);
+    }
+    if (tablet.mPacedPrediction) {
+      frame[count++] = *std::exchange(tablet.mPacedPrediction, std::nullopt);
+    }
+    if (count == 0) {
+      continue;
+    }
+    if (client.mWantsInputFrames) {
+      QueueFrame(client, std::span {frame}.first(count));
+      continue;
+    }
+    for (auto&& queued: std::span {frame}.first(count)) {
+      QueueState(client, queued);
+    }
+  }
+}
 
-  if (!client) {
-    // accept failed (likely Stop() called and socket closed)
+void V2Server::SchedulePacedDelivery(Client& client) {
+  auto& pacing = *client.mPacing;
+  if (pacing.mTimer) {
     return;
   }
+  // Stay in phase with the client's frames, even if there's been nothing to
+  // send for a while
+  const auto now = LatencyHistogram::Clock::now();
+  if (pacing.mNextDeadline - PacingLead < now) {
+    const auto behind = now - (pacing.mNextDeadline - PacingLead);
+    pacing.mNextDeadline += pacing.mInterval * (behind / pacing.mInterval + 1);
+  }
+  pacing.mTimer = mReactor.AddTimer(
+    pacing.mNextDeadline - PacingLead,
+    std::bind_front(&V2Server::DeliverPaced, this, std::ref(client)));
+}
 
-  mClientSocket = std::move(client);
-
-  // HANDSHAKE PHASE
-
-  OTDIPC::Messages::Hello hello {
-    .protocolVersion = ProtocolVersion,
-    .compatibilityVersion = CompatibilityVersion,
-  };
-  CopyTo(hello.humanReadableName, mConfig.humanName);
-  CopyTo(hello.humanReadableVersion, mConfig.humanVersion);
-  CopyTo(hello.implementationID, mConfig.implementationId);
-  SendRaw(&hello.header, sizeof(hello));
+void V2Server::DeliverPaced(Client& client) {
+  {
+    const std::unique_lock lock(mClientsMutex);
+    auto& pacing = *client.mPacing;
+    // One-shot, and this is its callback
+    pacing.mTimer.reset();
+    pacing.mNextDeadline += pacing.mInterval;
+    if (client.mIsDisconnected) {
+      return;
+    }
+    QueuePaced(client);
+    mLastStateSentAt = LatencyHistogram::Clock::now();
+  }
+  // Also removes the client if the send fails, so `client` must not be used
+  // after this
+  SendPending();
+}
 
-  if (mDevice.has_value()) {
-    Send(*mDevice);
+bool V2Server::FlushClient(Client& client) {
+  if (client.mIsDisconnected) {
+    return false;
   }
 
-  // OPERATIONAL PHASE
+  while (!client.mSendBuffer.empty()) {
+    const auto sent
+      = client.mConnection->TrySend(client.mSendBuffer.GetPending());
+    if (!sent) {
+      LogTransportError("Sending to", sent.error());
+      client.mIsDisconnected = true;
+      client.mWatch.reset();
+      client.mSendBuffer.clear();
+      return false;
+    }
+    if (*sent == 0) {
+      if (client.mSendBuffer.size() >= MaxClientBufferedBytes) {
+        Log::Error(
+          "Disconnecting client: {} bytes unsent",
+          client.mSendBuffer.size());
+        client.mIsDisconnected = true;
+        client.mWatch.reset();
+        client.mSendBuffer.clear();
+        return false;
+      }
+      return true;
+    }
+    client.mSendBuffer.Consume(*sent);
+  }
 
-  std::vector<std::byte> buffer;
-  buffer.resize(1024);
-  while (!st.stop_requested()) {
-    struct ReadErrorVisitor {
-      static void operator()(socket_closed_t) {
-        std::println("Client has disconnected");
+  if (client.mIsLagging) {
+    Log::Info("Client has caught up");
+    client.mIsLagging = false;
+    bool queued = false;
+    for (auto&& tablet: client.mTablets) {
+      const auto skipped = std::exchange(tablet.mSkippedState, std::nullopt);
+      if (!skipped) {
+        continue;
       }
-      static void operator()(const wsa_error_t error) {
-        std::println(
-          stderr,
-          "Reading from client failed with {:#010x}",
-          static_cast<uint32_t>(HRESULT_FROM_WIN32(error.value)));
+      if (client.mWantsInputFrames) {
+        QueueFrame(client, {&*skipped, 1});
+      } else {
+        QueueState(client, *skipped);
       }
-    };
+      queued = true;
+    }
+    return queued;
+  }
+  return false;
+}
 
-    auto it = buffer.data();
-    auto header = reinterpret_cast<OTDIPC::Messages::Header*>(buffer.data());
-    if (const auto ok = ReadNBytes(mClientSocket.get(), it, sizeof(*header));
-        !ok) {
-      std::visit(ReadErrorVisitor {}, ok.error());
-      return;
+void V2Server::AcceptClients() {
+  while (auto connection = mListener->TryAccept()) {
+    auto client = std::make_unique<Client>();
+    client->mConnection = std::move(connection);
+    client->mReceiveBuffer = mReceiveBuffers.Acquire();
+    client->mParser.emplace(
+      std::span {client->mReceiveBuffer.get(), mConfig.maxMessageSize},
+      mConfig.oversizedMessages);
+    try {
+      client->mWatch = mReactor.Watch(
+        client->mConnection->GetWaitable(),
+        std::bind_front(&V2Server::ReadFromClient, this, std::ref(*client)));
+    } catch (const std::exception& e) {
+      Log::Error("Rejecting client: {}", e.what());
+      continue;
     }
 
-    if (header->size > buffer.size()) {
-      buffer.resize(header->size);
-      header = reinterpret_cast<OTDIPC::Messages::Header*>(buffer.data());
-      it = buffer.data();
+    // HANDSHAKE PHASE
+
+    OTDIPC::Messages::Hello hello {
+      .protocolVersion = ProtocolVersion,
+      .compatibilityVersion = CompatibilityVersion,
+    };
+    CopyTo(hello.humanReadableName, mConfig.humanName);
+    CopyTo(hello.humanReadableVersion, mConfig.humanVersion);
+    CopyTo(hello.implementationID, mConfig.implementationId);
+    client->mSendBuffer.Append(hello);
+
+    // Stage the snapshot in the same critical section as adding the client,
+    // so that it's sent before any newer states
+    const std::unique_lock lock(mClientsMutex);
+    for (auto&& device: mDevices) {
+      client->mSendBuffer.Append(device);
     }
-    it += sizeof(*header);
+    for (auto&& state: mLatestStates) {
+      client->mSendBuffer.Append(state);
+      client->GetTablet(state.nonPersistentTabletId).mLastQueuedState = state;
+    }
+    mClients.push_back(std::move(client));
+    Log::Info("Client connected; {} client(s) total", mClients.size());
+  }
+  if (!(mPingTimer || mClients.empty())) {
+    mPingTimer = mReactor.AddTimer(
+      PingInterval, std::bind_front(&V2Server::SendPing, this));
+  }
+  SendPending();
+}
 
-    if (const auto ok
-        = ReadNBytes(mClientSocket.get(), it, header->size - sizeof(*header));
-        !ok) {
-      std::visit(ReadErrorVisitor {}, ok.error());
+void V2Server::ReadFromClient(Client& client) {
+  // OPERATIONAL PHASE
+
+  auto& parser = *client.mParser;
+  while (!client.mIsDisconnected) {
+    // As much as fits, which may be several messages
+    const auto result
+      = client.mConnection->TryReceive(parser.GetReceiveSpace());
+    if (!result) {
+      LogTransportError("Reading from", result.error());
+      Disconnect(client);
       return;
     }
-
-    if (header->messageType == OTDIPC::Messages::DebugMessage::MESSAGE_TYPE) {
-      std::println(
-        "Client message: {}",
-        reinterpret_cast<OTDIPC::Messages::DebugMessage*>(header)->message());
-      continue;
+    if (*result == 0) {
+      return;
+    }
+    parser.Commit(*result);
+
+    const auto skipped = parser.GetSkippedMessageCount();
+    while (!client.mIsDisconnected) {
+      const auto message = parser.Next();
+      if (!message) {
+        Log::Error(
+          "Disconnecting client: {}",
+          (message.error() == FrameParser::Error::TooLarge)
+            ? "message is too large"
+            : "invalid message size");
+        Disconnect(client);
+        return;
+      }
+      if (!*message) {
+        break;
+      }
+      HandleMessage(client, *message);
     }
+    if (parser.GetSkippedMessageCount() != skipped) {
+      Log::Error(
+        "Skipped a client message larger than {} bytes",
+        mConfig.maxMessageSize);
+    }
+  }
+}
 
-    if (header->messageType == OTDIPC::Messages::Hello::MESSAGE_TYPE) {
-      const auto& hello = *reinterpret_cast<OTDIPC::Messages::Hello*>(header);
-      std::println("Client hello: {} {} (proto {:#x}, ID '{}'/ cv {})",
-          TruncateNulls(hello.humanReadableName),
-          TruncateNulls(hello.humanReadableVersion),
-          hello.protocolVersion,
-          TruncateNulls(hello.implementationID),
-          hello.compatibilityVersion);
-      continue;
+void V2Server::HandleMessage(
+  Client& client,
+  OTDIPC::Messages::Header* const header) {
+  using Dispatcher = MessageDispatcher<V2Server, Client&>;
+  using Route = Dispatcher::Route;
+  static constexpr Dispatcher Dispatch {
+    // An empty message is just a header
+    Route::For<
+      OTDIPC::Messages::DebugMessage,
+      &V2Server::HandleDebugMessage,
+      sizeof(OTDIPC::Messages::Header)>(),
+    Route::For<OTDIPC::Messages::Hello, &V2Server::HandleHello>(),
+    Route::For<DeliveryPacing, &V2Server::SetPacing>(),
+  };
+
+  switch (Dispatch(*this, client, *header)) {
+    case Dispatcher::Result::Handled:
+      return;
+    case Dispatcher::Result::UnknownType:
+      Log::Error(
+        "Received unexpected client message type {}",
+        std::to_underlying(header->messageType));
+      return;
+    case Dispatcher::Result::UnknownExperimental: {
+      // Clients may send experiments to servers that don't support them
+      const auto& guid = reinterpret_cast<ExperimentalHeader*>(header)->guid;
+      Log::Info(
+        "Ignoring unsupported experimental client message "
+        "{{{:08X}-{:04X}-{:04X}-{:02X}{:02X}-{:02X}{:02X}{:02X}{:02X}{:02X}"
+        "{:02X}}}",
+        guid.data1,
+        guid.data2,
+        guid.data3,
+        guid.data4[0],
+        guid.data4[1],
+        guid.data4[2],
+        guid.data4[3],
+        guid.data4[4],
+        guid.data4[5],
+        guid.data4[6],
+        guid.data4[7]);
+      return;
     }
+    case Dispatcher::Result::TooSmall:
+      Log::Error(
+        "Ignoring client message type {} with only {} bytes",
+        std::to_underlying(header->messageType),
+        header->size);
+      return;
+  }
+}
 
-    std::println(
-      stderr,
-      "Received unexpected client message type {}",
-      std::to_underlying(header->messageType));
+void V2Server::HandleDebugMessage(
+  Client&,
+  const OTDIPC::Messages::DebugMessage& msg) {
+  Log::Info("Client message: {}", msg.message());
+}
+
+void V2Server::HandleHello(
+  Client& client,
+  const OTDIPC::Messages::Hello& hello) {
+  Log::Info(
+    "Client hello: {} {} (proto {:#x}, ID '{}'/ cv {})",
+    TruncateNulls(hello.humanReadableName),
+    TruncateNulls(hello.humanReadableVersion),
+    hello.protocolVersion,
+    TruncateNulls(hello.implementationID),
+    hello.compatibilityVersion);
+  if (HelloAdvertises(hello, InputFrame::GUID)) {
+    Log::Info("Client supports InputFrame messages");
+    client.mWantsInputFrames = true;
   }
-  mClientSocket.reset();
+}
+
+void V2Server::Disconnect(Client& client) {
+  client.mIsDisconnected = true;
+  // This may be called from the watch's own callback; that's fine, as the
+  // reactor doesn't destroy callbacks until they've returned
+  client.mWatch.reset();
+  mSendNotifier->Notify();
 }
 
 void V2Server::PublishDiscovery() {
-  const auto root = GetDiscoveryDir();
+  const auto& root = mConfig.discoveryDir;
   std::filesystem::create_directories(root / "available");
 
   // 1. Write Metadata
@@ -286,6 +753,10 @@ void V2Server::PublishDiscovery() {
   meta << "HUMAN_READABLE_VERSION=" << mConfig.humanVersion << "\n";
   meta << "COMPATIBILITY_VERSION=" << CompatibilityVersion << "\n";
   meta << "HOMEPAGE=" << mConfig.homepageUrl << "\n";
+  if (mStateRing) {
+    // See SharedStateRing.hpp for the layout
+    meta << "STATE_RING=" << mStateRing->GetName() << "\n";
+  }
   meta.close();
 
   // 2. Handle Default
@@ -296,8 +767,7 @@ void V2Server::EnsureDefaultExists() {
   if (mDefaultBehavior == DefaultBehavior::DoNotSet)
     return;
 
-  const auto root = GetDiscoveryDir();
-  const auto defaultPath = root / "default.txt";
+  const auto defaultPath = mConfig.discoveryDir / "default.txt";
 
   if (
     mDefaultBehavior == DefaultBehavior::AlwaysSet
@@ -307,57 +777,59 @@ void V2Server::EnsureDefaultExists() {
   }
 }
 
-bool V2Server::SendRaw(const OTDIPC::Messages::Header* data, size_t size) {
-  if (data->size != size)
+bool V2Server::SendRaw(
+  const OTDIPC::Messages::Header* data,
+  const size_t size,
+  const std::span<const std::byte> body) {
+  if (data->size != size + body.size())
     throw std::runtime_error("Header size mismatch");
-  if (!mClientSocket)
-    return false;
 
-  const int result = send(
-    mClientSocket.get(),
-    reinterpret_cast<const char*>(data),
-    static_cast<int>(size),
-    0);
-  if (result == SOCKET_ERROR) {
-    mClientSocket.reset();
-    return false;
+  const std::unique_lock lock(mClientsMutex);
+  bool needFlush = false;
+  for (auto&& client: mClients) {
+    client->mSendBuffer.Append(data, size);
+    if (!body.empty()) {
+      client->mSendBuffer.Append(body.data(), body.size());
+    }
+    needFlush |= (client->mSendBuffer.size() >= FlushThreshold);
   }
-  return true;
+  if (needFlush) {
+    mSendNotifier->Notify();
+  }
+  return !mClients.empty();
+}
+
+void V2Server::Flush() {
+  mSendNotifier->Notify();
 }
 
 void V2Server::SetDevice(const OTDIPC::Messages::DeviceInfo& device) {
-  mDevice = device;
-  InitHeader(*mDevice, device.nonPersistentTabletId);
-  ;
+  auto msg = device;
+  InitHeader(msg, device.nonPersistentTabletId);
+  {
+    const std::unique_lock lock(mClientsMutex);
+    InsertOrAssign(mDevices, msg);
+  }
 
-  Send(*mDevice);
+  Send(msg);
+  Flush();
 }
 
 void V2Server::SetState(const OTDIPC::Messages::State& state) {
-  // Copy state to modify header
-  OTDIPC::Messages::State msg = state;
-  InitHeader(msg, mDevice->nonPersistentTabletId);
-
-  Send(msg);
+  if (!mStateQueue.TryPush(
+        {state, LatencyHistogram::Clock::now(), GetArrivalTime()})) {
+    mDroppedStateCount.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 void V2Server::SendDebugMessage(std::string_view message) {
-  // Calculate total size: Header + Message Body
-  const size_t totalSize = sizeof(OTDIPC::Messages::Header) + message.size();
-
-  std::vector<char> buffer(totalSize);
-  InitHeader(
-    *reinterpret_cast<OTDIPC::Messages::DebugMessage*>(buffer.data()),
-    0,
-    totalSize);
-
-  // Copy string data immediately after header
-  std::memcpy(
-    buffer.data() + sizeof(OTDIPC::Messages::Header),
-    message.data(),
-    message.size());
-
-  SendRaw(
-    reinterpret_cast<const OTDIPC::Messages::Header*>(buffer.data()),
-    totalSize);
+  // The text is staged straight after the header, so there's no need to
+  // build the whole message first
+  const OTDIPC::Messages::Header header {
+    .messageType = OTDIPC::Messages::DebugMessage::MESSAGE_TYPE,
+    .size = static_cast<uint32_t>(
+      sizeof(OTDIPC::Messages::Header) + message.size()),
+    .nonPersistentTabletId = 0,
+  };
+  SendRaw(&header, sizeof(header), std::as_bytes(std::span {message}));
 }
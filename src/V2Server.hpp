@@ -2,24 +2,36 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <atomic>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
-#include <thread>
+#include <vector>
 
+#include <OTDIPC/DebugMessage.hpp>
 #include <OTDIPC/DeviceInfo.hpp>
+#include <OTDIPC/Hello.hpp>
 #include <OTDIPC/State.hpp>
+#include "DeliveryPacing.hpp"
+#include "FrameParser.hpp"
 #include "IHandler.hpp"
-
-// clang-format off
-#include <Windows.h>
-#include <winsock2.h>// needed for wil/resource.h to define unique_socket
-#include <wil/resource.h>
-// clang-format on
-
-
+#include "InputFrame.hpp"
+#include "LatencyHistogram.hpp"
+#include "Reactor.hpp"
+#include "SendBuffer.hpp"
+#include "SharedStateRing.hpp"
+#include "SpscRing.hpp"
+#include "Transport.hpp"
+
+// OTD-IPC v2; platform-neutral, apart from the default transport, which is
+// chosen by `CreateUnixSocketListener()`.
+//
+// All socket I/O happens on the reactor thread; `SetState()` and friends
+// only stage messages, and notify the reactor.
 class V2Server final : public IHandler {
  public:
   struct Config {
@@ -28,6 +40,13 @@ class V2Server final : public IHandler {
     std::string humanVersion;// e.g. "v1.0.0 (Build 42)"
     std::string homepageUrl;// e.g. "https://example.com"
     std::filesystem::path socketPath;// Absolute path for the socket
+    // e.g. `%LOCALAPPDATA%/otd-ipc/servers/v2`
+    std::filesystem::path discoveryDir;
+    // Each client has a receive buffer of this size; larger messages from
+    // clients are skipped or rejected
+    std::size_t maxMessageSize {64 * 1024};
+    FrameParser::OversizedMessages oversizedMessages {
+      FrameParser::OversizedMessages::Skip};
   };
 
   enum class DefaultBehavior {
@@ -37,42 +56,130 @@ class V2Server final : public IHandler {
   };
 
   V2Server() = delete;
-  explicit V2Server(
+  V2Server(
+    Reactor&,
     Config config,
     DefaultBehavior = DefaultBehavior::SetIfUnset);
 
   ~V2Server() override;
 
+  // Listens on `Config::socketPath`
   void Start();
+  // Serves clients from any transport; `Config::socketPath` is still what's
+  // advertised for discovery
+  void Start(std::unique_ptr<Transport::IListener>);
   void Stop();
 
   void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override;
   void SetState(const OTDIPC::Messages::State& state) override;
+  void Flush() override;
   void SendDebugMessage(std::string_view message);
 
  private:
-  void AcceptLoop(std::stop_token);
-  void AcceptOnce(std::stop_token);
-  void PingLoop(std::stop_token);
+  struct Client;
+  struct QueuedState {
+    OTDIPC::Messages::State mState;
+    LatencyHistogram::Clock::time_point mQueuedAt;
+    // From `GetArrivalTime()`; for `LatencyStage::EndToEnd`
+    LatencyHistogram::Clock::time_point mArrivedAt;
+  };
 
-  bool SendRaw(const OTDIPC::Messages::Header* data, size_t size);
+  // Reactor callbacks
+  void AcceptClients();
+  void ReadFromClient(Client&);
+  void SendPing();
+  // Sends queued states and staged messages to every client, and removes
+  // disconnected clients
+  void SendPending();
+
+  void HandleMessage(Client&, OTDIPC::Messages::Header*);
+  void HandleDebugMessage(Client&, const OTDIPC::Messages::DebugMessage&);
+  void HandleHello(Client&, const OTDIPC::Messages::Hello&);
+  // The client is removed by the next `SendPending()`
+  void Disconnect(Client&);
+
+  // Stages the message for every connected client; it is not sent until the
+  // reactor is notified by `Flush()`, or a client's backlog reaches
+  // `FlushThreshold`.
+  //
+  // `body` is appended after the first `size` bytes, for variable-length
+  // messages; `data->size` is the total.
+  bool SendRaw(
+    const OTDIPC::Messages::Header* data,
+    size_t size,
+    std::span<const std::byte> body = {});
   template <class T>
     requires(!std::is_pointer_v<T>)
   bool Send(const T& data) {
     return SendRaw(&data, sizeof(T));
   }
 
+  // Caller must hold mClientsMutex; updates the client's lagging state, and
+  // returns false if the state should be skipped for this client
+  bool AdmitState(Client&, const QueuedState&);
+  // Caller must hold mClientsMutex
+  void QueueState(Client&, const QueuedState&);
+  // Caller must hold mClientsMutex
+  void QueueFrame(Client&, std::span<const QueuedState>);
+  // Caller must hold mClientsMutex; returns true if there's more to send
+  bool FlushClient(Client&);
+
+  // Handles a client's `DeliveryPacing` message
+  void SetPacing(Client&, const DeliveryPacing&);
+  // Caller must hold mClientsMutex; keeps the latest state for the client's
+  // next frame, but queues edges immediately
+  void PaceStates(Client&, std::span<const QueuedState>);
+  // Caller must hold mClientsMutex; queues the state kept by `PaceStates()`
+  void QueuePaced(Client&);
+  // Caller must hold mClientsMutex
+  void SchedulePacedDelivery(Client&);
+  // Reactor callback, at the client's frame deadline
+  void DeliverPaced(Client&);
+
   void PublishDiscovery();
   void EnsureDefaultExists();
 
   Config mConfig {};
   DefaultBehavior mDefaultBehavior {};
 
-  std::jthread mAcceptThread;
-  std::jthread mPingThread;
-
-  std::optional<OTDIPC::Messages::DeviceInfo> mDevice;
-
-  wil::unique_socket mListenSocket;
-  wil::unique_socket mClientSocket;
+  Reactor& mReactor;
+
+  // Only used on the reactor thread
+  std::unique_ptr<Transport::IListener> mListener;
+  Reactor::Registration mListenerWatch;
+  // Only registered while there are clients
+  Reactor::Registration mPingTimer;
+  uint64_t mPingSequenceNumber {};
+  LatencyHistogram::Clock::time_point mLastStateSentAt {};
+  // Only registered while a client has a backlog
+  Reactor::Registration mBacklogTimer;
+  uint64_t mReportedDropCount {};
+
+  // Written by the WinTab thread, read by the reactor; the WinTab thread
+  // never waits on the socket
+  SpscRing<QueuedState, 1024> mStateQueue;
+  std::atomic<uint64_t> mDroppedStateCount {};
+  std::unique_ptr<Reactor::Notifier> mSendNotifier;
+
+  // Only used on the reactor thread; reserved up front so that the steady
+  // state doesn't allocate
+  std::vector<QueuedState> mBatch;
+  std::vector<InputFrameSample> mFrameSamples;
+
+  // Written on the reactor thread; optional, as shared memory is an
+  // optimization for local clients, and failing to create it shouldn't stop
+  // the socket
+  std::unique_ptr<SharedStateRing> mStateRing;
+
+  // Declared before the clients, as they return their buffers to it
+  ReceiveBufferPool mReceiveBuffers;
+
+  // Guards everything below, which is used from the WinTab and reactor
+  // threads. Only the reactor thread touches client sockets.
+  std::mutex mClientsMutex;
+  // One per tablet; both are sent to new clients, so they don't need to wait
+  // for the pen to move
+  std::vector<OTDIPC::Messages::DeviceInfo> mDevices;
+  std::vector<OTDIPC::Messages::State> mLatestStates;
+  std::vector<std::unique_ptr<Client>> mClients;
 };
@@ -6,10 +6,13 @@
 #include "WintabTablet.hpp"
 
 #include <algorithm>
-#include <print>
+#include <cstring>
 #include <stdexcept>
 #include <thread>
-#include "InjectDll.hpp"
+#include "DriverWatcher.hpp"
+#include "LatencyHistogram.hpp"
+#include "Log.hpp"
+#include "PacketDecoder.hpp"
 #include "build-config.hpp"
 
 #include <wil/resource.h>
@@ -26,8 +29,19 @@
 // clang-format on
 // NOLINTEND(cppcoreguidelines-macro-to-enum)
 
+static_assert(PacketBits::Changed == PK_CHANGED);
+static_assert(PacketBits::Buttons == PK_BUTTONS);
+static_assert(PacketBits::X == PK_X);
+static_assert(PacketBits::Y == PK_Y);
+static_assert(PacketBits::Z == PK_Z);
+static_assert(PacketBits::NormalPressure == PK_NORMAL_PRESSURE);
+static_assert(PenPacket<PACKET>);
+
 namespace {
-WintabTablet* gInstance {nullptr};
+// Packet queue sizes for `PacketIngestion::Batched`; we start at the initial
+// size, and double it (up to the max) whenever a drain finds the queue full.
+constexpr int InitialQueueSize = 128;
+constexpr int MaxQueueSize = 1024;
 
 template <std::size_t N>
 void to_buffer(char (&dest)[N], const std::string_view src) {
@@ -36,7 +50,7 @@ void to_buffer(char (&dest)[N], const std::string_view src) {
 }
 
 template <std::size_t DriverBitness>
-void hijack(const std::wstring_view executableFileName) {
+std::unique_ptr<DriverWatcher> hijack(const std::wstring_view executableFileName) {
   constexpr auto ArchBitness = sizeof(void*) * 8;
   if constexpr (DriverBitness != ArchBitness) {
     const auto message = std::format(
@@ -49,7 +63,8 @@ void hijack(const std::wstring_view executableFileName) {
     const auto name = wil::GetModuleFileNameW(nullptr);
     const auto hijackDll = std::filesystem::path {name.get()}.parent_path()
       / BuildConfig::HijackDllName;
-    InjectDllByExecutableFileName(executableFileName, hijackDll);
+    return std::make_unique<DriverWatcher>(
+      std::wstring {executableFileName}, hijackDll);
   }
 }
 
@@ -61,7 +76,9 @@ void hijack(const std::wstring_view executableFileName) {
   IT(WTOpenW) \
   IT(WTClose) \
   IT(WTOverlap) \
-  IT(WTPacket)
+  IT(WTPacket) \
+  IT(WTPacketsGet) \
+  IT(WTQueueSizeSet)
 
 class WintabTablet::LibWintab {
  public:
@@ -117,68 +134,180 @@ class WintabTablet::LibWintab {
   wil::unique_hmodule mWintab = 0;
 };
 
+class WintabTablet::PacketBuffer {
+ public:
+  std::vector<PACKET> mPackets;
+};
+
 WintabTablet::WintabTablet(
   HWND window,
   IHandler* handler,
-  const std::optional<InjectableBuggyDriver> injectInto)
+  const std::optional<InjectableBuggyDriver> injectInto,
+  const PacketIngestion packetIngestion,
+  DeviceCache* const deviceCache)
   : mWindow(window),
     mHandler(handler),
     mWintab(new LibWintab()),
-    mForegroundOverride(window) {
-  if (gInstance) {
-    throw std::runtime_error("Only one WintabTablet at a time!");
+    mForegroundOverride(window),
+    mPacketIngestion(packetIngestion),
+    mDeviceCache(deviceCache) {
+  if (mDeviceCache) {
+    // Cached devices may already have been published with their IDs
+    for (auto&& entry: mDeviceCache->GetEntries()) {
+      mNextTabletID
+        = std::max(mNextTabletID, entry.mInfo.nonPersistentTabletId + 1);
+    }
+  }
+
+  if (GetWindowLongPtrW(window, GWLP_USERDATA)) {
+    throw std::runtime_error("Only one WintabTablet per window!");
   }
   if (!*mWintab) {
     throw std::runtime_error("Failed to load WINTAB32.dll");
   }
 
-  gInstance = this;
+  // Found again by `ProcessMessage()`
+  SetWindowLongPtrW(window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
 
   if (injectInto) {
     using enum InjectableBuggyDriver;
-    const auto dll
-      = absolute(std::filesystem::path {BuildConfig::HijackDllName});
     switch (*injectInto) {
       case Huion:
-        hijack<64>(L"HuionTabletCore.exe");
+        mDriverWatcher = hijack<64>(L"HuionTabletCore.exe");
         break;
       case HuionAlternate:
-        hijack<64>(L"TabletDriver.exe");
+        mDriverWatcher = hijack<64>(L"TabletDriver.exe");
         break;
       case Gaomon:
-        hijack<32>(L"TabletDriver.exe");
+        mDriverWatcher = hijack<32>(L"TabletDriver.exe");
         break;
       case XPPen:
-        hijack<32>(L"XPPenTablet.exe");
+        mDriverWatcher = hijack<32>(L"XPPenTablet.exe");
         break;
     }
   }
 
-  ConnectToTablet();
+  ConnectToTablets();
 }
 
 WintabTablet::~WintabTablet() {
-  gInstance = nullptr;
-  if (mWintab && mContext) {
-    mWintab->WTClose(std::exchange(mContext, nullptr));
+  SetWindowLongPtrW(mWindow, GWLP_USERDATA, 0);
+  for (auto&& device: mDevices) {
+    mWintab->WTClose(device.mContext);
   }
 }
 
-void WintabTablet::ConnectToTablet() {
-  if (!mWintab) {
-    return;
+void WintabTablet::CaptureTo(const std::filesystem::path& path) {
+  mCapture = std::make_unique<PacketTraceWriter>(path);
+  for (auto&& device: mDevices) {
+    mCapture->WriteDevice(device.mInfo, static_cast<uint8_t>(device.mIndex));
   }
+  Log::Info("Capturing packets to `{}`", path.string());
+}
 
+void WintabTablet::ConnectToTablets() {
+  UINT extensionPacketData = 0;
+  for (UINT i = 0, tag = 0; mWintab->WTInfoW(WTI_EXTENSIONS + i, EXT_TAG, &tag);
+       ++i) {
+    if (tag == WTX_EXPKEYS2 || tag == WTX_OBT) {
+      mWintab->WTInfoW(WTI_EXTENSIONS + i, EXT_MASK, &extensionPacketData);
+      break;
+    }
+  }
+
+  // Some drivers report zero devices, but still have one
+  UINT deviceCount = 0;
+  mWintab->WTInfoW(WTI_INTERFACE, IFC_NDEVICES, &deviceCount);
+  const uint32_t quirks
+    = (deviceCount == 0) ? DeviceCache::ReportsNoDevices : 0;
+  deviceCount = std::clamp<UINT>(
+    deviceCount, 1, static_cast<UINT>(PacketTraceEvent::MaxDevices));
+
+  mDevices.reserve(deviceCount);
+  for (UINT i = 0; i < deviceCount; ++i) {
+    try {
+      OpenContext(i, extensionPacketData, quirks);
+    } catch (const std::exception& e) {
+      Log::Error("Skipping WinTab device {}: {}", i, e.what());
+    }
+  }
+  if (mDevices.empty()) {
+    throw std::runtime_error("Failed to open wintab tablet");
+  }
+}
+
+void WintabTablet::OpenContext(
+  const UINT deviceIndex,
+  const UINT extensionPacketData,
+  uint32_t quirks) {
   constexpr std::wstring_view contextName {L"OTDIPC-WinTab-Adapter"};
 
+  const auto category = WTI_DEVICES + deviceIndex;
+  DeviceCache::Entry capabilities {
+    .mIndex = deviceIndex,
+    .mExtensionPacketData = extensionPacketData,
+  };
+  auto& info = capabilities.mInfo;
+
+  // Populate ID
+  if (const auto pnpId = mWintab->GetInfoString(category, DVC_PNPID);
+      !pnpId.empty()) {
+    std::format_to_n(
+      info.persistentId,
+      std::size(info.persistentId),
+      "wintab-pnpid:{}",
+      pnpId);
+  } else if (const auto interfaceId
+             = mWintab->GetInfoString(WTI_INTERFACE, IFC_WINTABID);
+             !interfaceId.empty()) {
+    // The interface ID is shared by every device
+    if (deviceIndex == 0) {
+      std::format_to_n(
+        info.persistentId,
+        std::size(info.persistentId),
+        "wintab-id:{}",
+        interfaceId);
+    } else {
+      std::format_to_n(
+        info.persistentId,
+        std::size(info.persistentId),
+        "wintab-id:{}#{}",
+        interfaceId,
+        deviceIndex);
+    }
+  }
+
+  // The rest of the queries, and opening the context, can be slow while the
+  // driver is starting up; publish what we cached as soon as we know it's the
+  // same device
+  const auto cached = (mDeviceCache && !info.GetPersistentId().empty())
+    ? mDeviceCache->Find(info.GetPersistentId(), deviceIndex)
+    : nullptr;
+  if (cached) {
+    mHandler->SetDevice(cached->mInfo);
+    Log::Info(
+      "Published cached info for WinTab tablet {} as tablet ID {}",
+      deviceIndex,
+      cached->mInfo.nonPersistentTabletId);
+  }
+
+  // Per-device default contexts are from WinTab 1.1; older drivers only have
+  // the one default context, for the first device
   LOGCONTEXTW logicalContext {};
-  mWintab->WTInfoW(WTI_DEFCONTEXT, 0, &logicalContext);
+  if (!mWintab->WTInfoW(WTI_DDCTXS + deviceIndex, 0, &logicalContext)) {
+    if (deviceIndex != 0) {
+      throw std::runtime_error("No default context");
+    }
+    mWintab->WTInfoW(WTI_DEFCONTEXT, 0, &logicalContext);
+    quirks |= DeviceCache::NoDeviceContext;
+  }
   wcsncpy_s(
     static_cast<wchar_t*>(logicalContext.lcName),
     std::size(logicalContext.lcName),
     contextName.data(),
     contextName.size());
-  logicalContext.lcPktData = PACKETDATA;
+  logicalContext.lcDevice = deviceIndex;
+  logicalContext.lcPktData = PACKETDATA | extensionPacketData;
   logicalContext.lcMoveMask = PACKETDATA;
   logicalContext.lcPktMode = PACKETMODE;
   logicalContext.lcOptions = CXO_MESSAGES;
@@ -186,68 +315,162 @@ void WintabTablet::ConnectToTablet() {
   logicalContext.lcBtnUpMask = ~0;
   logicalContext.lcSysMode = false;
 
+  capabilities.mQuirks = quirks;
   AXIS axis;
 
-  mWintab->WTInfoW(WTI_DEVICES, DVC_X, &axis);
+  mWintab->WTInfoW(category, DVC_X, &axis);
+  capabilities.mMinX = axis.axMin;
+  capabilities.mMaxX = axis.axMax;
   logicalContext.lcInOrgX = axis.axMin;
   logicalContext.lcInExtX = axis.axMax - axis.axMin;
   logicalContext.lcOutOrgX = 0;
   logicalContext.lcOutExtX = logicalContext.lcInExtX;
 
-  mWintab->WTInfoW(WTI_DEVICES, DVC_Y, &axis);
+  mWintab->WTInfoW(category, DVC_Y, &axis);
+  capabilities.mMinY = axis.axMin;
+  capabilities.mMaxY = axis.axMax;
   logicalContext.lcInOrgY = axis.axMin;
   logicalContext.lcInExtY = axis.axMax - axis.axMin;
   logicalContext.lcOutOrgY = 0,
   logicalContext.lcOutExtY = logicalContext.lcInExtY;
 
-  mWintab->WTInfoW(WTI_DEVICES, DVC_NPRESSURE, &axis);
+  mWintab->WTInfoW(category, DVC_NPRESSURE, &axis);
+  capabilities.mMaxPressure = axis.axMax;
 
-  for (UINT i = 0, tag = 0; mWintab->WTInfoW(WTI_EXTENSIONS + i, EXT_TAG, &tag);
-       ++i) {
-    if (tag == WTX_EXPKEYS2 || tag == WTX_OBT) {
-      UINT mask = 0;
-      mWintab->WTInfoW(WTI_EXTENSIONS + i, EXT_MASK, &mask);
-      logicalContext.lcPktData |= mask;
-      break;
-    }
+  Device device {.mIndex = deviceIndex};
+  device.mContext = mWintab->WTOpenW(mWindow, &logicalContext, true);
+  if (!device.mContext) {
+    throw std::runtime_error("Failed to open wintab tablet");
+  }
+
+  info.maxX = static_cast<float>(logicalContext.lcOutExtX);
+  info.maxY = static_cast<float>(logicalContext.lcOutExtY);
+  info.maxPressure = static_cast<uint32_t>(axis.axMax);
+
+  to_buffer(info.name, mWintab->GetInfoString(category, DVC_NAME));
+
+  const bool changed = UpdateDeviceCache(capabilities);
+  device.mInfo = info;
+  device.mState.nonPersistentTabletId = info.nonPersistentTabletId;
+  Log::Info(
+    "Opened wintab tablet {} as tablet ID {}",
+    deviceIndex,
+    info.nonPersistentTabletId);
+
+  auto& added = mDevices.emplace_back(device);
+  if (mPacketIngestion == PacketIngestion::Batched) {
+    ResizeQueue(added, InitialQueueSize);
   }
+  if (mCapture) {
+    mCapture->WriteDevice(added.mInfo, static_cast<uint8_t>(deviceIndex));
+  }
+  if (changed) {
+    mHandler->SetDevice(added.mInfo);
+  }
+  ActivateContext(added);
+}
 
-  mContext = mWintab->WTOpenW(mWindow, &logicalContext, true);
-  if (!mContext) {
-    throw new std::runtime_error("Failed to open wintab tablet");
+bool WintabTablet::UpdateDeviceCache(DeviceCache::Entry& entry) {
+  auto& info = entry.mInfo;
+  const auto persistentId = info.GetPersistentId();
+  if (!mDeviceCache || persistentId.empty()) {
+    info.nonPersistentTabletId = mNextTabletID++;
+    return true;
   }
-  std::println("Opened wintab tablet");
 
-  mDeviceInfo.maxX = static_cast<float>(logicalContext.lcOutExtX);
-  mDeviceInfo.maxY = static_cast<float>(logicalContext.lcOutExtY);
-  mDeviceInfo.maxPressure = static_cast<uint32_t>(axis.axMax);
+  const auto cached = mDeviceCache->Find(persistentId, entry.mIndex);
+  if (!cached) {
+    info.nonPersistentTabletId = mNextTabletID++;
+    mDeviceCache->Update(entry);
+    return true;
+  }
 
-  to_buffer(mDeviceInfo.name, mWintab->GetInfoString(WTI_DEVICES, DVC_NAME));
+  info.nonPersistentTabletId = cached->mInfo.nonPersistentTabletId;
+  // Clients already have the cached `DeviceInfo`; only resend it if that's
+  // what changed, not just the axes or quirks
+  const bool infoChanged
+    = std::memcmp(&cached->mInfo, &info, sizeof(info)) != 0;
+  if (!mDeviceCache->Update(entry)) {
+    Log::Info("Cached capabilities of `{}` are correct", persistentId);
+    return false;
+  }
+  Log::Info(
+    "Capabilities of `{}` have changed since they were cached", persistentId);
+  return infoChanged;
+}
 
-  // Populate ID
-  if (const auto pnpId = mWintab->GetInfoString(WTI_DEVICES, DVC_PNPID);
-      !pnpId.empty()) {
-    std::format_to_n(
-      mDeviceInfo.persistentId,
-      std::size(mDeviceInfo.persistentId),
-      "wintab-pnpid:{}",
-      pnpId);
-  } else if (const auto interfaceId
-             = mWintab->GetInfoString(WTI_INTERFACE, IFC_WINTABID);
-             !interfaceId.empty()) {
-    std::format_to_n(
-      mDeviceInfo.persistentId,
-      std::size(mDeviceInfo.persistentId),
-      "wintab-id:{}",
-      interfaceId);
+WintabTablet::Device& WintabTablet::GetDevice(HCTX const context) {
+  for (auto&& device: mDevices) {
+    if (device.mContext == context) {
+      return device;
+    }
   }
+  return mDevices.front();
+}
 
-  mHandler->SetDevice(mDeviceInfo);
-  ActivateContext();
+void WintabTablet::ActivateContext(const Device& device) {
+  mWintab->WTOverlap(device.mContext, TRUE);
 }
 
-void WintabTablet::ActivateContext() {
-  mWintab->WTOverlap(mContext, TRUE);
+void WintabTablet::ResizeQueue(Device& device, const int desiredSize) {
+  if (!mPacketBuffer) {
+    mPacketBuffer = std::make_unique<PacketBuffer>();
+  }
+
+  // If this fails, the context is left without a queue at all; the spec says
+  // to keep retrying with smaller sizes until it succeeds.
+  for (int size = desiredSize; size > 0; size /= 2) {
+    if (mWintab->WTQueueSizeSet(device.mContext, size)) {
+      device.mQueueSize = size;
+      const auto bufferSize = std::max(
+        mPacketBuffer->mPackets.size(), static_cast<std::size_t>(size));
+      mPacketBuffer->mPackets.resize(bufferSize);
+      mStateBatch.resize(bufferSize);
+      Log::Info(
+        "Using a WinTab packet queue size of {} for tablet ID {}",
+        size,
+        device.mInfo.nonPersistentTabletId);
+      return;
+    }
+  }
+  throw std::runtime_error("Failed to set a WinTab packet queue size");
+}
+
+void WintabTablet::DrainPackets(
+  Device& device,
+  HCTX const context,
+  const std::chrono::steady_clock::time_point received) {
+  auto& packets = mPacketBuffer->mPackets;
+  const auto capacity = device.mQueueSize;
+  const auto count = mWintab->WTPacketsGet(context, capacity, packets.data());
+  if (count <= 0) {
+    // Already drained by a previous WT_PACKET
+    return;
+  }
+  if (mCapture) {
+    for (int i = 0; i < count; ++i) {
+      mCapture->WritePacket(
+        packets[static_cast<std::size_t>(i)],
+        static_cast<uint8_t>(device.mIndex));
+    }
+  }
+
+  const auto decoded = DecodePackets(
+    std::span {std::as_const(packets)}.first(static_cast<std::size_t>(count)),
+    device.mInfo.maxY,
+    device.mState,
+    std::span {mStateBatch});
+  GetLatencyHistogram(LatencyStage::Decode)
+    .Record(LatencyHistogram::Clock::now() - received);
+  mHandler->SetStates(std::span {std::as_const(mStateBatch)}.first(decoded));
+
+  // A full queue means we've probably lost packets; resizing also flushes
+  // the queue, but it's about to overflow anyway
+  if (
+    count == capacity && capacity < MaxQueueSize
+    && context == device.mContext) {
+    ResizeQueue(device, std::min(capacity * 2, MaxQueueSize));
+  }
 }
 
 bool WintabTablet::CanProcessMessage(UINT message) {
@@ -263,43 +486,63 @@ bool WintabTablet::ProcessMessage(
   if (!CanProcessMessage(message)) {
     return false;
   }
-  if (!gInstance) {
+  const auto self
+    = reinterpret_cast<WintabTablet*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+  if (!self) {
     return false;
   }
-  if (gInstance->mWindow != hwnd) {
-    return false;
+
+  const auto received = LatencyHistogram::Clock::now();
+  const ScopedArrivalTime arrival(received);
+  if (
+    message == WT_PACKET
+    && self->mPacketIngestion == PacketIngestion::Batched) {
+    const auto context = reinterpret_cast<HCTX>(lParam);
+    self->DrainPackets(self->GetDevice(context), context, received);
+    return true;
   }
 
-  if (gInstance->ProcessMessageImpl(message, wParam, lParam)) {
-    gInstance->mHandler->SetState(gInstance->mState);
+  if (const auto device = self->ProcessMessageImpl(message, wParam, lParam)) {
+    GetLatencyHistogram(LatencyStage::Decode)
+      .Record(LatencyHistogram::Clock::now() - received);
+    self->mHandler->SetState(device->mState);
     return true;
   }
 
-  return false;
+  return message == WT_CTXOVERLAP;
 }
 
-bool WintabTablet::ProcessMessageImpl(
+WintabTablet::Device* WintabTablet::ProcessMessageImpl(
   UINT message,
   WPARAM wParam,
   LPARAM lParam) {
-  using Bits = OTDIPC::Messages::State::ValidMask;
-
   if (message == WT_PROXIMITY) {
     // high word indicates hardware events, low word indicates
     // context enter/leave
-    mState.penIsNearSurface = (lParam & 0xffff);
-    mState.validBits |= Bits::PenIsNearSurface;
-    return true;
+    auto& device = GetDevice(reinterpret_cast<HCTX>(wParam));
+    const bool isNearSurface = (lParam & 0xffff);
+    if (mCapture) {
+      mCapture->WriteProximity(
+        isNearSurface, static_cast<uint8_t>(device.mIndex));
+    }
+    ApplyProximity(isNearSurface, device.mState);
+    return &device;
   }
 
   if (message == WT_CTXOVERLAP) {
-    if (
-      reinterpret_cast<HCTX>(wParam) == mContext
-      && !(static_cast<UINT>(lParam) & CXS_ONTOP)) {
-      std::println("Tablet context lost, regaining");
-      ActivateContext();
+    const auto context = reinterpret_cast<HCTX>(wParam);
+    if (static_cast<UINT>(lParam) & CXS_ONTOP) {
+      return nullptr;
     }
-    return true;
+    for (auto&& device: mDevices) {
+      if (device.mContext == context) {
+        Log::Info(
+          "Tablet context lost for tablet ID {}, regaining",
+          device.mInfo.nonPersistentTabletId);
+        ActivateContext(device);
+      }
+    }
+    return nullptr;
   };
 
   // Use the context from the param instead of our stored context so we
@@ -310,46 +553,37 @@ bool WintabTablet::ProcessMessageImpl(
     PACKET packet {};
     const auto ctx = reinterpret_cast<HCTX>(lParam);
     if (!mWintab->WTPacket(ctx, static_cast<UINT>(wParam), &packet)) {
-      return false;
-    }
-    if (packet.pkChanged & PK_X) {
-      mState.x = static_cast<float>(packet.pkX);
-      mState.validBits |= Bits::PositionX;
-    }
-    if (packet.pkChanged & PK_Y) {
-      mState.y = mDeviceInfo.maxY - static_cast<float>(packet.pkY);
-      mState.validBits |= Bits::PositionY;
+      return nullptr;
     }
-    if (packet.pkChanged & PK_Z) {
-      mState.hoverDistance = static_cast<float>(packet.pkZ);
-      mState.validBits |= Bits::HoverDistance;
+    auto& device = GetDevice(ctx);
+    if (mCapture) {
+      mCapture->WritePacket(packet, static_cast<uint8_t>(device.mIndex));
     }
-    if (packet.pkChanged & PK_NORMAL_PRESSURE) {
-      mState.pressure = packet.pkNormalPressure;
-      mState.validBits |= Bits::Pressure;
-    }
-    if (packet.pkChanged & PK_BUTTONS) {
-      mState.penButtons = static_cast<uint32_t>(packet.pkButtons);
-      mState.validBits |= Bits::PenButtons;
-    }
-    return true;
+    ApplyPacket(packet, device.mInfo.maxY, device.mState);
+    return &device;
   }
 
   if (message == WT_PACKETEXT) {
     PACKETEXT packet;
     auto ctx = reinterpret_cast<HCTX>(lParam);
     if (!mWintab->WTPacket(ctx, static_cast<UINT>(wParam), &packet)) {
-      return false;
+      return nullptr;
     }
-    const uint16_t mask = 1ui16 << packet.pkExpKeys.nControl;
-    if (packet.pkExpKeys.nState) {
-      mState.auxButtons |= mask;
-    } else {
-      mState.auxButtons &= ~mask;
+    auto& device = GetDevice(ctx);
+    if (!ApplyExpressKey(
+          packet.pkExpKeys.nControl,
+          packet.pkExpKeys.nState != 0,
+          device.mState)) {
+      return nullptr;
     }
-    mState.validBits |= Bits::AuxButtons;
-    return true;
+    if (mCapture) {
+      mCapture->WriteExpressKey(
+        packet.pkExpKeys.nControl,
+        packet.pkExpKeys.nState != 0,
+        static_cast<uint8_t>(device.mIndex));
+    }
+    return &device;
   }
 
-  return false;
+  return nullptr;
 }
@@ -2,15 +2,21 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include "DeviceCache.hpp"
+#include "DriverWatcher.hpp"
 #include "ForegroundOverride.hpp"
 #include "IHandler.hpp"
+#include "PacketTrace.hpp"
 
 #include <Windows.h>
 
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 struct HCTX__;
 
@@ -23,13 +29,27 @@ class WintabTablet final {
     XPPen,
   };
 
+  enum class PacketIngestion {
+    // Call `WTPacket()` for each `WT_PACKET` message
+    PerMessage,
+    // Drain the whole queue with `WTPacketsGet()` on the first `WT_PACKET`,
+    // and pass the result on as a single batch
+    Batched,
+  };
+
   WintabTablet() = delete;
   WintabTablet(
     HWND window,
     IHandler* handler,
-    std::optional<InjectableBuggyDriver>);
+    std::optional<InjectableBuggyDriver>,
+    PacketIngestion = PacketIngestion::PerMessage,
+    DeviceCache* = nullptr);
   ~WintabTablet();
 
+  // Record every packet, proximity change, and express key to a trace that
+  // can be replayed with `ReplayPacketTrace()`
+  void CaptureTo(const std::filesystem::path&);
+
   [[nodiscard]]
   static bool
   ProcessMessage(HWND window, UINT message, WPARAM wParam, LPARAM lParam);
@@ -37,22 +57,68 @@ class WintabTablet final {
  private:
   class LibWintab;
 
+  // Each WinTab device has its own context, tablet ID, and state
+  struct Device {
+    HCTX__* mContext {nullptr};
+    // Also used as the device index in packet traces
+    UINT mIndex {};
+    OTDIPC::Messages::DeviceInfo mInfo {};
+    OTDIPC::Messages::State mState {};
+    // Only used for `PacketIngestion::Batched`
+    int mQueueSize {};
+  };
+
   HWND mWindow {nullptr};
   ForegroundOverride mForegroundOverride;
+  // Only if we're hijacking a driver
+  std::unique_ptr<DriverWatcher> mDriverWatcher;
   IHandler* mHandler {nullptr};
   std::unique_ptr<LibWintab> mWintab;
-  HCTX__* mContext {nullptr};
+  PacketIngestion mPacketIngestion {PacketIngestion::PerMessage};
+  std::unique_ptr<PacketTraceWriter> mCapture;
+
+  // Optional. Cached devices are passed to the handler as soon as WinTab
+  // reports their ID, before the slower queries; they keep their tablet IDs,
+  // and are only passed on again if they've changed. Devices that WinTab
+  // doesn't report are never passed on, as clients can't be told to forget
+  // them.
+  DeviceCache* mDeviceCache {nullptr};
 
   std::uint32_t mNextTabletID {1};
+  // There are rarely more than two, so finding a context's device is a
+  // linear search
+  std::vector<Device> mDevices;
 
-  OTDIPC::Messages::DeviceInfo mDeviceInfo {};
-  OTDIPC::Messages::State mState {};
+  // Only used for `PacketIngestion::Batched`; shared by every device, as
+  // they're drained one at a time
+  class PacketBuffer;
+  std::unique_ptr<PacketBuffer> mPacketBuffer;
+  std::vector<OTDIPC::Messages::State> mStateBatch;
+
+  void ConnectToTablets();
+  void OpenContext(
+    UINT deviceIndex,
+    UINT extensionPacketData,
+    uint32_t quirks);
+  // Use the cached tablet ID, and check the rest against the cache; returns
+  // false if the cached device info, which has already been passed to the
+  // handler, is correct
+  bool UpdateDeviceCache(DeviceCache::Entry&);
+  // Messages forwarded from another window or process have a context we
+  // didn't open; they're attributed to the first device
+  [[nodiscard]]
+  Device& GetDevice(HCTX__* context);
 
-  void ActivateContext();
+  void ActivateContext(const Device&);
+  void ResizeQueue(Device&, int desiredSize);
+  void DrainPackets(
+    Device&,
+    HCTX__* context,
+    std::chrono::steady_clock::time_point received);
 
-  void ConnectToTablet();
   [[nodiscard]]
   static bool CanProcessMessage(UINT message);
+  // Returns the device whose state changed, if any
   [[nodiscard]]
-  bool ProcessMessageImpl(UINT message, WPARAM wParam, LPARAM lParam);
+  Device* ProcessMessageImpl(UINT message, WPARAM wParam, LPARAM lParam);
 };
@@ -0,0 +1,38 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Replaces the global allocation functions, so benchmarks can report
+// allocations per operation.
+//
+// The array and `nothrow` forms call these by default, so they don't need
+// replacing.
+
+#include "Benchmark.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+constinit std::atomic<std::uint64_t> gAllocationCount {0};
+}// namespace
+
+std::uint64_t Bench::GetAllocationCount() {
+  return gAllocationCount.load(std::memory_order_relaxed);
+}
+
+void* operator new(const std::size_t size) {
+  gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (const auto ret = std::malloc(size ? size : 1)) {
+    return ret;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* const p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* const p, std::size_t) noexcept {
+  std::free(p);
+}
@@ -0,0 +1,70 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Minimal benchmark harness; each benchmark registers itself with
+// `BENCHMARK(name)`, and prints its own results with `Report()`
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+struct Benchmark {
+  std::string_view mName;
+  void (*mRun)() {nullptr};
+};
+
+std::vector<Benchmark>& GetRegistry();
+
+struct Registration {
+  Registration(std::string_view name, void (*run)());
+};
+
+// Print `count` operations over `elapsed` as ns/op and ops/s
+void Report(
+  std::string_view label,
+  std::uint64_t count,
+  Clock::duration elapsed);
+
+// Print an arbitrary named value
+void Report(std::string_view label, double value, std::string_view unit);
+
+// Number of calls to the global `operator new` so far, from any thread.
+//
+// Over-aligned allocations aren't counted.
+std::uint64_t GetAllocationCount();
+
+// Stop the compiler from discarding a computed value
+template <class T>
+void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  // An empty asm statement that claims to read `value`; small values can stay
+  // in a register, anything else must be in memory
+  if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*)) {
+    asm volatile("" : : "r"(value) : "memory");
+  } else {
+    asm volatile("" : : "m"(value) : "memory");
+  }
+#else
+  // No inline assembly on MSVC x64: publish the address, and read it back so
+  // that the store isn't dead
+  static const void* volatile sink {nullptr};
+  sink = &value;
+  [[maybe_unused]] const void* const read = sink;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+}// namespace Bench
+
+#define BENCHMARK(NAME) \
+  static void Bench_##NAME(); \
+  static const ::Bench::Registration BenchRegistration_##NAME { \
+    #NAME, &Bench_##NAME}; \
+  static void Bench_##NAME()
@@ -0,0 +1,244 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// `Calibration` throughput, with and without SIMD, and accuracy against
+// synthetic distortions.
+//
+// Accuracy is in tablet units, on a 32767x32767 tablet area; the SIMD and
+// scalar paths must agree, and the benchmark aborts if they don't.
+
+#include "../Calibration.hpp"
+#include "../CalibrationStage.hpp"
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace {
+
+using State = OTDIPC::Messages::State;
+
+constexpr float MaxX = 32767;
+constexpr float MaxY = 32767;
+// A second's worth of 1kHz samples from four tablets
+constexpr std::size_t BatchSize = 4000;
+
+std::vector<State> MakeStates(const std::size_t count) {
+  std::mt19937 rng {42};
+  std::uniform_real_distribution<float> x(0, MaxX);
+  std::uniform_real_distribution<float> y(0, MaxY);
+  std::vector<State> ret(count);
+  for (auto&& it: ret) {
+    it.validBits = State::ValidMask::Position;
+    it.x = x(rng);
+    it.y = y(rng);
+  }
+  return ret;
+}
+
+// A smooth, non-linear correction in normalized coordinates: a barrel
+// distortion, plus a skew that's stronger at the bottom
+std::array<double, 2> Warp(const double u, const double v) {
+  const auto du = u - 0.5;
+  const auto dv = v - 0.5;
+  const auto scale = 1 - (0.08 * ((du * du) + (dv * dv)));
+  return {
+    0.5 + (du * scale) + (0.02 * v * v),
+    0.5 + (dv * scale) + (0.01 * std::sin(std::numbers::pi * u)),
+  };
+}
+
+Calibration::Grid SampleWarp(const uint32_t size) {
+  Calibration::Grid ret {.columns = size, .rows = size};
+  for (uint32_t row = 0; row < size; ++row) {
+    for (uint32_t column = 0; column < size; ++column) {
+      const auto [x, y] = Warp(
+        static_cast<double>(column) / (size - 1),
+        static_cast<double>(row) / (size - 1));
+      ret.x.push_back(static_cast<float>(x));
+      ret.y.push_back(static_cast<float>(y));
+    }
+  }
+  return ret;
+}
+
+// The distortion that an affine calibration corrects: rotated by 2 degrees
+// around the center, 3% too small, and offset
+Calibration::Affine MakeAffineCorrection() {
+  const auto angle = 2 * std::numbers::pi / 180;
+  const auto scale = 0.97;
+  const double a = scale * std::cos(angle);
+  const double b = -scale * std::sin(angle);
+  const double c = scale * std::sin(angle);
+  const double d = scale * std::cos(angle);
+  const double e = 0.5 - (0.5 * a) - (0.5 * b) + 0.01;
+  const double f = 0.5 - (0.5 * c) - (0.5 * d) - 0.015;
+
+  // Invert [a b e; c d f]
+  const auto det = (a * d) - (b * c);
+  const auto ia = d / det;
+  const auto ib = -b / det;
+  const auto ic = -c / det;
+  const auto id = a / det;
+  return {{
+    static_cast<float>(ia),
+    static_cast<float>(ib),
+    static_cast<float>(-((ia * e) + (ib * f))),
+    static_cast<float>(ic),
+    static_cast<float>(id),
+    static_cast<float>(-((ic * e) + (id * f))),
+  }};
+}
+
+void CheckAgreement(const char* label, const Calibration& calibration) {
+  auto simd = MakeStates(BatchSize + 3);
+  auto scalar = simd;
+  calibration.Apply(simd);
+  calibration.ApplyScalar(scalar);
+  double maxDelta = 0;
+  for (std::size_t i = 0; i < simd.size(); ++i) {
+    maxDelta = std::max<double>(
+      {maxDelta,
+       std::abs(simd[i].x - scalar[i].x),
+       std::abs(simd[i].y - scalar[i].y)});
+  }
+  // Only fused multiply-adds could make them differ at all
+  if (maxDelta > 0.01) {
+    std::fprintf(
+      stderr, "%s: SIMD and scalar differ by %g\n", label, maxDelta);
+    std::abort();
+  }
+}
+
+void MeasureThroughput(const char* label, const Calibration& calibration) {
+  CheckAgreement(label, calibration);
+
+  const auto original = MakeStates(BatchSize);
+  auto states = original;
+  constexpr std::size_t Iterations = 500;
+  char buf[128] {};
+  for (const auto simd: {true, false}) {
+    const auto start = Bench::Clock::now();
+    for (std::size_t i = 0; i < Iterations; ++i) {
+      if (simd) {
+        calibration.Apply(states);
+      } else {
+        calibration.ApplyScalar(states);
+      }
+      Bench::DoNotOptimize(states);
+    }
+    const auto elapsed = Bench::Clock::now() - start;
+    std::snprintf(
+      buf, sizeof(buf), "%s, %s", label, simd ? "SIMD" : "scalar");
+    Bench::Report(buf, BatchSize * Iterations, elapsed);
+  }
+}
+
+}// namespace
+
+BENCHMARK(CalibrationThroughput) {
+  MeasureThroughput(
+    "affine", Calibration {MakeAffineCorrection(), MaxX, MaxY});
+  MeasureThroughput("17x17 grid", Calibration {SampleWarp(17), MaxX, MaxY});
+
+  // As `main()` uses it: a copy, then calibration per tablet
+  struct NullSink {
+    void SetDevice(const OTDIPC::Messages::DeviceInfo&) {
+    }
+    void SetState(const State& state) {
+      Bench::DoNotOptimize(state);
+    }
+    void SetStates(const std::span<const State> states) {
+      Bench::DoNotOptimize(states);
+    }
+    void Flush() {
+    }
+  };
+  Pipeline pipeline {
+    CalibrationStage {{{.mPersistentId = "*", .mTransform = SampleWarp(17)}}},
+    NullSink {},
+  };
+  OTDIPC::Messages::DeviceInfo device;
+  device.maxX = MaxX;
+  device.maxY = MaxY;
+  pipeline.SetDevice(device);
+
+  // WinTab batches are small; this is a typical one
+  const auto states = MakeStates(8);
+  constexpr std::size_t Iterations = 200'000;
+  pipeline.SetStates(states);
+  const auto allocations = Bench::GetAllocationCount();
+  const auto start = Bench::Clock::now();
+  for (std::size_t i = 0; i < Iterations; ++i) {
+    pipeline.SetStates(states);
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+  Bench::Report("stage, 8-state batches", states.size() * Iterations, elapsed);
+  Bench::Report(
+    "stage allocations per batch",
+    static_cast<double>(Bench::GetAllocationCount() - allocations)
+      / Iterations,
+    "");
+}
+
+BENCHMARK(CalibrationAccuracy) {
+  // Distort, then correct; positions near the edges would be clamped
+  {
+    const auto correction = MakeAffineCorrection();
+    const Calibration calibration {correction, MaxX, MaxY};
+    const auto& m = correction.m;
+    // The inverse of the correction is the distortion
+    const auto det = (m[0] * m[4]) - (m[1] * m[3]);
+    double maxError = 0;
+    for (int row = 1; row < 64; ++row) {
+      for (int column = 1; column < 64; ++column) {
+        const auto u = column / 64.0;
+        const auto v = row / 64.0;
+        const auto pu = u - m[2];
+        const auto pv = v - m[5];
+        const auto du = ((m[4] * pu) - (m[1] * pv)) / det;
+        const auto dv = ((m[0] * pv) - (m[3] * pu)) / det;
+        const auto [x, y] = calibration.Apply(
+          static_cast<float>(du * MaxX), static_cast<float>(dv * MaxY));
+        maxError = std::max(
+          {maxError, std::abs(x - (u * MaxX)), std::abs(y - (v * MaxY))});
+      }
+    }
+    Bench::Report("affine, max error", maxError, "units");
+  }
+
+  // Grids only approximate a non-linear correction; the error should fall
+  // with the square of the spacing
+  std::mt19937 rng {42};
+  std::uniform_real_distribution<double> uniform(0, 1);
+  for (const uint32_t size: {2u, 9u, 17u, 33u}) {
+    const Calibration calibration {SampleWarp(size), MaxX, MaxY};
+    CheckAgreement("grid", calibration);
+    double maxError = 0;
+    double totalError = 0;
+    constexpr int Samples = 100'000;
+    for (int i = 0; i < Samples; ++i) {
+      const auto u = uniform(rng);
+      const auto v = uniform(rng);
+      const auto [expectedX, expectedY] = Warp(u, v);
+      const auto [x, y] = calibration.Apply(
+        static_cast<float>(u * MaxX), static_cast<float>(v * MaxY));
+      const auto error = std::hypot(
+        x - (std::clamp(expectedX, 0.0, 1.0) * MaxX),
+        y - (std::clamp(expectedY, 0.0, 1.0) * MaxY));
+      maxError = std::max(maxError, error);
+      totalError += error;
+    }
+    char buf[64] {};
+    std::snprintf(buf, sizeof(buf), "%ux%u grid, max error", size, size);
+    Bench::Report(buf, maxError, "units");
+    std::snprintf(buf, sizeof(buf), "%ux%u grid, mean error", size, size);
+    Bench::Report(buf, totalError / Samples, "units");
+  }
+}
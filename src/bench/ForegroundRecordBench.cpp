@@ -0,0 +1,193 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Read throughput of the foreground override record, with reader processes
+// contending with a writer process, as hooked driver processes contend with
+// the adapter.
+//
+// The baseline is a process-shared mutex around the same fields, which is
+// what `ForegroundOverride::Get()` used to do.
+
+#include "../ForegroundRecord.hpp"
+#include "Benchmark.hpp"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+namespace {
+
+constexpr std::size_t MaxReaders = 8;
+constexpr auto Duration = std::chrono::milliseconds(250);
+
+enum class Mode {
+  Seqlock,
+  Mutex,
+};
+
+struct Shared {
+  ForegroundRecord mRecord;
+
+  pthread_mutex_t mMutex;
+  uint64_t mLockedWindow;
+  uint32_t mLockedProcessId;
+
+  std::atomic<uint32_t> mReadyCount;
+  std::atomic<bool> mStop;
+
+  struct alignas(64) Result {
+    uint64_t mReads;
+    uint64_t mMisses;
+    uint64_t mTornReads;
+  };
+  Result mResults[MaxReaders];
+};
+
+// The writer publishes pairs that readers can check, so a torn read shows up
+// as a mismatch
+uint32_t CheckValue(const uint64_t window) {
+  return static_cast<uint32_t>(window * 2654435761u);
+}
+
+void Write(Shared& shared, const Mode mode, const uint64_t window) {
+  if (mode == Mode::Seqlock) {
+    shared.mRecord.Publish(window, CheckValue(window));
+    return;
+  }
+  pthread_mutex_lock(&shared.mMutex);
+  shared.mLockedWindow = window;
+  shared.mLockedProcessId = CheckValue(window);
+  pthread_mutex_unlock(&shared.mMutex);
+}
+
+[[noreturn]]
+void RunReader(Shared& shared, const Mode mode, const std::size_t index) {
+  auto& result = shared.mResults[index];
+  shared.mReadyCount.fetch_add(1);
+  while (!shared.mStop.load(std::memory_order_relaxed)) {
+    uint64_t window {};
+    uint32_t check {};
+    if (mode == Mode::Seqlock) {
+      const auto snapshot = shared.mRecord.TryRead();
+      if (!snapshot) {
+        ++result.mMisses;
+        continue;
+      }
+      window = snapshot->mWindow;
+      check = snapshot->mWriterProcessId;
+    } else {
+      pthread_mutex_lock(&shared.mMutex);
+      window = shared.mLockedWindow;
+      check = shared.mLockedProcessId;
+      pthread_mutex_unlock(&shared.mMutex);
+    }
+    if (check != CheckValue(window)) {
+      ++result.mTornReads;
+    }
+    ++result.mReads;
+  }
+  _exit(0);
+}
+
+// `busyWriter`: publish continuously, instead of once; the override usually
+// changes rarely, so this is the worst case
+void Run(const Mode mode, const std::size_t readerCount, const bool busyWriter) {
+  auto* const mapping = mmap(
+    nullptr,
+    sizeof(Shared),
+    PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_ANONYMOUS,
+    -1,
+    0);
+  if (mapping == MAP_FAILED) {
+    std::perror("mmap");
+    std::abort();
+  }
+  auto& shared = *new (mapping) Shared {};
+
+  pthread_mutexattr_t attr {};
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutex_init(&shared.mMutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  uint64_t window = 1;
+  Write(shared, mode, window);
+
+  pid_t children[MaxReaders] {};
+  for (std::size_t i = 0; i < readerCount; ++i) {
+    children[i] = fork();
+    if (children[i] == -1) {
+      std::perror("fork");
+      std::abort();
+    }
+    if (children[i] == 0) {
+      RunReader(shared, mode, i);
+    }
+  }
+  while (shared.mReadyCount.load() < readerCount) {
+    std::this_thread::yield();
+  }
+
+  const auto start = Bench::Clock::now();
+  const auto end = start + Duration;
+  uint64_t writes = 0;
+  if (busyWriter) {
+    while (Bench::Clock::now() < end) {
+      Write(shared, mode, ++window);
+      ++writes;
+    }
+  } else {
+    std::this_thread::sleep_until(end);
+  }
+  shared.mStop.store(true);
+  for (std::size_t i = 0; i < readerCount; ++i) {
+    waitpid(children[i], nullptr, 0);
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+
+  uint64_t reads = 0;
+  uint64_t misses = 0;
+  uint64_t torn = 0;
+  for (std::size_t i = 0; i < readerCount; ++i) {
+    reads += shared.mResults[i].mReads;
+    misses += shared.mResults[i].mMisses;
+    torn += shared.mResults[i].mTornReads;
+  }
+
+  std::printf(
+    "  %s, %zu reader process(es), %s writer\n",
+    mode == Mode::Seqlock ? "seqlock" : "process-shared mutex",
+    readerCount,
+    busyWriter ? "busy" : "idle");
+  Bench::Report("    read (all readers)", reads, elapsed);
+  if (busyWriter) {
+    Bench::Report("    write", writes, elapsed);
+  }
+  Bench::Report("    gave up", static_cast<double>(misses), "reads");
+  Bench::Report("    torn", static_cast<double>(torn), "reads");
+  if (torn) {
+    std::fprintf(stderr, "Torn read\n");
+    std::abort();
+  }
+
+  pthread_mutex_destroy(&shared.mMutex);
+  munmap(mapping, sizeof(Shared));
+}
+
+}// namespace
+
+BENCHMARK(ForegroundRecord) {
+  for (const auto busyWriter: {false, true}) {
+    for (const std::size_t readers: {1, 4}) {
+      Run(Mode::Mutex, readers, busyWriter);
+      Run(Mode::Seqlock, readers, busyWriter);
+    }
+  }
+}
@@ -0,0 +1,262 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Parse rate and fuzzing for `FrameParser`, the client receive path.
+//
+// Streams are a mix of `Hello`, `DebugMessage`, and experimental messages,
+// with the occasional oversized message; they're fed to the parser in chunks
+// of various sizes, as `recv()` would return them. The fuzzer mutates valid
+// streams, and aborts if the parser ever hands out a message that isn't
+// entirely within its buffer.
+
+#include "../ExperimentalMessage.hpp"
+#include "../FrameParser.hpp"
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <OTDIPC/DebugMessage.hpp>
+#include <OTDIPC/Hello.hpp>
+
+namespace {
+
+using OTDIPC::Messages::Header;
+
+constexpr std::size_t MaxMessageSize = 4096;
+
+struct Expected {
+  OTDIPC::Messages::MessageType mType {};
+  uint32_t mSize {};
+};
+
+struct Stream {
+  std::vector<std::byte> mBytes;
+  // Excluding oversized messages, which should be skipped
+  std::vector<Expected> mMessages;
+};
+
+void Append(Stream& stream, const void* data, const std::size_t size) {
+  const auto bytes = static_cast<const std::byte*>(data);
+  stream.mBytes.insert(stream.mBytes.end(), bytes, bytes + size);
+}
+
+Stream MakeStream(const std::size_t messageCount, std::mt19937& rng) {
+  Stream ret;
+  std::uniform_int_distribution<int> kind(0, 99);
+  std::uniform_int_distribution<uint32_t> textSize(0, 200);
+  std::uniform_int_distribution<uint32_t> payloadSize(0, 64);
+  const std::vector<std::byte> filler(2 * MaxMessageSize, std::byte {'x'});
+
+  for (std::size_t i = 0; i < messageCount; ++i) {
+    const auto k = kind(rng);
+    if (k < 10) {
+      OTDIPC::Messages::Hello hello {.protocolVersion = i};
+      std::snprintf(hello.humanReadableName, 256, "client %zu", i);
+      Append(ret, &hello, sizeof(hello));
+      ret.mMessages.push_back({hello.header.messageType, sizeof(hello)});
+    } else if (k < 55) {
+      const auto size = static_cast<uint32_t>(sizeof(Header)) + textSize(rng);
+      const Header header {
+        OTDIPC::Messages::DebugMessage::MESSAGE_TYPE, size};
+      Append(ret, &header, sizeof(header));
+      Append(ret, filler.data(), size - sizeof(header));
+      ret.mMessages.push_back({header.messageType, size});
+    } else {
+      // One in 45 experimental messages is too large for the buffer
+      const auto oversized = (k == 99);
+      const auto size = static_cast<uint32_t>(
+        sizeof(ExperimentalHeader)
+        + (oversized ? MaxMessageSize : payloadSize(rng)));
+      ExperimentalHeader header {};
+      header.messageType = ExperimentalHeader::MESSAGE_TYPE;
+      header.size = size;
+      header.guid.data1 = static_cast<uint32_t>(i);
+      Append(ret, &header, sizeof(header));
+      Append(ret, filler.data(), size - sizeof(header));
+      if (!oversized) {
+        ret.mMessages.push_back({header.messageType, size});
+      }
+    }
+  }
+  return ret;
+}
+
+struct Buffer {
+  std::unique_ptr<std::byte[]> mStorage
+    = std::make_unique<std::byte[]>(MaxMessageSize);
+  std::span<std::byte> Get() {
+    return {mStorage.get(), MaxMessageSize};
+  }
+};
+
+// Feed `bytes` to the parser `chunk` bytes at a time (0 is as much as fits),
+// calling `onMessage` for each; returns false on a parser error
+template <class F>
+bool Parse(
+  FrameParser& parser,
+  const std::span<const std::byte> bytes,
+  const std::size_t chunk,
+  F&& onMessage) {
+  std::size_t offset = 0;
+  while (offset < bytes.size()) {
+    const auto space = parser.GetReceiveSpace();
+    auto count = std::min(space.size(), bytes.size() - offset);
+    if (chunk) {
+      count = std::min(count, chunk);
+    }
+    std::memcpy(space.data(), bytes.data() + offset, count);
+    offset += count;
+    parser.Commit(count);
+    while (true) {
+      const auto message = parser.Next();
+      if (!message) {
+        return false;
+      }
+      if (!*message) {
+        break;
+      }
+      onMessage(**message);
+    }
+  }
+  return true;
+}
+
+void Verify(const char* label, Stream& stream, const std::size_t chunk) {
+  Buffer buffer;
+  FrameParser parser(buffer.Get(), FrameParser::OversizedMessages::Skip);
+  std::size_t index = 0;
+  const auto ok = Parse(parser, stream.mBytes, chunk, [&](const Header& it) {
+    const auto& expected = stream.mMessages.at(index++);
+    if (it.messageType != expected.mType || it.size != expected.mSize) {
+      std::fprintf(stderr, "%s: message %zu is wrong\n", label, index - 1);
+      std::abort();
+    }
+  });
+  if (!ok || index != stream.mMessages.size()) {
+    std::fprintf(
+      stderr,
+      "%s: parsed %zu of %zu messages\n",
+      label,
+      index,
+      stream.mMessages.size());
+    std::abort();
+  }
+}
+
+}// namespace
+
+BENCHMARK(FrameParserThroughput) {
+  std::mt19937 rng {42};
+  auto stream = MakeStream(100'000, rng);
+  char buf[64] {};
+  std::snprintf(
+    buf,
+    sizeof(buf),
+    "stream: %zu messages, %.1f MiB",
+    stream.mMessages.size(),
+    static_cast<double>(stream.mBytes.size()) / (1024 * 1024));
+  std::printf("  %s\n", buf);
+
+  for (const std::size_t chunk: {0, 1500, 64}) {
+    Verify("throughput", stream, chunk);
+
+    Buffer buffer;
+    constexpr int Iterations = 20;
+    std::size_t messages = 0;
+    const auto start = Bench::Clock::now();
+    for (int i = 0; i < Iterations; ++i) {
+      FrameParser parser(buffer.Get(), FrameParser::OversizedMessages::Skip);
+      Parse(parser, stream.mBytes, chunk, [&](const Header& it) {
+        Bench::DoNotOptimize(it);
+        ++messages;
+      });
+    }
+    const auto elapsed = Bench::Clock::now() - start;
+
+    if (chunk) {
+      std::snprintf(buf, sizeof(buf), "%zu-byte reads", chunk);
+    } else {
+      std::snprintf(buf, sizeof(buf), "buffer-sized reads");
+    }
+    Bench::Report(buf, messages, elapsed);
+    Bench::Report(
+      "  MiB/s",
+      static_cast<double>(stream.mBytes.size() * Iterations)
+        / (1024 * 1024)
+        / std::chrono::duration<double>(elapsed).count(),
+      "");
+  }
+}
+
+BENCHMARK(FrameParserFuzz) {
+  std::mt19937 rng {1234};
+  std::uniform_int_distribution<std::size_t> chunks(1, 2 * MaxMessageSize);
+  std::uniform_int_distribution<int> mutation(0, 3);
+  std::uniform_int_distribution<uint32_t> anyValue;
+
+  constexpr int Cases = 20'000;
+  uint64_t messages = 0;
+  uint64_t errors = 0;
+  const auto start = Bench::Clock::now();
+  for (int i = 0; i < Cases; ++i) {
+    auto stream = MakeStream(20, rng);
+    auto& bytes = stream.mBytes;
+    std::uniform_int_distribution<std::size_t> offset(0, bytes.size() - 1);
+    for (int j = 0; j < 4; ++j) {
+      const auto at = offset(rng);
+      switch (mutation(rng)) {
+        case 0:
+          bytes[at] ^= std::byte {1} << (at % 8);
+          break;
+        case 1: {
+          // A plausible-looking size, where a size might be
+          const auto size = anyValue(rng) % (3 * MaxMessageSize);
+          std::memcpy(
+            bytes.data() + (at & ~std::size_t {3}),
+            &size,
+            std::min(sizeof(size), bytes.size() - (at & ~std::size_t {3})));
+          break;
+        }
+        case 2:
+          bytes.resize(at);
+          offset = decltype(offset)(0, std::max<std::size_t>(at, 1) - 1);
+          break;
+        case 3:
+          bytes.insert(
+            bytes.begin() + static_cast<std::ptrdiff_t>(at), std::byte {0});
+          break;
+      }
+      if (bytes.empty()) {
+        break;
+      }
+    }
+
+    Buffer buffer;
+    const auto mode = (i % 2) ? FrameParser::OversizedMessages::Skip
+                              : FrameParser::OversizedMessages::Reject;
+    FrameParser parser(buffer.Get(), mode);
+    const auto begin = reinterpret_cast<uintptr_t>(buffer.Get().data());
+    const auto end = begin + MaxMessageSize;
+    const auto ok = Parse(parser, bytes, chunks(rng), [&](const Header& it) {
+      const auto address = reinterpret_cast<uintptr_t>(&it);
+      if (
+        it.size < sizeof(Header) || address < begin || address + it.size > end
+        || address % FrameParser::Alignment != 0) {
+        std::fprintf(stderr, "Fuzz case %d: message out of bounds\n", i);
+        std::abort();
+      }
+      ++messages;
+    });
+    errors += !ok;
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+  Bench::Report("fuzz cases", Cases, elapsed);
+  Bench::Report("  messages parsed", static_cast<double>(messages), "");
+  Bench::Report("  streams rejected", static_cast<double>(errors), "");
+}
@@ -0,0 +1,71 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Cost of recording a hooked call, which is added to every
+// `GetForegroundWindow()`/`WindowFromPoint()` call in a hijacked driver
+
+#include "../HookTelemetry.hpp"
+#include "Benchmark.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t Count = 20'000'000;
+
+// Drivers call the hooks from one or more of their own threads
+void Run(const std::size_t threadCount) {
+  auto telemetry = std::make_unique<HookTelemetry>();
+  if (!telemetry->Attach()) {
+    std::abort();
+  }
+  auto* const process = telemetry->Claim(1234, "bench.exe");
+  if (!process) {
+    std::abort();
+  }
+  auto& counters = process->hooks[0];
+
+  const auto perThread = Count / threadCount;
+  const auto start = Bench::Clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 0; i < threadCount; ++i) {
+      threads.emplace_back([&counters, perThread] {
+        for (std::size_t j = 0; j < perThread; ++j) {
+          // Plausible costs: mostly tens of ticks, but one call in 64 (more
+          // than 1%, so it shows in p99) takes thousands
+          const auto cycles = (j % 64) == 0 ? 2048 + (j % 4099) : 32 + (j % 32);
+          HookTelemetry::Record(counters, (j & 7) != 0, cycles);
+        }
+      });
+    }
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+
+  const auto summary = HookTelemetry::TakeSummary(counters);
+  if (summary.mCalls != perThread * threadCount) {
+    std::fprintf(stderr, "Lost calls\n");
+    std::abort();
+  }
+  if (summary.mP50Cycles >= summary.mP99Cycles) {
+    std::fprintf(stderr, "p50 isn't below p99\n");
+    std::abort();
+  }
+  std::printf("  %zu thread(s)\n", threadCount);
+  Bench::Report("    Record()", summary.mCalls, elapsed);
+  Bench::Report(
+    "    p50 bound", static_cast<double>(summary.mP50Cycles), "ticks");
+  Bench::Report(
+    "    p99 bound", static_cast<double>(summary.mP99Cycles), "ticks");
+}
+
+}// namespace
+
+BENCHMARK(HookTelemetry) {
+  Run(1);
+  Run(4);
+}
@@ -0,0 +1,163 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Compares delivering N samples per flush as individual `State` messages
+// with a single `InputFrame`, over a local AF_UNIX socketpair.
+
+#include "../InputFrame.hpp"
+#include "../SendBuffer.hpp"
+#include "Benchmark.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <OTDIPC/State.hpp>
+
+namespace {
+
+constexpr std::size_t SampleCount = 400'000;
+// Typical pen report rate, used to scale the per-sample results
+constexpr double SamplesPerSecond = 1000;
+
+enum class Mode {
+  PerSample,
+  CoalescedStates,
+  InputFrame,
+};
+
+struct Result {
+  std::size_t mBytes {};
+  std::size_t mSyscalls {};
+  Bench::Clock::duration mElapsed {};
+};
+
+void SendAll(const int fd, const void* data, std::size_t size, Result& result) {
+  auto it = static_cast<const std::byte*>(data);
+  while (size > 0) {
+    const auto sent = send(fd, it, size, MSG_NOSIGNAL);
+    ++result.mSyscalls;
+    if (sent < 0) {
+      std::perror("send");
+      std::abort();
+    }
+    it += sent;
+    size -= static_cast<std::size_t>(sent);
+  }
+}
+
+Result Run(const Mode mode, const std::size_t samplesPerFlush) {
+  std::array<int, 2> fds {};
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) != 0) {
+    std::perror("socketpair");
+    std::abort();
+  }
+
+  std::size_t received {};
+  std::jthread reader([fd = fds[1], &received] {
+    std::array<std::byte, 64 * 1024> buffer {};
+    while (true) {
+      const auto result = read(fd, buffer.data(), buffer.size());
+      if (result <= 0) {
+        return;
+      }
+      received += static_cast<std::size_t>(result);
+    }
+  });
+
+  Result result {};
+  SendBuffer staging(16 * 1024);
+  std::vector<InputFrameSample> samples;
+  samples.reserve(samplesPerFlush);
+  OTDIPC::Messages::State state {};
+  state.messageType = OTDIPC::Messages::State::MESSAGE_TYPE;
+  state.size = sizeof(state);
+
+  const auto start = Bench::Clock::now();
+  for (std::size_t i = 0; i < SampleCount; i += samplesPerFlush) {
+    samples.clear();
+    for (std::size_t j = 0; j < samplesPerFlush; ++j) {
+      state.x = static_cast<float>(i);
+      state.y = static_cast<float>(j);
+      switch (mode) {
+        case Mode::PerSample:
+          SendAll(fds[0], &state, sizeof(state), result);
+          result.mBytes += sizeof(state);
+          break;
+        case Mode::CoalescedStates:
+          staging.Append(state);
+          break;
+        case Mode::InputFrame:
+          samples.push_back(ToInputFrameSample(state, i + j));
+          break;
+      }
+    }
+    if (mode == Mode::InputFrame) {
+      AppendInputFrame(staging, 0, samples);
+    }
+    if (!staging.empty()) {
+      const auto pending = staging.GetPending();
+      SendAll(fds[0], pending.data(), pending.size(), result);
+      result.mBytes += pending.size();
+      staging.clear();
+    }
+  }
+  shutdown(fds[0], SHUT_WR);
+  reader.join();
+  result.mElapsed = Bench::Clock::now() - start;
+
+  close(fds[0]);
+  close(fds[1]);
+
+  if (received != result.mBytes) {
+    std::fprintf(
+      stderr, "Expected %zu bytes, received %zu\n", result.mBytes, received);
+    std::abort();
+  }
+  return result;
+}
+
+void Print(
+  const char* mode,
+  const std::size_t samplesPerFlush,
+  const Result& r) {
+  char label[64] {};
+  std::snprintf(
+    label, sizeof(label), "%s, %zu samples/flush", mode, samplesPerFlush);
+  Bench::Report(label, SampleCount, r.mElapsed);
+
+  const auto bytesPerSample
+    = static_cast<double>(r.mBytes) / static_cast<double>(SampleCount);
+  const auto syscallsPerSample
+    = static_cast<double>(r.mSyscalls) / static_cast<double>(SampleCount);
+  std::snprintf(label, sizeof(label), "  %s bytes/sample", mode);
+  Bench::Report(label, bytesPerSample, "");
+  std::snprintf(label, sizeof(label), "  %s syscalls/sample", mode);
+  Bench::Report(label, syscallsPerSample, "");
+  std::snprintf(label, sizeof(label), "  %s at 1kHz", mode);
+  Bench::Report(label, bytesPerSample * SamplesPerSecond / 1024, "KiB/s");
+  std::snprintf(label, sizeof(label), "  %s at 1kHz", mode);
+  Bench::Report(label, syscallsPerSample * SamplesPerSecond, "syscalls/s");
+}
+
+}// namespace
+
+BENCHMARK(InputFrame) {
+  for (const std::size_t samplesPerFlush: {1, 4, 16}) {
+    Print(
+      "per-sample State",
+      samplesPerFlush,
+      Run(Mode::PerSample, samplesPerFlush));
+    Print(
+      "coalesced State",
+      samplesPerFlush,
+      Run(Mode::CoalescedStates, samplesPerFlush));
+    Print(
+      "InputFrame", samplesPerFlush, Run(Mode::InputFrame, samplesPerFlush));
+  }
+}
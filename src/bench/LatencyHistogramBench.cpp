@@ -0,0 +1,131 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Cost of the latency instrumentation, and accuracy of the reported
+// percentiles
+
+#include "../LatencyHistogram.hpp"
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr std::size_t Count = 20'000'000;
+
+std::vector<std::chrono::nanoseconds> MakeValues(const std::size_t count) {
+  // Roughly what we expect: mostly tens of microseconds, with a long tail
+  std::mt19937_64 rng {42};
+  std::lognormal_distribution<double> distribution {10.0, 1.0};
+  std::vector<std::chrono::nanoseconds> ret(count);
+  for (auto&& it: ret) {
+    it = std::chrono::nanoseconds(static_cast<int64_t>(distribution(rng)));
+  }
+  return ret;
+}
+
+void RunOverhead() {
+  auto histogram = std::make_unique<LatencyHistogram>();
+  const auto values = MakeValues(64 * 1024);
+
+  auto start = Bench::Clock::now();
+  for (std::size_t i = 0; i < Count; ++i) {
+    histogram->Record(values[i % values.size()]);
+  }
+  Bench::Report("  Record()", Count, Bench::Clock::now() - start);
+
+  LatencyHistogram::Clock::time_point now {};
+  start = Bench::Clock::now();
+  for (std::size_t i = 0; i < Count; ++i) {
+    now = LatencyHistogram::Clock::now();
+    Bench::DoNotOptimize(now);
+  }
+  Bench::Report("  Clock::now()", Count, Bench::Clock::now() - start);
+
+  // What each instrumented stage actually does
+  start = Bench::Clock::now();
+  for (std::size_t i = 0; i < Count; ++i) {
+    const auto before = LatencyHistogram::Clock::now();
+    histogram->Record(LatencyHistogram::Clock::now() - before);
+  }
+  Bench::Report(
+    "  now() + now() + Record()", Count, Bench::Clock::now() - start);
+  Bench::DoNotOptimize(histogram->TakeSummary());
+}
+
+void RunContended(const std::size_t threadCount) {
+  auto histogram = std::make_unique<LatencyHistogram>();
+  const auto values = MakeValues(64 * 1024);
+  const auto perThread = Count / threadCount;
+
+  const auto start = Bench::Clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < threadCount; ++t) {
+      threads.emplace_back([&, t] {
+        for (std::size_t i = 0; i < perThread; ++i) {
+          histogram->Record(values[(i + t) % values.size()]);
+        }
+      });
+    }
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+
+  char label[64] {};
+  std::snprintf(label, sizeof(label), "  Record(), %zu threads", threadCount);
+  Bench::Report(label, perThread * threadCount, elapsed);
+
+  const auto summary = histogram->TakeSummary();
+  if (summary.mCount != perThread * threadCount) {
+    std::fprintf(stderr, "Lost concurrent records\n");
+    std::abort();
+  }
+}
+
+void RunAccuracy() {
+  auto values = MakeValues(1'000'000);
+  auto histogram = std::make_unique<LatencyHistogram>();
+  for (auto&& it: values) {
+    histogram->Record(it);
+  }
+  const auto summary = histogram->TakeSummary();
+  std::ranges::sort(values);
+
+  const auto check
+    = [&](const char* label, const double p, std::chrono::nanoseconds actual) {
+        const auto index = static_cast<std::size_t>(
+          std::ceil(p * static_cast<double>(values.size()))) - 1;
+        const auto expected = values.at(index);
+        const auto error
+          = static_cast<double>((actual - expected).count())
+          / static_cast<double>(expected.count());
+        Bench::Report(label, error * 100, "% error");
+        // Reported values are the upper bound of the bucket
+        if (error < 0 || error > 1.0 / (1 << LatencyHistogram::SubBucketBits)) {
+          std::fprintf(stderr, "%s is out of range\n", label);
+          std::abort();
+        }
+      };
+  check("  p50", 0.5, summary.mP50);
+  check("  p99", 0.99, summary.mP99);
+  check("  p99.9", 0.999, summary.mP999);
+  check("  max", 1.0, summary.mMax);
+}
+
+}// namespace
+
+BENCHMARK(LatencyHistogram) {
+  RunOverhead();
+  RunContended(1);
+  RunContended(4);
+  RunAccuracy();
+}
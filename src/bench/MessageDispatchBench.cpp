@@ -0,0 +1,217 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Routing cost of `MessageDispatcher`, with more experimental messages than
+// we currently have, compared to searching the GUIDs in turn.
+//
+// Also checks that every message reaches the right handler, and that
+// unknown and truncated messages are rejected.
+
+#include "../MessageDispatch.hpp"
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <OTDIPC/DebugMessage.hpp>
+
+namespace {
+
+using OTDIPC::Messages::Header;
+
+template <uint32_t N>
+struct TestMessage : ExperimentalHeader {
+  static constexpr ExperimentalGuid GUID {
+    0x6d1e0000 + N,
+    0x1b2c,
+    0x4d3e,
+    {0x8f, 0x40, 0x51, 0x62, 0x73, 0x84, 0x95, static_cast<uint8_t>(N)},
+  };
+
+  uint32_t value {};
+};
+
+struct Counts {
+  uint64_t mDebugMessages {};
+  std::array<uint64_t, 8> mExperimental {};
+};
+
+template <uint32_t N>
+void CountExperimental(Counts& counts, const TestMessage<N>& msg) {
+  if (msg.value != N) {
+    std::fprintf(stderr, "Message %u routed to handler %u\n", msg.value, N);
+    std::abort();
+  }
+  ++counts.mExperimental[N];
+}
+
+void CountDebugMessage(Counts& counts, const OTDIPC::Messages::DebugMessage&) {
+  ++counts.mDebugMessages;
+}
+
+using Dispatcher = MessageDispatcher<Counts>;
+using Result = Dispatcher::Result;
+using Route = Dispatcher::Route;
+
+constexpr Dispatcher Dispatch {
+  Route::For<
+    OTDIPC::Messages::DebugMessage,
+    &CountDebugMessage,
+    sizeof(Header)>(),
+  Route::For<TestMessage<0>, &CountExperimental<0>>(),
+  Route::For<TestMessage<1>, &CountExperimental<1>>(),
+  Route::For<TestMessage<2>, &CountExperimental<2>>(),
+  Route::For<TestMessage<3>, &CountExperimental<3>>(),
+  Route::For<TestMessage<4>, &CountExperimental<4>>(),
+  Route::For<TestMessage<5>, &CountExperimental<5>>(),
+  Route::For<TestMessage<6>, &CountExperimental<6>>(),
+  Route::For<TestMessage<7>, &CountExperimental<7>>(),
+};
+
+// What `V2Server` did before: compare against each GUID in turn
+template <uint32_t N = 0>
+bool DispatchLinear(Counts& counts, Header& header) {
+  if constexpr (N == 8) {
+    return false;
+  } else {
+    auto& msg = reinterpret_cast<TestMessage<N>&>(header);
+    if (msg.guid == TestMessage<N>::GUID && header.size >= sizeof(msg)) {
+      CountExperimental<N>(counts, msg);
+      return true;
+    }
+    return DispatchLinear<N + 1>(counts, header);
+  }
+}
+
+bool DispatchIfChain(Counts& counts, Header& header) {
+  if (header.messageType == OTDIPC::Messages::DebugMessage::MESSAGE_TYPE) {
+    CountDebugMessage(
+      counts, reinterpret_cast<OTDIPC::Messages::DebugMessage&>(header));
+    return true;
+  }
+  if (
+    header.messageType == ExperimentalHeader::MESSAGE_TYPE
+    && header.size >= sizeof(ExperimentalHeader)) {
+    return DispatchLinear(counts, header);
+  }
+  return false;
+}
+
+template <uint32_t N>
+TestMessage<N> MakeMessage() {
+  TestMessage<N> ret;
+  ret.messageType = ExperimentalHeader::MESSAGE_TYPE;
+  ret.size = sizeof(ret);
+  ret.guid = TestMessage<N>::GUID;
+  ret.value = N;
+  return ret;
+}
+
+// Every message is the size of the largest, so they can be indexed
+using Slot = TestMessage<0>;
+
+template <uint32_t... N>
+std::vector<Slot> MakeMessages(std::integer_sequence<uint32_t, N...>) {
+  std::vector<Slot> ret;
+  (ret.push_back(std::bit_cast<Slot>(MakeMessage<N>())), ...);
+  Slot debug {};
+  debug.messageType = OTDIPC::Messages::DebugMessage::MESSAGE_TYPE;
+  debug.size = sizeof(Header) + 4;
+  ret.push_back(debug);
+  return ret;
+}
+
+void Verify() {
+  Counts counts;
+  auto messages = MakeMessages(std::make_integer_sequence<uint32_t, 8> {});
+  for (auto& message: messages) {
+    if (Dispatch(counts, message) != Result::Handled) {
+      std::fprintf(stderr, "Valid message wasn't handled\n");
+      std::abort();
+    }
+  }
+
+  auto unknown = messages.front();
+  unknown.guid.data4[7] = 0xff;
+  auto truncated = messages.front();
+  truncated.size = sizeof(ExperimentalHeader);
+  auto wrongType = messages.front();
+  wrongType.messageType = OTDIPC::Messages::MessageType::State;
+  auto outOfRange = messages.front();
+  outOfRange.messageType = static_cast<OTDIPC::Messages::MessageType>(1000);
+  if (
+    Dispatch(counts, unknown) != Result::UnknownExperimental
+    || Dispatch(counts, truncated) != Result::TooSmall
+    || Dispatch(counts, wrongType) != Result::UnknownType
+    || Dispatch(counts, outOfRange) != Result::UnknownType) {
+    std::fprintf(stderr, "Invalid message wasn't rejected\n");
+    std::abort();
+  }
+
+  if (counts.mDebugMessages != 1) {
+    std::fprintf(stderr, "DebugMessage wasn't handled once\n");
+    std::abort();
+  }
+  for (const auto count: counts.mExperimental) {
+    if (count != 1) {
+      std::fprintf(stderr, "Experimental message wasn't handled once\n");
+      std::abort();
+    }
+  }
+}
+
+void Run(
+  const char* label,
+  std::vector<Slot>& messages,
+  const std::vector<std::size_t>& order) {
+  constexpr int Iterations = 100;
+  const auto count = order.size() * Iterations;
+  std::printf("  %s\n", label);
+  {
+    Counts counts;
+    const auto start = Bench::Clock::now();
+    for (int i = 0; i < Iterations; ++i) {
+      for (const auto index: order) {
+        Bench::DoNotOptimize(Dispatch(counts, messages[index]));
+      }
+    }
+    Bench::Report("    dispatch table", count, Bench::Clock::now() - start);
+  }
+  {
+    Counts counts;
+    const auto start = Bench::Clock::now();
+    for (int i = 0; i < Iterations; ++i) {
+      for (const auto index: order) {
+        Bench::DoNotOptimize(DispatchIfChain(counts, messages[index]));
+      }
+    }
+    Bench::Report("    if chain", count, Bench::Clock::now() - start);
+  }
+}
+
+}// namespace
+
+BENCHMARK(MessageDispatch) {
+  Verify();
+
+  auto messages = MakeMessages(std::make_integer_sequence<uint32_t, 8> {});
+  std::mt19937 rng {42};
+  std::uniform_int_distribution<std::size_t> pick(0, messages.size() - 1);
+  std::vector<std::size_t> order(1 << 16);
+  for (auto& it: order) {
+    it = pick(rng);
+  }
+  // Every handler is an unpredictable branch or call
+  Run("random mix", messages, order);
+
+  // The last GUID the if chain checks; likely for a client that sends the
+  // same control message repeatedly
+  std::ranges::fill(order, 7);
+  Run("repeated message", messages, order);
+}
@@ -0,0 +1,108 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Stress test and benchmark for the log ring: several threads logging at
+// once, with one flusher
+
+#include "../MpscRing.hpp"
+#include "Benchmark.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The same size as a `Log::Record`
+struct Item {
+  uint32_t mProducer {};
+  uint64_t mSequence {};
+  std::array<std::byte, 456> mPayload {};
+};
+
+using Ring = MpscRing<Item, 256>;
+
+void Run(const char* label, const uint32_t producerCount) {
+  constexpr uint64_t PerProducer = 500'000;
+  auto ring = std::make_unique<Ring>();
+
+  std::jthread consumer([&] {
+    std::vector<uint64_t> expected(producerCount);
+    uint64_t remaining = PerProducer * producerCount;
+    while (remaining) {
+      const auto consumed = ring->ConsumeAll([&](const Item& item) {
+        // Each producer's items must be in order, and none lost
+        if (item.mSequence != expected[item.mProducer]) {
+          std::fprintf(
+            stderr,
+            "Out of order from producer %u: expected %llu, got %llu\n",
+            item.mProducer,
+            static_cast<unsigned long long>(expected[item.mProducer]),
+            static_cast<unsigned long long>(item.mSequence));
+          std::abort();
+        }
+        ++expected[item.mProducer];
+      });
+      remaining -= consumed;
+      if (!consumed) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::atomic<uint64_t> fullCount {};
+  const auto start = Bench::Clock::now();
+  {
+    std::vector<std::jthread> producers;
+    for (uint32_t producer = 0; producer < producerCount; ++producer) {
+      producers.emplace_back([&, producer] {
+        for (uint64_t i = 0; i < PerProducer; ++i) {
+          while (!ring->TryPush([producer, i](Item& item) {
+            item.mProducer = producer;
+            item.mSequence = i;
+          })) {
+            fullCount.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+  }
+  consumer.join();
+  const auto elapsed = Bench::Clock::now() - start;
+
+  std::printf("  %s\n", label);
+  Bench::Report("    push+pop", PerProducer * producerCount, elapsed);
+  Bench::Report(
+    "    producers saw full ring",
+    static_cast<double>(fullCount.load()),
+    "times");
+}
+
+}// namespace
+
+BENCHMARK(MpscRing) {
+  Run("1 producer", 1);
+  Run("2 producers", 2);
+  Run("4 producers", 4);
+
+  // What a caller pays when the flusher is keeping up
+  auto ring = std::make_unique<Ring>();
+  constexpr std::size_t Count = 1'000'000;
+  Bench::Clock::duration elapsed {};
+  for (std::size_t i = 0; i < Count; i += Ring::capacity() / 2) {
+    const auto start = Bench::Clock::now();
+    for (std::size_t j = 0; j < Ring::capacity() / 2; ++j) {
+      const auto pushed = ring->TryPush([j](Item& item) {
+        item.mSequence = j;
+      });
+      Bench::DoNotOptimize(pushed);
+    }
+    elapsed += Bench::Clock::now() - start;
+    ring->ConsumeAll([](const Item& item) { Bench::DoNotOptimize(item); });
+  }
+  Bench::Report("uncontended push", Count, elapsed);
+}
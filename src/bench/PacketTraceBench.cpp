@@ -0,0 +1,204 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Size and speed of packet traces: recording, decoding in place from a
+// memory mapping, and replaying through an `IHandler`
+
+#include "../MappedFile.hpp"
+#include "../PacketTrace.hpp"
+#include "Benchmark.hpp"
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t PacketCount = 2'000'000;
+// Every this many packets, toggle proximity and press an express key
+constexpr std::size_t ProximityInterval = 5'000;
+// WinTab's `PACKET` with our `PACKETDATA`, plus a timestamp
+constexpr std::size_t RawEventSize = sizeof(TracedPacket) + sizeof(uint64_t);
+
+class CountingHandler final : public IHandler {
+ public:
+  void SetDevice(const OTDIPC::Messages::DeviceInfo&) override {
+    ++mDevices;
+  }
+  void SetState(const OTDIPC::Messages::State& state) override {
+    ++mStates;
+    mChecksum += state.x + state.y + static_cast<float>(state.pressure);
+  }
+  void Flush() override {
+    ++mFlushes;
+  }
+
+  std::size_t mDevices {};
+  std::size_t mStates {};
+  std::size_t mFlushes {};
+  float mChecksum {};
+};
+
+std::filesystem::path TracePath(const char* name) {
+  return std::filesystem::temp_directory_path()
+    / ("wintab-adapter-bench-" + std::to_string(getpid()) + "-" + name
+       + ".trace");
+}
+
+OTDIPC::Messages::DeviceInfo MakeDevice() {
+  OTDIPC::Messages::DeviceInfo ret {};
+  ret.nonPersistentTabletId = 1;
+  ret.maxX = 32767;
+  ret.maxY = 32767;
+  ret.maxPressure = 8191;
+  return ret;
+}
+
+// A wandering pen stroke, so deltas are small but not constant
+TracedPacket MakePacket(const std::size_t i) {
+  using namespace PacketBits;
+  TracedPacket ret {
+    .pkChanged = X | Y | NormalPressure,
+    .pkX = static_cast<int32_t>(16384 + 8000 * std::sin(i / 500.0)),
+    .pkY = static_cast<int32_t>(16384 + 8000 * std::cos(i / 700.0)),
+    .pkNormalPressure
+    = static_cast<uint32_t>(4096 + 2000 * std::sin(i / 90.0)),
+  };
+  if (i % 128 == 0) {
+    ret.pkChanged |= Buttons | Z;
+    ret.pkButtons = (i / 128) % 2;
+    ret.pkZ = static_cast<int32_t>(i % 50);
+  }
+  return ret;
+}
+
+void Write(const std::filesystem::path& path) {
+  const auto start = Bench::Clock::now();
+  {
+    PacketTraceWriter writer(path);
+    writer.WriteDevice(MakeDevice());
+    for (std::size_t i = 0; i < PacketCount; ++i) {
+      if (i % ProximityInterval == 0) {
+        writer.WriteProximity((i / ProximityInterval) % 2 == 0);
+        writer.WriteExpressKey(static_cast<uint8_t>(i % 8), true);
+      }
+      writer.WritePacket(MakePacket(i));
+    }
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+
+  const auto size = std::filesystem::file_size(path);
+  Bench::Report("  record", PacketCount, elapsed);
+  Bench::Report(
+    "    bytes/packet",
+    static_cast<double>(size) / static_cast<double>(PacketCount),
+    "");
+  Bench::Report(
+    "    vs raw PACKET + timestamp",
+    static_cast<double>(size) / static_cast<double>(PacketCount * RawEventSize)
+      * 100,
+    "%");
+}
+
+void Decode(const std::filesystem::path& path) {
+  const MappedFile file(path);
+  const auto allocations = Bench::GetAllocationCount();
+  const auto start = Bench::Clock::now();
+
+  PacketTraceReader reader(file.GetBytes());
+  std::size_t packets = 0;
+  while (const auto event = reader.Next()) {
+    if (event->mKind != PacketTraceEvent::Kind::Packet) {
+      continue;
+    }
+    const auto expected = MakePacket(packets++);
+    const auto& actual = event->mPacket;
+    if (
+      actual.pkChanged != expected.pkChanged || actual.pkX != expected.pkX
+      || actual.pkY != expected.pkY
+      || actual.pkNormalPressure != expected.pkNormalPressure
+      || ((expected.pkChanged & PacketBits::Buttons)
+          && actual.pkButtons != expected.pkButtons)) {
+      std::fprintf(stderr, "Packet %zu didn't round-trip\n", packets - 1);
+      std::abort();
+    }
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+  if (packets != PacketCount) {
+    std::fprintf(
+      stderr, "Expected %zu packets, got %zu\n", PacketCount, packets);
+    std::abort();
+  }
+
+  Bench::Report("  decode and verify", PacketCount, elapsed);
+  Bench::Report(
+    "    allocations/packet",
+    static_cast<double>(Bench::GetAllocationCount() - allocations)
+      / static_cast<double>(PacketCount),
+    "");
+}
+
+void Replay(const std::filesystem::path& path) {
+  const MappedFile file(path);
+  CountingHandler handler;
+  const auto allocations = Bench::GetAllocationCount();
+  const auto start = Bench::Clock::now();
+  const auto count = ReplayPacketTrace({}, file.GetBytes(), handler, 0);
+  const auto elapsed = Bench::Clock::now() - start;
+
+  Bench::Report("  replay, max speed", count, elapsed);
+  Bench::Report(
+    "    allocations/event",
+    static_cast<double>(Bench::GetAllocationCount() - allocations)
+      / static_cast<double>(count),
+    "");
+  Bench::DoNotOptimize(handler.mChecksum);
+}
+
+// Record at ~1kHz, then check that replay honors the timing
+void RunPaced() {
+  constexpr std::size_t Count = 500;
+  const auto path = TracePath("paced");
+  {
+    PacketTraceWriter writer(path);
+    writer.WriteDevice(MakeDevice());
+    auto next = Bench::Clock::now();
+    for (std::size_t i = 0; i < Count; ++i) {
+      next += std::chrono::milliseconds(1);
+      std::this_thread::sleep_until(next);
+      writer.WritePacket(MakePacket(i));
+    }
+  }
+
+  const MappedFile file(path);
+  for (const double speed: {1.0, 4.0}) {
+    CountingHandler handler;
+    const auto start = Bench::Clock::now();
+    std::ignore = ReplayPacketTrace({}, file.GetBytes(), handler, speed);
+    const auto elapsed
+      = std::chrono::duration<double, std::milli>(Bench::Clock::now() - start);
+
+    char label[64] {};
+    std::snprintf(
+      label, sizeof(label), "  replay %zu packets at %.0fx", Count, speed);
+    Bench::Report(label, elapsed.count(), "ms");
+  }
+  std::filesystem::remove(path);
+}
+
+}// namespace
+
+BENCHMARK(PacketTrace) {
+  const auto path = TracePath("stroke");
+  Write(path);
+  Decode(path);
+  Replay(path);
+  std::filesystem::remove(path);
+
+  RunPaced();
+}
@@ -0,0 +1,350 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Offline evaluation of `PenPredictor`: replays strokes, and compares each
+// prediction with where the pen actually was at that time.
+//
+// Set `WINTAB_ADAPTER_PREDICTION_TRACE` to a recording made with
+// `--capture-packets` to evaluate real handwriting; otherwise, synthetic
+// strokes are used. Errors are in tablet units, against the baseline of not
+// predicting at all.
+
+#include "../InputFrame.hpp"
+#include "../MappedFile.hpp"
+#include "../PacketTrace.hpp"
+#include "../PenPredictor.hpp"
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using State = OTDIPC::Messages::State;
+
+// Samples further apart than this aren't interpolated between
+constexpr auto MaxStrokeGap = milliseconds(50);
+
+struct Sample {
+  microseconds mTime {};
+  State mState {};
+  // Samples in the same stroke are on the surface, without long gaps
+  std::size_t mStroke {};
+};
+
+bool IsOnSurface(const State& state) {
+  return state.penIsNearSurface && state.HasData(State::ValidMask::Position);
+}
+
+void AssignStrokes(std::vector<Sample>& samples) {
+  std::size_t stroke = 0;
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    if (
+      i == 0 || !IsOnSurface(samples[i].mState)
+      || !IsOnSurface(samples[i - 1].mState)
+      || samples[i].mTime - samples[i - 1].mTime > MaxStrokeGap) {
+      ++stroke;
+    }
+    samples[i].mStroke = stroke;
+  }
+}
+
+std::vector<Sample> LoadTrace(
+  const char* path,
+  OTDIPC::Messages::DeviceInfo& device) {
+  const MappedFile file(path);
+  PacketTraceReader reader(file.GetBytes());
+  std::vector<Sample> ret;
+  State state {};
+  while (const auto event = reader.Next()) {
+    // Strokes from several tablets would be interleaved
+    if (event->mDevice != 0) {
+      continue;
+    }
+    using Kind = PacketTraceEvent::Kind;
+    switch (event->mKind) {
+      case Kind::Device:
+        device = event->GetDevice();
+        continue;
+      case Kind::Packet:
+        ApplyPacket(event->mPacket, device.maxY, state);
+        break;
+      case Kind::ExpressKey:
+        continue;
+      case Kind::Proximity:
+        ApplyProximity(event->mIsNearSurface, state);
+        break;
+    }
+    ret.push_back({event->mTime, state});
+  }
+  return ret;
+}
+
+// Handwriting-like loops at 200 Hz: each stroke is a sum of sines with random
+// frequencies, so speed and curvature vary, quantized to whole tablet units
+std::vector<Sample> Synthesize(OTDIPC::Messages::DeviceInfo& device) {
+  constexpr std::size_t StrokeCount = 400;
+  constexpr auto Interval = microseconds(5000);
+
+  device.maxX = 32767;
+  device.maxY = 32767;
+
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> frequency(0.5, 4.0);
+  std::uniform_real_distribution<double> amplitude(200, 2500);
+  std::uniform_real_distribution<double> phase(0, 6.283);
+  std::uniform_int_distribution<int> length(60, 300);
+
+  std::vector<Sample> ret;
+  microseconds time {};
+  for (std::size_t stroke = 0; stroke < StrokeCount; ++stroke) {
+    double f[3], ax[3], ay[3], p[3];
+    for (int i = 0; i < 3; ++i) {
+      f[i] = frequency(random);
+      ax[i] = amplitude(random);
+      ay[i] = amplitude(random);
+      p[i] = phase(random);
+    }
+    const auto samples = length(random);
+    for (int i = 0; i < samples; ++i) {
+      const auto t = std::chrono::duration<double>(Interval * i).count();
+      double x = 16384;
+      double y = 16384;
+      for (int j = 0; j < 3; ++j) {
+        x += ax[j] * std::sin((6.283 * f[j] * t) + p[j]);
+        y += ay[j] * std::cos((6.283 * f[j] * t) + p[j]);
+      }
+      State state {};
+      state.validBits = State::ValidMask::Position
+        | State::ValidMask::PenIsNearSurface;
+      state.penIsNearSurface = true;
+      state.x = std::round(x);
+      state.y = std::round(y);
+      ret.push_back({time, state});
+      time += Interval;
+    }
+    // Lift the pen between strokes
+    State lifted {};
+    lifted.validBits = State::ValidMask::PenIsNearSurface;
+    ret.push_back({time, lifted});
+    time += milliseconds(200);
+  }
+  return ret;
+}
+
+// Records the prediction made after each real sample
+class Recorder final : public IHandler {
+ public:
+  void SetDevice(const OTDIPC::Messages::DeviceInfo&) override {
+  }
+  void SetState(const State& state) override {
+    if (IsPredicted(state)) {
+      mPrediction = state;
+    }
+  }
+
+  std::optional<State> mPrediction;
+};
+
+// Where the pen actually was at `time`, if it was still in the same stroke
+std::optional<std::pair<float, float>> GetTruth(
+  const std::vector<Sample>& samples,
+  const std::size_t from,
+  const microseconds time) {
+  const auto stroke = samples[from].mStroke;
+  for (auto i = from; i + 1 < samples.size(); ++i) {
+    const auto& a = samples[i];
+    const auto& b = samples[i + 1];
+    if (b.mStroke != stroke) {
+      return std::nullopt;
+    }
+    if (b.mTime < time) {
+      continue;
+    }
+    const auto weight = static_cast<float>(
+      (time - a.mTime).count()
+      / static_cast<double>((b.mTime - a.mTime).count()));
+    return std::pair {
+      a.mState.x + ((b.mState.x - a.mState.x) * weight),
+      a.mState.y + ((b.mState.y - a.mState.y) * weight),
+    };
+  }
+  return std::nullopt;
+}
+
+struct Errors {
+  std::vector<float> mValues;
+
+  void Report(const char* label) {
+    if (mValues.empty()) {
+      return;
+    }
+    std::ranges::sort(mValues);
+    double total = 0;
+    for (const auto it: mValues) {
+      total += it;
+    }
+    char buf[64] {};
+    std::snprintf(buf, sizeof(buf), "      %s, mean", label);
+    Bench::Report(buf, total / mValues.size(), "units");
+    std::snprintf(buf, sizeof(buf), "      %s, p95", label);
+    Bench::Report(buf, mValues[mValues.size() * 95 / 100], "units");
+  }
+};
+
+void Evaluate(
+  const std::vector<Sample>& samples,
+  const OTDIPC::Messages::DeviceInfo& device,
+  const microseconds horizon) {
+  Errors hold;
+  Errors velocity;
+  Errors acceleration;
+
+  for (const bool useAcceleration: {false, true}) {
+    Recorder recorder;
+    PenPredictor predictor(
+      &recorder,
+      {.mHorizon = horizon, .mUseAcceleration = useAcceleration});
+    predictor.SetDevice(device);
+
+    auto& errors = useAcceleration ? acceleration : velocity;
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+      const auto& sample = samples[i];
+      recorder.mPrediction.reset();
+      predictor.SetState(
+        sample.mState, PenPredictor::Clock::time_point(sample.mTime));
+      if (!(recorder.mPrediction && IsOnSurface(sample.mState))) {
+        continue;
+      }
+      const auto truth = GetTruth(samples, i, sample.mTime + horizon);
+      if (!truth) {
+        continue;
+      }
+      const auto [x, y] = *truth;
+      errors.mValues.push_back(std::hypot(
+        recorder.mPrediction->x - x, recorder.mPrediction->y - y));
+      if (!useAcceleration) {
+        hold.mValues.push_back(
+          std::hypot(sample.mState.x - x, sample.mState.y - y));
+      }
+    }
+  }
+
+  std::printf(
+    "    %lld ms ahead, %zu predictions\n",
+    static_cast<long long>(
+      std::chrono::duration_cast<milliseconds>(horizon).count()),
+    velocity.mValues.size());
+  hold.Report("no prediction");
+  velocity.Report("velocity");
+  acceleration.Report("velocity + acceleration");
+}
+
+// As `WintabTablet` delivers them: several queued packets are often handled
+// in one message pump iteration, a little after they were sampled, so the
+// time each state is handled says little about when it was sampled
+void EvaluateBunched(
+  const std::vector<Sample>& samples,
+  const OTDIPC::Messages::DeviceInfo& device,
+  const microseconds horizon) {
+  Errors perState;
+  Errors perPump;
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<std::size_t> bunchSize(1, 4);
+  std::uniform_int_distribution<int> delay(100, 3000);
+
+  for (const bool timePerState: {true, false}) {
+    Recorder recorder;
+    PenPredictor predictor(&recorder, {.mHorizon = horizon});
+    predictor.SetDevice(device);
+    auto& errors = timePerState ? perState : perPump;
+
+    for (std::size_t i = 0; i < samples.size();) {
+      const auto end = std::min(samples.size(), i + bunchSize(random));
+      const auto& last = samples[end - 1];
+      const auto pumpAt = PenPredictor::Clock::time_point(
+        last.mTime + microseconds(delay(random)));
+      recorder.mPrediction.reset();
+      for (auto j = i; j < end; ++j) {
+        if (timePerState) {
+          // Handled a few microseconds apart
+          predictor.SetState(
+            samples[j].mState, pumpAt + microseconds(10 * (j - i)));
+        } else {
+          predictor.SetState(samples[j].mState);
+        }
+      }
+      predictor.Flush(pumpAt);
+      i = end;
+
+      if (!(recorder.mPrediction && IsOnSurface(last.mState))) {
+        continue;
+      }
+      const auto truth = GetTruth(samples, end - 1, last.mTime + horizon);
+      if (!truth) {
+        continue;
+      }
+      const auto [x, y] = *truth;
+      errors.mValues.push_back(std::hypot(
+        recorder.mPrediction->x - x, recorder.mPrediction->y - y));
+    }
+  }
+
+  std::printf(
+    "    %lld ms ahead, 1-4 samples per pump iteration\n",
+    static_cast<long long>(
+      std::chrono::duration_cast<milliseconds>(horizon).count()));
+  perState.Report("handling time per state");
+  perPump.Report("pump time");
+}
+
+// Cost of the stage itself, with a handler that does nothing
+void RunCost(
+  const std::vector<Sample>& samples,
+  const OTDIPC::Messages::DeviceInfo& device) {
+  Recorder recorder;
+  PenPredictor predictor(&recorder, {.mHorizon = milliseconds(16)});
+  predictor.SetDevice(device);
+
+  const auto allocations = Bench::GetAllocationCount();
+  const auto start = Bench::Clock::now();
+  for (auto&& sample: samples) {
+    predictor.SetState(
+      sample.mState, PenPredictor::Clock::time_point(sample.mTime));
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+  Bench::DoNotOptimize(recorder.mPrediction);
+  Bench::Report("  SetState + prediction", samples.size(), elapsed);
+  Bench::Report(
+    "    allocations",
+    static_cast<double>(Bench::GetAllocationCount() - allocations),
+    "");
+}
+
+}// namespace
+
+BENCHMARK(PenPrediction) {
+  OTDIPC::Messages::DeviceInfo device {};
+  std::vector<Sample> samples;
+  if (const auto path = std::getenv("WINTAB_ADAPTER_PREDICTION_TRACE")) {
+    std::printf("  strokes from %s\n", path);
+    samples = LoadTrace(path, device);
+  } else {
+    std::printf("  synthetic strokes at 200 Hz\n");
+    samples = Synthesize(device);
+  }
+  AssignStrokes(samples);
+
+  for (const auto ms: {4, 8, 16, 24, 32}) {
+    Evaluate(samples, device, milliseconds(ms));
+  }
+  EvaluateBunched(samples, device, milliseconds(16));
+  RunCost(samples, device);
+}
@@ -0,0 +1,379 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// The platform-neutral half of the adapter's hot path: packet decode ->
+// fan-out -> per-server translation and serialization.
+//
+// The fan-out is measured both as a chain of virtual `IHandler`s with a
+// `MultiHandler`, as it used to be, and as a statically-dispatched
+// `Pipeline`, as `main()` now builds it.
+//
+// The servers' sockets and pipes are replaced with in-memory sinks that do
+// the same per-message work as the reactor's send callbacks, so this
+// measures the CPU cost of a sample, not IPC.
+
+#include "../MultiHandler.hpp"
+#include "../PacketDecoder.hpp"
+#include "../Pipeline.hpp"
+#include "../SendBuffer.hpp"
+#include "../V1Translation.hpp"
+#include "Benchmark.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <OTDIPC/DeviceInfo.hpp>
+#include <OTDIPC/State.hpp>
+
+namespace {
+
+// Same member names as WinTab's `PACKET`, with our `PACKETDATA`
+struct Packet {
+  uint32_t pkChanged {};
+  uint32_t pkButtons {};
+  int32_t pkX {};
+  int32_t pkY {};
+  int32_t pkZ {};
+  uint32_t pkNormalPressure {};
+};
+
+constexpr float MaxY = 32767;
+
+// Serializes what V2Server's reactor would write to a client socket
+class V2Sink final : public IHandler {
+ public:
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override {
+    mTabletId = device.nonPersistentTabletId;
+    mBuffer.Append(device);
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) override {
+    auto msg = state;
+    msg.messageType = OTDIPC::Messages::State::MESSAGE_TYPE;
+    msg.size = sizeof(msg);
+    msg.nonPersistentTabletId = mTabletId;
+    mBuffer.Append(msg);
+  }
+
+  void Flush() override {
+    mBytes += mBuffer.size();
+    mBuffer.clear();
+  }
+
+  std::size_t mBytes {};
+
+ private:
+  SendBuffer mBuffer {16 * 1024};
+  uint32_t mTabletId {};
+};
+
+// Serializes what V1Server's reactor would write to the named pipe
+class V1Sink final : public IHandler {
+ public:
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override {
+    mDevice = ToV1DeviceInfo(device);
+    mBuffer.Append(mDevice);
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) override {
+    mBuffer.Append(ToV1State(state, mDevice));
+  }
+
+  void Flush() override {
+    mBytes += mBuffer.size();
+    mBuffer.clear();
+  }
+
+  std::size_t mBytes {};
+
+ private:
+  SendBuffer mBuffer {16 * 1024};
+  OTDIPC::V1::Messages::DeviceInfo mDevice {};
+};
+
+// Stand-ins for main's `DeviceLogger`, without the console output: one for
+// each way of chaining handlers
+class DeviceCounter final : public IHandler {
+ public:
+  explicit DeviceCounter(IHandler* next) : mNext(next) {
+  }
+
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override {
+    ++mCount;
+    mNext->SetDevice(device);
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) override {
+    mNext->SetState(state);
+  }
+
+  void SetStates(std::span<const OTDIPC::Messages::State> states) override {
+    mNext->SetStates(states);
+  }
+
+  void Flush() override {
+    mNext->Flush();
+  }
+
+  std::size_t mCount {};
+
+ private:
+  IHandler* mNext {nullptr};
+};
+
+struct DeviceCounterStage final : PipelineStage {
+  template <Handler Next>
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device, Next& next) {
+    ++mCount;
+    next.SetDevice(device);
+  }
+
+  std::size_t mCount {};
+};
+
+// Does as little as possible, so that only the dispatch is measured
+class CountingSink final : public IHandler {
+ public:
+  void SetDevice(const OTDIPC::Messages::DeviceInfo&) override {
+  }
+
+  void SetState(const OTDIPC::Messages::State& state) override {
+    ++mStates;
+    mSum += static_cast<uint32_t>(state.x);
+  }
+
+  void Flush() override {
+    ++mFlushes;
+  }
+
+  std::size_t mStates {};
+  std::size_t mFlushes {};
+  uint32_t mSum {};
+};
+
+OTDIPC::Messages::DeviceInfo MakeDevice() {
+  OTDIPC::Messages::DeviceInfo ret {};
+  ret.nonPersistentTabletId = 1;
+  ret.maxX = 32767;
+  ret.maxY = MaxY;
+  ret.maxPressure = 8191;
+  constexpr std::string_view name = "Bench Tablet";
+  constexpr std::string_view persistentId
+    = "wintab-adapter/bench/VID_056A&PID_0000";
+  std::memcpy(ret.name, name.data(), name.size());
+  std::memcpy(ret.persistentId, persistentId.data(), persistentId.size());
+  return ret;
+}
+
+// A pen stroke: mostly position/pressure changes, with occasional button
+// and hover changes
+std::vector<Packet> MakePackets(const std::size_t count) {
+  using namespace PacketBits;
+  std::vector<Packet> ret(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto& it = ret[i];
+    it.pkChanged = X | Y | NormalPressure;
+    it.pkX = static_cast<int32_t>(i % 32768);
+    it.pkY = static_cast<int32_t>((i * 7) % 32768);
+    it.pkNormalPressure = static_cast<uint32_t>(i % 8192);
+    if (i % 64 == 0) {
+      it.pkChanged |= Buttons | Z;
+      it.pkButtons = (i / 64) % 2;
+      it.pkZ = static_cast<int32_t>(i % 100);
+    }
+  }
+  return ret;
+}
+
+struct Result {
+  std::size_t mSamples {};
+  Bench::Clock::duration mBusy {};
+  Bench::Clock::duration mElapsed {};
+  std::uint64_t mAllocations {};
+};
+
+// If `rate` is zero, run flat out; otherwise pace pumps so that samples
+// arrive at `rate` per second, and only count the time spent in the
+// pipeline
+template <Handler T>
+Result Run(
+  T& handler,
+  const std::vector<Packet>& packets,
+  const std::size_t packetsPerPump,
+  const double rate) {
+  std::vector<OTDIPC::Messages::State> states(packetsPerPump);
+  OTDIPC::Messages::State state {};
+  const auto interval = rate > 0
+    ? std::chrono::duration_cast<Bench::Clock::duration>(
+        std::chrono::duration<double>(
+          static_cast<double>(packetsPerPump) / rate))
+    : Bench::Clock::duration {};
+
+  Result result {};
+  const auto allocations = Bench::GetAllocationCount();
+  const auto start = Bench::Clock::now();
+  auto next = start;
+  for (std::size_t i = 0; i + packetsPerPump <= packets.size();
+       i += packetsPerPump) {
+    auto pumpStart = next;
+    if (rate > 0) {
+      next += interval;
+      while ((pumpStart = Bench::Clock::now()) < next) {
+        std::this_thread::yield();
+      }
+    }
+
+    const auto count = DecodePackets(
+      std::span {packets}.subspan(i, packetsPerPump),
+      MaxY,
+      state,
+      std::span {states});
+    handler.SetStates(std::span {std::as_const(states)}.first(count));
+    handler.Flush();
+    result.mSamples += count;
+
+    if (rate > 0) {
+      result.mBusy += Bench::Clock::now() - pumpStart;
+    }
+  }
+  result.mElapsed = Bench::Clock::now() - start;
+  if (rate <= 0) {
+    result.mBusy = result.mElapsed;
+  }
+  result.mAllocations = Bench::GetAllocationCount() - allocations;
+  return result;
+}
+
+void Print(
+  const char* label,
+  const std::size_t packetsPerPump,
+  const double rate,
+  const Result& r) {
+  char buffer[96] {};
+  if (rate > 0) {
+    std::snprintf(
+      buffer,
+      sizeof(buffer),
+      "  %s, %zu packets/pump, %.0f kHz",
+      label,
+      packetsPerPump,
+      rate / 1000);
+  } else {
+    std::snprintf(
+      buffer,
+      sizeof(buffer),
+      "  %s, %zu packets/pump, unpaced",
+      label,
+      packetsPerPump);
+  }
+  Bench::Report(buffer, r.mSamples, r.mBusy);
+  Bench::Report(
+    "    achieved rate",
+    static_cast<double>(r.mSamples)
+      / std::chrono::duration<double>(r.mElapsed).count() / 1000,
+    "kHz");
+  Bench::Report(
+    "    allocations/sample",
+    static_cast<double>(r.mAllocations) / static_cast<double>(r.mSamples),
+    "");
+}
+
+// One `SetState()` per sample, and a `Flush()` every 8, as with per-message
+// ingestion
+template <Handler T>
+void RunDispatch(const char* label, T& handler) {
+  constexpr std::size_t Count = 20'000'000;
+  OTDIPC::Messages::State state {};
+  const auto start = Bench::Clock::now();
+  for (std::size_t i = 0; i < Count; ++i) {
+    state.x = static_cast<float>(i & 0x7fff);
+    handler.SetState(state);
+    if (i % 8 == 7) {
+      handler.Flush();
+    }
+  }
+  Bench::Report(label, Count, Bench::Clock::now() - start);
+}
+
+void RunDispatchComparison() {
+  CountingSink a;
+  CountingSink b;
+  std::printf("  dispatch only, stage -> 2 sinks\n");
+
+  MultiHandler multi {&a, &b};
+  DeviceCounter dynamic {&multi};
+  RunDispatch("    virtual IHandler chain", dynamic);
+
+  Pipeline pipeline {
+    DeviceCounterStage {}, FanOut<CountingSink, CountingSink> {&a, &b}};
+  RunDispatch("    static Pipeline", pipeline);
+
+  HandlerAdapter adapter {Pipeline {
+    DeviceCounterStage {}, FanOut<CountingSink, CountingSink> {&a, &b}}};
+  // Hide the type, as `WintabTablet` only has an `IHandler*`
+  IHandler* volatile erased = &adapter;
+  RunDispatch("    static Pipeline, via IHandler", *erased);
+
+  Bench::DoNotOptimize(a.mSum + b.mSum + a.mFlushes + b.mStates);
+}
+
+}// namespace
+
+BENCHMARK(Pipeline) {
+  const auto device = MakeDevice();
+  V2Sink v2;
+  V1Sink v1;
+  MultiHandler v2Only {&v2};
+  MultiHandler both {&v2, &v1};
+  DeviceCounter dynamic {&both};
+  Pipeline pipeline {DeviceCounterStage {}, FanOut<V2Sink, V1Sink> {&v2, &v1}};
+  pipeline.SetDevice(device);
+
+  {
+    constexpr std::size_t Count = 10'000'000;
+    const auto start = Bench::Clock::now();
+    for (std::size_t i = 0; i < Count; ++i) {
+      Bench::DoNotOptimize(SynthesizeVidPid(device.GetPersistentId()));
+    }
+    Bench::Report("  SynthesizeVidPid", Count, Bench::Clock::now() - start);
+  }
+
+  const auto packets = MakePackets(2'000'000);
+  for (const std::size_t packetsPerPump: {1, 8}) {
+    Print(
+      "v2 only",
+      packetsPerPump,
+      0,
+      Run(v2Only, packets, packetsPerPump, 0));
+    Print(
+      "v2 + v1, virtual",
+      packetsPerPump,
+      0,
+      Run(dynamic, packets, packetsPerPump, 0));
+    Print(
+      "v2 + v1, static",
+      packetsPerPump,
+      0,
+      Run(pipeline, packets, packetsPerPump, 0));
+  }
+  RunDispatchComparison();
+
+  // Enough samples for ~0.5s at each rate
+  for (const double rate: {1'000.0, 100'000.0, 500'000.0}) {
+    const auto subset = std::vector<Packet>(
+      packets.begin(),
+      packets.begin() + static_cast<std::ptrdiff_t>(rate / 2));
+    for (const std::size_t packetsPerPump: {1, 8}) {
+      Print(
+        "v2 + v1",
+        packetsPerPump,
+        rate,
+        Run(pipeline, subset, packetsPerPump, rate));
+    }
+  }
+
+  Bench::DoNotOptimize(v1.mBytes + v2.mBytes);
+}
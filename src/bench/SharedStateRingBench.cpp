@@ -0,0 +1,233 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Throughput and wake-up latency of the shared memory state ring, with an
+// AF_UNIX socketpair as the baseline.
+//
+// Readers run on threads, but each opens its own mapping, as a reader in
+// another process would.
+
+#include "../SharedStateRing.hpp"
+#include "Benchmark.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <OTDIPC/State.hpp>
+
+namespace {
+
+using Disposition = SharedStateRing::Disposition;
+
+std::string RingName() {
+  return "wintab-adapter-bench." + std::to_string(getpid()) + ".States";
+}
+
+void PrintLatencies(std::vector<int64_t>& latencies) {
+  std::ranges::sort(latencies);
+  const auto percentile = [&](const double p) {
+    const auto index = static_cast<std::size_t>(
+      p * static_cast<double>(latencies.size() - 1));
+    return static_cast<double>(latencies[index]);
+  };
+  Bench::Report("    latency p50", percentile(0.5), "ns");
+  Bench::Report("    latency p99", percentile(0.99), "ns");
+  Bench::Report("    latency p99.9", percentile(0.999), "ns");
+  Bench::Report("    latency max", static_cast<double>(latencies.back()), "ns");
+}
+
+// Writer publishes in batches as fast as possible; readers poll
+void RunThroughput(const std::size_t readerCount) {
+  constexpr std::size_t Count = 4'000'000;
+  constexpr std::size_t BatchSize = 16;
+
+  SharedStateRing writer(Disposition::Write, RingName());
+  std::vector<std::unique_ptr<SharedStateRing>> readers;
+  for (std::size_t i = 0; i < readerCount; ++i) {
+    readers.push_back(
+      std::make_unique<SharedStateRing>(Disposition::Read, writer.GetName()));
+  }
+
+  std::atomic<bool> done {false};
+  std::vector<std::size_t> readCounts(readerCount);
+  std::vector<std::jthread> threads;
+  for (std::size_t i = 0; i < readerCount; ++i) {
+    threads.emplace_back([&, i] {
+      auto& reader = *readers[i];
+      uint64_t last = 0;
+      while (true) {
+        const auto record = reader.TryRead();
+        if (!record) {
+          if (done) {
+            return;
+          }
+          std::this_thread::yield();
+          continue;
+        }
+        if (record->mSequence <= last) {
+          std::fprintf(stderr, "Sequence went backwards\n");
+          std::abort();
+        }
+        if (
+          record->mState.x
+          != static_cast<float>(record->mSequence % (1 << 24))) {
+          std::fprintf(stderr, "Torn read\n");
+          std::abort();
+        }
+        last = record->mSequence;
+        ++readCounts[i];
+      }
+    });
+  }
+
+  OTDIPC::Messages::State state {};
+  const auto start = Bench::Clock::now();
+  for (std::size_t i = 1; i <= Count; ++i) {
+    // Exactly representable, for the torn-read check
+    state.x = static_cast<float>(i % (1 << 24));
+    writer.Push(state, 0);
+    if (i % BatchSize == 0) {
+      writer.Wake();
+      std::this_thread::yield();
+    }
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+  done = true;
+  threads.clear();
+
+  std::printf("  %zu reader(s), batches of %zu\n", readerCount, BatchSize);
+  Bench::Report("    push", Count, elapsed);
+  for (std::size_t i = 0; i < readerCount; ++i) {
+    char label[64] {};
+    std::snprintf(label, sizeof(label), "    reader %zu read", i);
+    Bench::Report(label, static_cast<double>(readCounts[i]), "records");
+    std::snprintf(label, sizeof(label), "    reader %zu overruns", i);
+    Bench::Report(
+      label, static_cast<double>(readers[i]->GetOverrunCount()), "records");
+  }
+}
+
+// Writer publishes single records at `interval`; readers block in `Wait()`
+void RunRingLatency(
+  const std::size_t readerCount,
+  const std::size_t count,
+  const std::chrono::nanoseconds interval) {
+  SharedStateRing writer(Disposition::Write, RingName());
+  std::vector<Bench::Clock::time_point> sentAt(count + 1);
+  std::vector<std::vector<int64_t>> latencies(readerCount);
+
+  std::vector<std::jthread> threads;
+  for (std::size_t i = 0; i < readerCount; ++i) {
+    latencies[i].reserve(count);
+    threads.emplace_back([&, i, name = writer.GetName()] {
+      SharedStateRing reader(Disposition::Read, name);
+      while (latencies[i].size() < count) {
+        const auto record = reader.TryRead();
+        if (!record) {
+          std::ignore = reader.Wait(std::chrono::milliseconds(100));
+          continue;
+        }
+        latencies[i].push_back(
+          (Bench::Clock::now() - sentAt[record->mSequence]).count());
+      }
+    });
+  }
+  // Let the readers open the ring
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  OTDIPC::Messages::State state {};
+  auto next = Bench::Clock::now();
+  for (std::size_t i = 1; i <= count; ++i) {
+    next += interval;
+    std::this_thread::sleep_until(next);
+    sentAt[i] = Bench::Clock::now();
+    writer.Push(state, 0);
+    writer.Wake();
+  }
+  threads.clear();
+
+  std::printf(
+    "  shared memory, %zu reader(s), %lld us interval\n",
+    readerCount,
+    static_cast<long long>(
+      std::chrono::duration_cast<std::chrono::microseconds>(interval)
+        .count()));
+  std::vector<int64_t> all;
+  for (auto&& it: latencies) {
+    all.insert(all.end(), it.begin(), it.end());
+  }
+  PrintLatencies(all);
+}
+
+// Same as above, but one blocking `read()` per `State` over a socketpair
+void RunSocketLatency(
+  const std::size_t count,
+  const std::chrono::nanoseconds interval) {
+  std::array<int, 2> fds {};
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) != 0) {
+    std::perror("socketpair");
+    std::abort();
+  }
+
+  std::vector<Bench::Clock::time_point> sentAt(count);
+  std::vector<int64_t> latencies;
+  latencies.reserve(count);
+  std::jthread reader([&, fd = fds[1]] {
+    OTDIPC::Messages::State state {};
+    for (std::size_t i = 0; i < count; ++i) {
+      std::size_t received = 0;
+      while (received < sizeof(state)) {
+        const auto result = read(
+          fd, reinterpret_cast<std::byte*>(&state) + received,
+          sizeof(state) - received);
+        if (result <= 0) {
+          std::abort();
+        }
+        received += static_cast<std::size_t>(result);
+      }
+      latencies.push_back((Bench::Clock::now() - sentAt[i]).count());
+    }
+  });
+
+  OTDIPC::Messages::State state {};
+  auto next = Bench::Clock::now();
+  for (std::size_t i = 0; i < count; ++i) {
+    next += interval;
+    std::this_thread::sleep_until(next);
+    sentAt[i] = Bench::Clock::now();
+    if (send(fds[0], &state, sizeof(state), MSG_NOSIGNAL) != sizeof(state)) {
+      std::perror("send");
+      std::abort();
+    }
+  }
+  reader.join();
+  close(fds[0]);
+  close(fds[1]);
+
+  std::printf(
+    "  socketpair, %lld us interval\n",
+    static_cast<long long>(
+      std::chrono::duration_cast<std::chrono::microseconds>(interval)
+        .count()));
+  PrintLatencies(latencies);
+}
+
+}// namespace
+
+BENCHMARK(SharedStateRing) {
+  RunThroughput(1);
+  RunThroughput(4);
+
+  constexpr auto Interval = std::chrono::microseconds(500);
+  constexpr std::size_t Count = 4'000;
+  RunSocketLatency(Count, Interval);
+  RunRingLatency(1, Count, Interval);
+  RunRingLatency(4, Count, Interval);
+}
@@ -0,0 +1,108 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Stress test and benchmark for the WinTab thread -> reactor queue
+
+#include "../SpscRing.hpp"
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <OTDIPC/State.hpp>
+
+namespace {
+
+struct Item {
+  uint64_t mSequence {};
+  int64_t mEnqueuedAt {};
+  OTDIPC::Messages::State mState {};
+};
+
+using Ring = SpscRing<Item, 1024>;
+
+int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           Bench::Clock::now().time_since_epoch())
+    .count();
+}
+
+// If `interval` is zero, push as fast as possible
+void RunLatency(
+  const char* label,
+  const std::size_t count,
+  const std::chrono::nanoseconds interval) {
+  auto ring = std::make_unique<Ring>();
+  std::vector<int64_t> latencies;
+  latencies.reserve(count);
+
+  std::jthread consumer([&] {
+    uint64_t expected = 0;
+    while (expected < count) {
+      // Yield rather than spin so this is meaningful on machines with few
+      // cores
+      const auto consumed = ring->ConsumeAll([&](const Item& item) {
+        if (item.mSequence != expected) {
+          std::fprintf(
+            stderr,
+            "Out of order: expected %llu, got %llu\n",
+            static_cast<unsigned long long>(expected),
+            static_cast<unsigned long long>(item.mSequence));
+          std::abort();
+        }
+        ++expected;
+        latencies.push_back(Now() - item.mEnqueuedAt);
+      });
+      if (!consumed) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::size_t fullCount = 0;
+  const auto start = Bench::Clock::now();
+  auto next = start;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (interval.count()) {
+      next += interval;
+      while (Bench::Clock::now() < next) {
+        std::this_thread::yield();
+      }
+    }
+    Item item {.mSequence = i, .mEnqueuedAt = Now()};
+    item.mState.x = static_cast<float>(i);
+    while (!ring->TryPush(item)) {
+      ++fullCount;
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  const auto elapsed = Bench::Clock::now() - start;
+
+  std::ranges::sort(latencies);
+  const auto percentile = [&](const double p) {
+    const auto index = static_cast<std::size_t>(
+      p * static_cast<double>(latencies.size() - 1));
+    return static_cast<double>(latencies[index]);
+  };
+
+  std::printf("  %s\n", label);
+  Bench::Report("    push+pop", count, elapsed);
+  Bench::Report(
+    "    producer saw full ring", static_cast<double>(fullCount), "times");
+  Bench::Report("    latency p50", percentile(0.5), "ns");
+  Bench::Report("    latency p99", percentile(0.99), "ns");
+  Bench::Report("    latency p99.9", percentile(0.999), "ns");
+  Bench::Report("    latency max", static_cast<double>(latencies.back()), "ns");
+}
+
+}// namespace
+
+BENCHMARK(SpscRing) {
+  RunLatency("saturated", 10'000'000, {});
+  RunLatency("paced at 100kHz", 1'000'000, std::chrono::microseconds(10));
+  RunLatency("paced at 1kHz", 5'000, std::chrono::milliseconds(1));
+}
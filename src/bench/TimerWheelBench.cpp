@@ -0,0 +1,138 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// The reactor's timer wheel, on simulated time: first a scripted check that
+// aborts if a timer fires early, late, or after being cancelled, then the
+// cost of the operations the reactor does on every wake-up.
+
+#include "../TimerWheel.hpp"
+#include "Benchmark.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = TimerWheel::Clock;
+using std::chrono::milliseconds;
+
+void Expect(const bool condition, const char* what) {
+  if (!condition) {
+    std::fprintf(stderr, "TimerWheel: %s\n", what);
+    std::abort();
+  }
+}
+
+void RunScript() {
+  const auto epoch = Clock::now();
+  TimerWheel wheel(epoch);
+  Expect(!wheel.GetNextDue(), "next due with no timers");
+
+  std::vector<uint64_t> fired;
+  const auto record = [&fired](const uint64_t id) {
+    return [&fired, id] { fired.push_back(id); };
+  };
+
+  // Not early, even with sub-millisecond deadlines
+  wheel.Add(1, epoch + std::chrono::microseconds(1500), {}, record(1));
+  Expect(wheel.GetNextDue() == epoch + milliseconds(2), "rounded deadline");
+  wheel.Advance(epoch + std::chrono::microseconds(1999));
+  Expect(fired.empty(), "fired early");
+  wheel.Advance(epoch + milliseconds(2));
+  Expect(fired == std::vector<uint64_t> {1}, "one-shot");
+  Expect(wheel.empty(), "one-shot wasn't removed");
+
+  // Periodic, and further out than a revolution
+  wheel.Add(2, epoch + milliseconds(10), milliseconds(10), record(2));
+  wheel.Add(3, epoch + milliseconds(10'000), {}, record(3));
+  Expect(wheel.GetNextDue() == epoch + milliseconds(10), "next periodic");
+  fired.clear();
+  for (int i = 3; i <= 100; ++i) {
+    wheel.Advance(epoch + milliseconds(i));
+  }
+  Expect(fired.size() == 10, "periodic count");
+  wheel.Cancel(2);
+  Expect(
+    wheel.GetNextDue() == epoch + milliseconds(10'000), "next on a later lap");
+
+  // Long sleeps fire everything that's due exactly once, and don't try to
+  // catch up on missed intervals
+  wheel.Add(4, epoch + milliseconds(200), milliseconds(50), record(4));
+  fired.clear();
+  wheel.Advance(epoch + milliseconds(20'000));
+  Expect(fired.size() == 2, "long sleep");
+  Expect(
+    wheel.GetNextDue() == epoch + milliseconds(20'050), "next after sleep");
+
+  // A callback can cancel itself, and add timers; new timers are never run
+  // by the same `Advance()`
+  fired.clear();
+  wheel.Add(5, epoch + milliseconds(20'010), milliseconds(10), [&] {
+    fired.push_back(5);
+    wheel.Cancel(5);
+    wheel.Add(6, epoch, {}, record(6));
+  });
+  wheel.Advance(epoch + milliseconds(20'010));
+  Expect(fired == std::vector<uint64_t> {5}, "self-cancel");
+  wheel.Advance(epoch + milliseconds(20'011));
+  Expect((fired == std::vector<uint64_t> {5, 6}), "added by a callback");
+  wheel.Cancel(4);
+  Expect(wheel.empty(), "cancel");
+
+  std::printf("  scripted timers: OK\n");
+}
+
+void RunThroughput() {
+  constexpr std::size_t TimerCount = 10'000;
+  constexpr int SimulatedMilliseconds = 10'000;
+
+  const auto epoch = Clock::now();
+  TimerWheel wheel(epoch);
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> intervals(1, 5000);
+
+  uint64_t fireCount = 0;
+  for (uint64_t id = 0; id < TimerCount; ++id) {
+    const auto interval = milliseconds(intervals(random));
+    wheel.Add(id, epoch + interval, interval, [&fireCount] { ++fireCount; });
+  }
+
+  // One `Advance()` and `GetNextDue()` per simulated millisecond, as if the
+  // reactor was woken at 1 kHz
+  auto start = Bench::Clock::now();
+  for (int i = 1; i <= SimulatedMilliseconds; ++i) {
+    wheel.Advance(epoch + milliseconds(i));
+    Bench::DoNotOptimize(wheel.GetNextDue());
+  }
+  auto elapsed = Bench::Clock::now() - start;
+  std::printf("  %zu periodic timers\n", TimerCount);
+  Bench::Report(
+    "    advance + next due, per ms", SimulatedMilliseconds, elapsed);
+  Bench::Report("    per timer fired", fireCount, elapsed);
+
+  // The steady-state heartbeat: add and cancel a timer, as the servers do
+  // when clients come and go
+  constexpr std::size_t Churn = 1'000'000;
+  const auto allocations = Bench::GetAllocationCount();
+  start = Bench::Clock::now();
+  for (std::size_t i = 0; i < Churn; ++i) {
+    const auto id = TimerCount + i;
+    wheel.Add(id, epoch + milliseconds(SimulatedMilliseconds + 1000), {}, {});
+    wheel.Cancel(id);
+  }
+  elapsed = Bench::Clock::now() - start;
+  Bench::Report("    add + cancel", Churn, elapsed);
+  Bench::Report(
+    "    allocations per add + cancel",
+    static_cast<double>(Bench::GetAllocationCount() - allocations) / Churn,
+    "");
+}
+
+}// namespace
+
+BENCHMARK(TimerWheel) {
+  RunScript();
+  RunThroughput();
+}
@@ -0,0 +1,201 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// V1Server's connection state machine against a fake pipe: first a scripted
+// connect/write/disconnect/stop sequence that aborts on any unexpected
+// transition, then the cost of queueing and completing writes.
+
+#include "../V1Connection.hpp"
+#include "Benchmark.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+
+#include <OTDIPC/V1/Ping.hpp>
+#include <OTDIPC/V1/State.hpp>
+
+namespace {
+
+using Status = V1Connection::Status;
+
+// Completes nothing by itself; the benchmark plays the role of the pipe
+// thread, and reports completions
+class FakePipe final : public V1Connection::IPipe {
+ public:
+  bool BeginConnect() override {
+    ++mConnectCount;
+    return mCanConnect;
+  }
+
+  bool BeginWrite(const std::span<const std::byte> message) override {
+    if (!mInFlight.empty()) {
+      Fail("overlapping writes");
+    }
+    mInFlight = message;
+    ++mWriteCount;
+    return mCanWrite;
+  }
+
+  void Disconnect() override {
+    mInFlight = {};
+    ++mDisconnectCount;
+  }
+
+  // Returns the message that was in flight
+  template <class T>
+  T TakeWrite() {
+    if (mInFlight.size() != sizeof(T)) {
+      Fail("unexpected write size");
+    }
+    T ret {};
+    std::memcpy(&ret, mInFlight.data(), sizeof(T));
+    mInFlight = {};
+    return ret;
+  }
+
+  [[noreturn]]
+  static void Fail(const char* what) {
+    std::fprintf(stderr, "V1Connection: %s\n", what);
+    std::abort();
+  }
+
+  bool mCanConnect {true};
+  bool mCanWrite {true};
+  std::span<const std::byte> mInFlight;
+  std::size_t mConnectCount {};
+  std::size_t mWriteCount {};
+  std::size_t mDisconnectCount {};
+};
+
+void Expect(const bool condition, const char* what) {
+  if (!condition) {
+    FakePipe::Fail(what);
+  }
+}
+
+OTDIPC::V1::Messages::Ping MakePing(const uint64_t sequenceNumber) {
+  OTDIPC::V1::Messages::Ping ping {};
+  ping.messageType = OTDIPC::V1::Messages::Ping::MESSAGE_TYPE;
+  ping.size = sizeof(ping);
+  ping.sequenceNumber = sequenceNumber;
+  return ping;
+}
+
+void RunScript() {
+  using OTDIPC::V1::Messages::Ping;
+
+  FakePipe pipe;
+  V1Connection connection(pipe);
+  Expect(connection.GetStatus() == Status::Stopped, "initial status");
+  Expect(!connection.Queue(MakePing(0)), "queued while stopped");
+
+  connection.Start();
+  Expect(connection.GetStatus() == Status::Listening, "listening");
+  Expect(pipe.mConnectCount == 1, "BeginConnect() on start");
+  Expect(!connection.Queue(MakePing(0)), "queued while listening");
+
+  // Writes are in order, and one at a time
+  connection.OnConnected();
+  Expect(connection.GetStatus() == Status::Connected, "connected");
+  Expect(connection.Queue(MakePing(1)), "queue 1");
+  Expect(connection.Queue(MakePing(2)), "queue 2");
+  Expect(pipe.mWriteCount == 0, "wrote before Pump()");
+  connection.Pump();
+  Expect(connection.Queue(MakePing(3)), "queue 3 while writing");
+  connection.Pump();
+  Expect(pipe.mWriteCount == 1, "overlapping writes");
+  for (uint64_t i = 1; i <= 3; ++i) {
+    Expect(pipe.TakeWrite<Ping>().sequenceNumber == i, "write order");
+    connection.OnWriteComplete();
+  }
+  Expect(pipe.mWriteCount == 3, "write count");
+  Expect(pipe.mInFlight.empty(), "idle after draining");
+
+  // Stop queueing if the client isn't reading
+  std::size_t queued = 0;
+  while (connection.Queue(MakePing(queued))) {
+    ++queued;
+  }
+  Expect(
+    queued == V1Connection::MaxBacklog / sizeof(Ping), "backlog limit");
+
+  // A disconnect drops the backlog, and listens again
+  connection.Pump();
+  connection.OnDisconnected();
+  Expect(connection.GetStatus() == Status::Listening, "relisten");
+  Expect(pipe.mDisconnectCount == 1, "Disconnect() on disconnect");
+  Expect(pipe.mConnectCount == 2, "BeginConnect() after disconnect");
+  connection.OnWriteComplete();// Stale completion
+  connection.OnConnected();
+  connection.Pump();
+  Expect(pipe.mInFlight.empty(), "backlog survived disconnect");
+
+  // A failed write is a disconnect
+  pipe.mCanWrite = false;
+  Expect(connection.Queue(MakePing(4)), "queue 4");
+  connection.Pump();
+  Expect(connection.GetStatus() == Status::Listening, "failed write");
+  pipe.mCanWrite = true;
+
+  // Failing to listen stops, so the owner can recreate the pipe
+  pipe.mCanConnect = false;
+  connection.OnDisconnected();
+  Expect(connection.GetStatus() == Status::Stopped, "failed listen");
+  pipe.mCanConnect = true;
+  connection.Start();
+  Expect(connection.GetStatus() == Status::Listening, "restart");
+
+  connection.Stop();
+  Expect(connection.GetStatus() == Status::Stopped, "stop");
+  connection.OnConnected();
+  Expect(connection.GetStatus() == Status::Stopped, "connected after stop");
+
+  std::printf("  scripted transitions: OK\n");
+}
+
+// One pump's worth of states per wake-up, each completed immediately
+void RunThroughput() {
+  constexpr std::size_t Count = 4'000'000;
+  constexpr std::size_t PumpSize = 8;
+
+  FakePipe pipe;
+  V1Connection connection(pipe);
+  connection.Start();
+  connection.OnConnected();
+
+  OTDIPC::V1::Messages::State state {};
+  state.messageType = OTDIPC::V1::Messages::State::MESSAGE_TYPE;
+  state.size = sizeof(state);
+
+  const auto allocations = Bench::GetAllocationCount();
+  const auto start = Bench::Clock::now();
+  for (std::size_t i = 0; i < Count; i += PumpSize) {
+    for (std::size_t j = 0; j < PumpSize; ++j) {
+      state.x = static_cast<float>(i + j);
+      connection.Queue(state);
+    }
+    connection.Pump();
+    while (!pipe.mInFlight.empty()) {
+      Bench::DoNotOptimize(pipe.TakeWrite<OTDIPC::V1::Messages::State>());
+      connection.OnWriteComplete();
+    }
+  }
+  const auto elapsed = Bench::Clock::now() - start;
+
+  Expect(pipe.mWriteCount == Count, "lost writes");
+  std::printf("  pumps of %zu states\n", PumpSize);
+  Bench::Report("    queue + write + complete", Count, elapsed);
+  Bench::Report(
+    "    allocations",
+    static_cast<double>(Bench::GetAllocationCount() - allocations),
+    "");
+}
+
+}// namespace
+
+BENCHMARK(V1Connection) {
+  RunScript();
+  RunThroughput();
+}
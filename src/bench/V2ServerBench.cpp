@@ -0,0 +1,441 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// End-to-end throughput of the real V2Server - ring, reactor, framing, and
+// the AF_UNIX transport - to many local clients, and how often the reactor
+// wakes up when the pen is idle, or moving at a typical report rate, and
+// what a client receives with and without `DeliveryPacing`.
+//
+// Clients are threads rather than processes, but each has its own socket, and
+// parses the stream as an OTD-IPC client would.
+
+#include "../V2Server.hpp"
+#include "Benchmark.hpp"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <OTDIPC/Header.hpp>
+#include <OTDIPC/State.hpp>
+
+namespace {
+
+using OTDIPC::Messages::MessageType;
+
+// The server logs every connection and disconnection; keep those out of the
+// results
+class QuietStdout final {
+ public:
+  QuietStdout() {
+    std::fflush(stdout);
+    mSaved = dup(STDOUT_FILENO);
+    const auto null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+  }
+
+  ~QuietStdout() {
+    std::fflush(stdout);
+    dup2(mSaved, STDOUT_FILENO);
+    close(mSaved);
+  }
+
+ private:
+  int mSaved {-1};
+};
+
+class Client final {
+ public:
+  explicit Client(const std::filesystem::path& socketPath) {
+    mFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr {.sun_family = AF_UNIX};
+    std::ranges::copy(socketPath.string(), addr.sun_path);
+    if (connect(mFD, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+      std::perror("connect");
+      std::abort();
+    }
+    mThread = std::jthread([this] { ReadLoop(); });
+  }
+
+  ~Client() {
+    mThread = {};
+    close(mFD);
+  }
+
+  Client(const Client&) = delete;
+  Client& operator=(const Client&) = delete;
+
+  // The server adds clients to its list before sending `Hello`
+  [[nodiscard]]
+  bool IsRegistered() const {
+    return mIsRegistered;
+  }
+
+  [[nodiscard]]
+  uint64_t GetStateCount() const {
+    return mStateCount.load(std::memory_order_relaxed);
+  }
+
+  // Number of `read()`s that returned data
+  [[nodiscard]]
+  uint64_t GetWakeCount() const {
+    return mWakeCount.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]]
+  uint64_t GetByteCount() const {
+    return mByteCount.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]]
+  uint64_t GetButtonChangeCount() const {
+    return mButtonChangeCount.load(std::memory_order_relaxed);
+  }
+
+  template <class T>
+  void Send(const T& message) {
+    if (write(mFD, &message, sizeof(message)) != sizeof(message)) {
+      std::perror("write");
+      std::abort();
+    }
+  }
+
+ private:
+  int mFD {-1};
+  std::atomic<bool> mIsRegistered {false};
+  std::atomic<uint64_t> mStateCount {};
+  std::atomic<uint64_t> mWakeCount {};
+  std::atomic<uint64_t> mByteCount {};
+  std::atomic<uint64_t> mButtonChangeCount {};
+  uint32_t mPenButtons {};
+  std::jthread mThread;
+
+  // Returns when the server closes the connection
+  void ReadLoop() {
+    std::vector<std::byte> buffer(64 * 1024);
+    std::size_t used = 0;
+    while (true) {
+      const auto result
+        = read(mFD, buffer.data() + used, buffer.size() - used);
+      if (result <= 0) {
+        return;
+      }
+      used += static_cast<std::size_t>(result);
+      mWakeCount.fetch_add(1, std::memory_order_relaxed);
+      mByteCount.fetch_add(result, std::memory_order_relaxed);
+
+      std::size_t offset = 0;
+      while (used - offset >= sizeof(OTDIPC::Messages::Header)) {
+        OTDIPC::Messages::Header header {};
+        std::memcpy(&header, buffer.data() + offset, sizeof(header));
+        if (used - offset < header.size) {
+          break;
+        }
+        if (header.messageType == MessageType::State) {
+          mStateCount.fetch_add(1, std::memory_order_relaxed);
+          OTDIPC::Messages::State state {};
+          std::memcpy(&state, buffer.data() + offset, sizeof(state));
+          if (state.penButtons != mPenButtons) {
+            mPenButtons = state.penButtons;
+            mButtonChangeCount.fetch_add(1, std::memory_order_relaxed);
+          }
+        } else if (header.messageType == MessageType::Hello) {
+          mIsRegistered = true;
+        }
+        offset += header.size;
+      }
+      std::memmove(buffer.data(), buffer.data() + offset, used - offset);
+      used -= offset;
+    }
+  }
+};
+
+// The WinTab thread's pattern: a few states per pump, then `Flush()`
+void RunClients(const std::size_t clientCount) {
+  constexpr std::size_t Count = 200'000;
+  constexpr std::size_t PumpSize = 8;
+
+  const auto id = "wintab-adapter-bench." + std::to_string(getpid());
+  const auto root = std::filesystem::temp_directory_path() / id;
+
+  Bench::Clock::duration produceElapsed {};
+  Bench::Clock::duration deliverElapsed {};
+  uint64_t delivered = 0;
+  uint64_t minDelivered = Count;
+  uint64_t wakeCount = 0;
+  {
+    const QuietStdout quiet;
+    Reactor reactor;
+    V2Server server(
+      reactor,
+      V2Server::Config {
+        .implementationId = id,
+        .humanName = "Benchmark",
+        .socketPath = root / "socket",
+        .discoveryDir = root / "discovery",
+      },
+      V2Server::DefaultBehavior::DoNotSet);
+    server.Start();
+
+    std::vector<std::unique_ptr<Client>> clients;
+    for (std::size_t i = 0; i < clientCount; ++i) {
+      clients.push_back(std::make_unique<Client>(root / "socket"));
+    }
+    while (!std::ranges::all_of(clients, &Client::IsRegistered)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const auto totalDelivered = [&clients] {
+      uint64_t total = 0;
+      for (auto&& client: clients) {
+        total += client->GetStateCount();
+      }
+      return total;
+    };
+
+    OTDIPC::Messages::State state {};
+    state.validBits = OTDIPC::Messages::State::ValidMask::PositionX;
+    const auto wakeCountAtStart = reactor.GetWakeCount();
+    const auto start = Bench::Clock::now();
+    for (std::size_t i = 1; i <= Count; ++i) {
+      state.x = static_cast<float>(i);
+      server.SetState(state);
+      if (i % PumpSize == 0) {
+        server.Flush();
+        std::this_thread::yield();
+      }
+    }
+    produceElapsed = Bench::Clock::now() - start;
+
+    // Wait for the clients to drain
+    auto lastChange = Bench::Clock::now();
+    while (Bench::Clock::now() - lastChange < std::chrono::milliseconds(100)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      if (const auto total = totalDelivered(); total != delivered) {
+        delivered = total;
+        lastChange = Bench::Clock::now();
+      }
+    }
+    deliverElapsed = lastChange - start;
+    wakeCount = reactor.GetWakeCount() - wakeCountAtStart;
+    for (auto&& client: clients) {
+      minDelivered = std::min(minDelivered, client->GetStateCount());
+    }
+
+    server.Stop();
+  }
+  std::filesystem::remove_all(root);
+
+  std::printf(
+    "  %zu client(s), %zu states in pumps of %zu\n",
+    clientCount,
+    Count,
+    PumpSize);
+  Bench::Report("    SetState", Count, produceElapsed);
+  Bench::Report("    delivered (all clients)", delivered, deliverElapsed);
+  Bench::Report(
+    "    delivered (slowest client)",
+    100.0 * static_cast<double>(minDelivered) / Count,
+    "%");
+  Bench::Report(
+    "    reactor wake-ups per pump",
+    static_cast<double>(wakeCount) / (Count / PumpSize),
+    "");
+}
+
+Bench::Clock::duration GetCPUTime() {
+  rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+    + std::chrono::microseconds(
+      usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+// Wake-ups and CPU time for the whole process - server and clients - with no
+// clients, then while the pen is idle, then while it reports at 1 kHz with a
+// flush per report
+void RunPaced() {
+  constexpr std::size_t ClientCount = 8;
+  constexpr auto Duration = std::chrono::seconds(2);
+  constexpr auto ReportInterval = std::chrono::milliseconds(1);
+
+  const auto id = "wintab-adapter-bench." + std::to_string(getpid());
+  const auto root = std::filesystem::temp_directory_path() / id;
+
+  struct Sample {
+    const char* mLabel;
+    uint64_t mWakeCount {};
+    Bench::Clock::duration mCPUTime {};
+  };
+  Sample samples[] {{"no clients"}, {"idle"}, {"1 kHz"}};
+  {
+    const QuietStdout quiet;
+    Reactor reactor;
+    V2Server server(
+      reactor,
+      V2Server::Config {
+        .implementationId = id,
+        .humanName = "Benchmark",
+        .socketPath = root / "socket",
+        .discoveryDir = root / "discovery",
+      },
+      V2Server::DefaultBehavior::DoNotSet);
+    server.Start();
+
+    std::vector<std::unique_ptr<Client>> clients;
+    OTDIPC::Messages::State state {};
+    state.validBits = OTDIPC::Messages::State::ValidMask::PositionX;
+    for (auto&& sample: samples) {
+      if (&sample == &samples[1]) {
+        for (std::size_t i = 0; i < ClientCount; ++i) {
+          clients.push_back(std::make_unique<Client>(root / "socket"));
+        }
+        while (!std::ranges::all_of(clients, &Client::IsRegistered)) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+      const bool isMoving = (&sample == &samples[2]);
+      const auto wakeCount = reactor.GetWakeCount();
+      const auto cpuTime = GetCPUTime();
+      const auto end = Bench::Clock::now() + Duration;
+      for (auto next = Bench::Clock::now(); isMoving && next < end;) {
+        next += ReportInterval;
+        std::this_thread::sleep_until(next);
+        state.x += 1;
+        server.SetState(state);
+        server.Flush();
+      }
+      std::this_thread::sleep_until(end);
+      sample.mWakeCount = reactor.GetWakeCount() - wakeCount;
+      sample.mCPUTime = GetCPUTime() - cpuTime;
+    }
+
+    server.Stop();
+  }
+  std::filesystem::remove_all(root);
+
+  const auto seconds = std::chrono::duration<double>(Duration).count();
+  std::printf("  %zu clients, paced\n", ClientCount);
+  for (auto&& sample: samples) {
+    std::printf("    %s\n", sample.mLabel);
+    Bench::Report(
+      "      reactor wake-ups", sample.mWakeCount / seconds, "/s");
+    Bench::Report(
+      "      process CPU",
+      100 * std::chrono::duration<double>(sample.mCPUTime).count() / seconds,
+      "%");
+  }
+}
+
+// What a client rendering at 90 Hz receives while the pen reports at 1 kHz,
+// with a button change every 100ms, with and without `DeliveryPacing`
+void RunFramePacing() {
+  constexpr auto Duration = std::chrono::seconds(2);
+  constexpr auto ReportInterval = std::chrono::milliseconds(1);
+  constexpr auto ButtonInterval = std::chrono::milliseconds(100);
+  constexpr auto FrameInterval = std::chrono::microseconds(1'000'000 / 90);
+
+  const auto id = "wintab-adapter-bench." + std::to_string(getpid());
+  const auto root = std::filesystem::temp_directory_path() / id;
+
+  std::printf("  1 kHz pen, button change every 100ms, 90 Hz client\n");
+  for (const bool isPaced: {false, true}) {
+    uint64_t wakeCount {};
+    uint64_t byteCount {};
+    uint64_t stateCount {};
+    uint64_t buttonChanges {};
+    uint64_t buttonChangesSeen {};
+    {
+      const QuietStdout quiet;
+      Reactor reactor;
+      V2Server server(
+        reactor,
+        V2Server::Config {
+          .implementationId = id,
+          .humanName = "Benchmark",
+          .socketPath = root / "socket",
+          .discoveryDir = root / "discovery",
+        },
+        V2Server::DefaultBehavior::DoNotSet);
+      server.Start();
+
+      Client client(root / "socket");
+      while (!client.IsRegistered()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if (isPaced) {
+        DeliveryPacing pacing {};
+        pacing.messageType = DeliveryPacing::MESSAGE_TYPE;
+        pacing.size = sizeof(pacing);
+        pacing.guid = DeliveryPacing::GUID;
+        pacing.intervalMicroseconds = FrameInterval.count();
+        client.Send(pacing);
+        // Make sure it's been handled before the pen moves
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+
+      OTDIPC::Messages::State state {};
+      state.validBits = OTDIPC::Messages::State::ValidMask::PositionX
+        | OTDIPC::Messages::State::ValidMask::PenButtons;
+      const auto start = Bench::Clock::now();
+      const auto end = start + Duration;
+      auto nextButtonChange = start + ButtonInterval;
+      const auto wakeCountAtStart = client.GetWakeCount();
+      const auto byteCountAtStart = client.GetByteCount();
+      const auto stateCountAtStart = client.GetStateCount();
+      for (auto next = start; next < end;) {
+        next += ReportInterval;
+        std::this_thread::sleep_until(next);
+        state.x += 1;
+        if (next >= nextButtonChange) {
+          state.penButtons ^= 1;
+          ++buttonChanges;
+          nextButtonChange += ButtonInterval;
+        }
+        server.SetState(state);
+        server.Flush();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      wakeCount = client.GetWakeCount() - wakeCountAtStart;
+      byteCount = client.GetByteCount() - byteCountAtStart;
+      stateCount = client.GetStateCount() - stateCountAtStart;
+      buttonChangesSeen = client.GetButtonChangeCount();
+
+      server.Stop();
+    }
+    std::filesystem::remove_all(root);
+
+    const auto seconds = std::chrono::duration<double>(Duration).count();
+    std::printf("    %s\n", isPaced ? "paced" : "every sample");
+    Bench::Report("      client wake-ups", wakeCount / seconds, "/s");
+    Bench::Report("      states", stateCount / seconds, "/s");
+    Bench::Report("      bytes", byteCount / seconds, "B/s");
+    Bench::Report(
+      "      button changes seen",
+      100.0 * static_cast<double>(buttonChangesSeen)
+        / static_cast<double>(buttonChanges),
+      "%");
+  }
+}
+
+}// namespace
+
+BENCHMARK(V2Server) {
+  RunClients(1);
+  RunClients(8);
+  RunClients(64);
+  RunPaced();
+  RunFramePacing();
+}
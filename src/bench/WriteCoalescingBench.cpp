@@ -0,0 +1,142 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// Compares one `send()` per OTD-IPC message with `V2Server`'s per-pump
+// staging, over a local AF_UNIX socketpair.
+
+#include "../SendBuffer.hpp"
+#include "Benchmark.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <OTDIPC/Ping.hpp>
+#include <OTDIPC/State.hpp>
+
+namespace {
+
+constexpr std::size_t PumpCount = 100'000;
+// One ping per second at 1000 pumps per second
+constexpr std::size_t PumpsPerPing = 1000;
+
+struct Result {
+  std::size_t mMessages {};
+  std::size_t mBytes {};
+  std::size_t mSyscalls {};
+  Bench::Clock::duration mElapsed {};
+};
+
+void SendAll(const int fd, const void* data, std::size_t size, Result& result) {
+  auto it = static_cast<const std::byte*>(data);
+  while (size > 0) {
+    const auto sent = send(fd, it, size, MSG_NOSIGNAL);
+    ++result.mSyscalls;
+    if (sent < 0) {
+      std::perror("send");
+      std::abort();
+    }
+    it += sent;
+    size -= static_cast<std::size_t>(sent);
+  }
+}
+
+template <bool Coalesce>
+Result Run(const std::size_t statesPerPump) {
+  std::array<int, 2> fds {};
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) != 0) {
+    std::perror("socketpair");
+    std::abort();
+  }
+
+  std::size_t received {};
+  std::jthread reader([fd = fds[1], &received] {
+    std::array<std::byte, 64 * 1024> buffer {};
+    while (true) {
+      const auto result = read(fd, buffer.data(), buffer.size());
+      if (result <= 0) {
+        return;
+      }
+      received += static_cast<std::size_t>(result);
+    }
+  });
+
+  Result result {};
+  SendBuffer staging(16 * 1024);
+  OTDIPC::Messages::State state {};
+  OTDIPC::Messages::Ping ping {};
+  ping.messageType = OTDIPC::Messages::Ping::MESSAGE_TYPE;
+  ping.size = sizeof(ping);
+
+  const auto send = [&](const auto& message) {
+    ++result.mMessages;
+    result.mBytes += sizeof(message);
+    if constexpr (Coalesce) {
+      staging.Append(message);
+    } else {
+      SendAll(fds[0], &message, sizeof(message), result);
+    }
+  };
+
+  const auto start = Bench::Clock::now();
+  for (std::size_t pump = 0; pump < PumpCount; ++pump) {
+    for (std::size_t i = 0; i < statesPerPump; ++i) {
+      state.x = static_cast<float>(pump);
+      state.y = static_cast<float>(i);
+      send(state);
+    }
+    if (pump % PumpsPerPing == 0) {
+      ping.sequenceNumber = pump / PumpsPerPing;
+      send(ping);
+    }
+    if constexpr (Coalesce) {
+      const auto pending = staging.GetPending();
+      SendAll(fds[0], pending.data(), pending.size(), result);
+      staging.clear();
+    }
+  }
+  shutdown(fds[0], SHUT_WR);
+  reader.join();
+  result.mElapsed = Bench::Clock::now() - start;
+
+  close(fds[0]);
+  close(fds[1]);
+
+  if (received != result.mBytes) {
+    std::fprintf(
+      stderr, "Expected %zu bytes, received %zu\n", result.mBytes, received);
+    std::abort();
+  }
+  return result;
+}
+
+void Print(const char* mode, const std::size_t statesPerPump, const Result& r) {
+  char label[64] {};
+  std::snprintf(
+    label, sizeof(label), "%s, %zu states/pump", mode, statesPerPump);
+  Bench::Report(label, r.mMessages, r.mElapsed);
+
+  const auto seconds = std::chrono::duration<double>(r.mElapsed).count();
+  std::snprintf(label, sizeof(label), "  %s syscalls/message", mode);
+  Bench::Report(
+    label,
+    static_cast<double>(r.mSyscalls) / static_cast<double>(r.mMessages),
+    "");
+  std::snprintf(label, sizeof(label), "  %s throughput", mode);
+  Bench::Report(
+    label, static_cast<double>(r.mBytes) / seconds / (1024 * 1024), "MiB/s");
+}
+
+}// namespace
+
+BENCHMARK(WriteCoalescing) {
+  for (const std::size_t statesPerPump: {1, 4, 16}) {
+    Print("per-message", statesPerPump, Run<false>(statesPerPump));
+    Print("coalesced", statesPerPump, Run<true>(statesPerPump));
+  }
+}
@@ -0,0 +1,74 @@
+// Copyright 2026 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace Bench {
+
+std::vector<Benchmark>& GetRegistry() {
+  static std::vector<Benchmark> registry;
+  return registry;
+}
+
+Registration::Registration(const std::string_view name, void (*run)()) {
+  GetRegistry().push_back({name, run});
+}
+
+void Report(
+  const std::string_view label,
+  const std::uint64_t count,
+  const Clock::duration elapsed) {
+  const auto ns = static_cast<double>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  std::printf(
+    "  %-48.*s %10.1f ns/op %14.0f ops/s\n",
+    static_cast<int>(label.size()),
+    label.data(),
+    ns / static_cast<double>(count),
+    static_cast<double>(count) * 1e9 / ns);
+}
+
+void Report(
+  const std::string_view label,
+  const double value,
+  const std::string_view unit) {
+  std::printf(
+    "  %-48.*s %14.2f %.*s\n",
+    static_cast<int>(label.size()),
+    label.data(),
+    value,
+    static_cast<int>(unit.size()),
+    unit.data());
+}
+
+}// namespace Bench
+
+// Usage: wintab-adapter-bench [name-substring...]
+int main(int argc, char** argv) {
+  auto& registry = Bench::GetRegistry();
+  std::ranges::sort(registry, {}, &Bench::Benchmark::mName);
+
+  const auto selected = [argc, argv](const std::string_view name) {
+    if (argc < 2) {
+      return true;
+    }
+    return std::any_of(argv + 1, argv + argc, [name](const char* filter) {
+      return name.find(filter) != std::string_view::npos;
+    });
+  };
+
+  for (auto&& [name, run]: registry) {
+    if (!selected(name)) {
+      continue;
+    }
+    std::printf(
+      "%.*s\n", static_cast<int>(name.size()), name.data());
+    run();
+  }
+  return EXIT_SUCCESS;
+}
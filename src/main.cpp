@@ -4,6 +4,16 @@
 #include <magic_args/magic_args.hpp>
 #include <magic_enum/magic_enum.hpp>
 
+#include "CalibrationStage.hpp"
+#include "DeviceCache.hpp"
+#include "LatencyHistogram.hpp"
+#include "Log.hpp"
+#include "MappedFile.hpp"
+#include "PacketTrace.hpp"
+#include "PenPredictor.hpp"
+#include "Pipeline.hpp"
+#include "Reactor.hpp"
+#include "SharedHookTelemetry.hpp"
 #include "V1Server.hpp"
 #include "V2Server.hpp"
 #include "WintabTablet.hpp"
@@ -11,20 +21,20 @@
 
 // clang-format off
 #include <Windows.h>
+#include <intrin.h>
 #include <knownfolders.h>
 #include <shlobj_core.h>
 #include <wil/resource.h>
 // clang-format on
 
 namespace {
-std::filesystem::path get_socket_path() {
+std::filesystem::path get_local_app_data() {
   wil::unique_cotaskmem_string localAppData;
   if (SUCCEEDED(SHGetKnownFolderPath(
         FOLDERID_LocalAppData, 0, nullptr, &localAppData))) {
-    return std::filesystem::path(localAppData.get())
-      / "OpenKneeboard WinTab Adapter" / "socket";
+    return std::filesystem::path(localAppData.get());
   }
-  return {};
+  throw std::runtime_error("Failed to resolve %LOCALAPPDATA%");
 }
 
 static wil::unique_event gExitEvent;
@@ -33,6 +43,93 @@ BOOL WINAPI ConsoleCtrlHandler(DWORD /*dwCtrlType*/) {
   return TRUE;
 }
 
+constexpr auto LatencyReportInterval = std::chrono::seconds(10);
+
+void PrintLatencyReport() {
+  const auto us = [](const std::chrono::nanoseconds value) {
+    return std::chrono::duration<double, std::micro>(value).count();
+  };
+  for (auto&& stage: magic_enum::enum_values<LatencyStage>()) {
+    const auto summary = GetLatencyHistogram(stage).TakeSummary();
+    if (summary.mCount == 0) {
+      continue;
+    }
+    Log::Info(
+      "Latency {}: {} samples, p50 {:.1f}us, p99 {:.1f}us, p99.9 {:.1f}us, "
+      "max {:.1f}us",
+      magic_enum::enum_name(stage),
+      summary.mCount,
+      us(summary.mP50),
+      us(summary.mP99),
+      us(summary.mP999),
+      us(summary.mMax));
+  }
+}
+
+// Cost of the hijack DLL's hooks inside the driver processes
+class HookReport final {
+ public:
+  HookReport()
+    : mLastTicks(__rdtsc()),
+      mLastReport(std::chrono::steady_clock::now()) {
+  }
+
+  void Print() {
+    const auto telemetry = mTelemetry.Get();
+    if (!telemetry) {
+      return;
+    }
+    // The hooks count timestamp counter ticks; calibrate against the clock
+    const auto ticks = __rdtsc();
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsedTicks
+      = static_cast<double>(ticks - std::exchange(mLastTicks, ticks));
+    const auto elapsed = std::chrono::duration<double>(
+      now - std::exchange(mLastReport, now));
+    if (elapsedTicks <= 0 || elapsed.count() <= 0) {
+      return;
+    }
+    const auto ns = [ticksPerNs = elapsedTicks / (elapsed.count() * 1e9)](
+                      const double value) { return value / ticksPerNs; };
+
+    for (auto&& process: telemetry->processes) {
+      const auto processId = process.processId.load(std::memory_order_acquire);
+      if (!processId) {
+        continue;
+      }
+      const std::string_view name {
+        process.executableName,
+        strnlen(process.executableName, sizeof(process.executableName))};
+      for (auto&& hook: magic_enum::enum_values<HookTelemetry::Hook>()) {
+        const auto summary = HookTelemetry::TakeSummary(
+          process.hooks[std::to_underlying(hook)]);
+        if (summary.mCalls == 0) {
+          continue;
+        }
+        const auto calls = static_cast<double>(summary.mCalls);
+        Log::Info(
+          "Hook {} in {} ({}): {:.0f} calls/s, {:.1f}% overridden, mean "
+          "{:.0f}ns, p50 <{:.0f}ns, p99 <{:.0f}ns, {:.4f}% of a core",
+          magic_enum::enum_name(hook),
+          name,
+          processId,
+          calls / elapsed.count(),
+          100.0 * static_cast<double>(summary.mHits) / calls,
+          ns(static_cast<double>(summary.mCycles) / calls),
+          ns(static_cast<double>(summary.mP50Cycles)),
+          ns(static_cast<double>(summary.mP99Cycles)),
+          100.0 * static_cast<double>(summary.mCycles) / elapsedTicks);
+      }
+    }
+    mTelemetry.ReleaseExitedProcesses();
+  }
+
+ private:
+  SharedHookTelemetry mTelemetry;
+  uint64_t mLastTicks {};
+  std::chrono::steady_clock::time_point mLastReport;
+};
+
 LRESULT CALLBACK WintabWndproc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
   if (WintabTablet::ProcessMessage(hwnd, msg, wParam, lParam)) {
     return 0;
@@ -62,60 +159,16 @@ auto CreateWintabWindow() {
     nullptr)};
 }
 
-class DeviceLogger final : public IHandler {
- public:
-  constexpr DeviceLogger() = default;
-  constexpr DeviceLogger(IHandler* next) : mNext {next} {
-  }
-
-  ~DeviceLogger() final = default;
-
-  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override {
-    std::println(
+// Logs devices as they're added
+struct DeviceLogger final : PipelineStage {
+  template <Handler Next>
+  void SetDevice(const OTDIPC::Messages::DeviceInfo& device, Next& next) {
+    Log::Info(
       "Got device `{}` with persistent ID `{}`",
       device.GetName(),
       device.GetPersistentId());
-    if (mNext) {
-      mNext->SetDevice(device);
-    }
-  }
-
-  void SetState(const OTDIPC::Messages::State& state) override {
-    if (mNext) {
-      mNext->SetState(state);
-    }
-  }
-
- private:
-  IHandler* mNext {nullptr};
-};
-
-class MultiHandler final : public IHandler {
-public:
-  MultiHandler() = delete;
-  ~MultiHandler() = default;
-
-  MultiHandler(std::initializer_list<IHandler*> handlers) : mNext {handlers} {
-  }
-
-  void push_back(IHandler* handler) {
-    mNext.push_back(handler);
-  }
-
-  void SetDevice(const OTDIPC::Messages::DeviceInfo& device) override {
-   for (auto&& handler: mNext) {
-     handler->SetDevice(device);
-   }
-  }
-  void SetState(const OTDIPC::Messages::State& state) override {
-    for (auto&& handler: mNext) {
-     handler->SetState(state);
-    }
+    next.SetDevice(device);
   }
-
- private:
-  std::vector<IHandler*> mNext;
-
 };
 
 }// namespace
@@ -127,53 +180,172 @@ struct Args {
   magic_args::flag mOverwriteDefault {
     .help = "Overwrite the current default OTD-IPC v2 implementation, if any",
   };
+  magic_args::flag mBatchPackets {
+    .help = "Drain the whole WinTab packet queue at once, instead of reading "
+            "one packet per message",
+  };
+  magic_args::flag mLatencyReport {
+    .help = "Print latency percentiles, and the cost of the hooks in "
+            "hijacked drivers, every 10 seconds, and on exit",
+  };
 
   std::optional<WintabTablet::InjectableBuggyDriver> mHijackBuggyDriver;
+  // Record raw WinTab input to this file
+  std::optional<std::string> mCapturePackets;
+  // Serve a recording made with `--capture-packets` instead of a tablet
+  std::optional<std::string> mReplayPackets;
+  // Relative to the original recording; 0 is as fast as possible
+  std::optional<double> mReplaySpeed;
+  // Send clients that support it a prediction of where the pen will be this
+  // many milliseconds from now, after each message pump iteration
+  std::optional<double> mPredictMilliseconds;
+  // Correct each tablet's area and orientation with the transforms in this
+  // file; see `LoadCalibrationFile()`
+  std::optional<std::string> mCalibration;
 };
 
 MAGIC_ARGS_MAIN(Args&& args) try {
-  setvbuf(stdout, nullptr, _IONBF, 0);
+  // Console writes can block for a long time, e.g. while text is selected in
+  // the console window; keep them off the WinTab and reactor threads
+  const Log::Flusher logFlusher;
   gExitEvent.reset(CreateEvent(nullptr, TRUE, FALSE, nullptr));
   SetConsoleCtrlHandler(&ConsoleCtrlHandler, TRUE);
 
+  const auto localAppData = get_local_app_data();
   const V2Server::Config config {
     .implementationId = "com.openkneeboard.wintab-adapter",
     .humanName = "OpenKneeboard WinTab Adapter",
     .humanVersion = BuildConfig::SemVer,
     .homepageUrl = "https://github.com/OpenKneeboard/wintab-adapter",
-    .socketPath = get_socket_path(),
+    .socketPath
+    = localAppData / "OpenKneeboard WinTab Adapter" / "socket",
+    .discoveryDir = localAppData / "otd-ipc" / "servers" / "v2",
   };
 
+  // Serves every client's I/O; the WinTab window stays on this thread
+  Reactor reactor;
+
   auto v2Server = V2Server(
+    reactor,
     config,
     args.mOverwriteDefault ? V2Server::DefaultBehavior::AlwaysSet
                            : V2Server::DefaultBehavior::SetIfUnset);
 
   v2Server.Start();
 
-  MultiHandler servers { &v2Server };
-
   std::optional<V1Server> v1Server;
   if (args.mOtdIpcV1) {
-    v1Server.emplace();
+    v1Server.emplace(reactor);
     v1Server->Start();
-    servers.push_back(&*v1Server);
   }
 
-  auto handler = DeviceLogger {&servers};
+  auto pipeline = HandlerAdapter {Pipeline {
+    DeviceLogger {},
+    CalibrationStage {
+      args.mCalibration ? LoadCalibrationFile(*args.mCalibration)
+                        : std::vector<CalibrationConfig> {}},
+    FanOut<V2Server, V1Server> {
+      &v2Server, v1Server ? &*v1Server : nullptr},
+  }};
+
+  IHandler* input = &pipeline;
+  std::optional<PenPredictor> predictor;
+  if (
+    args.mPredictMilliseconds && args.mReplayPackets
+    && args.mReplaySpeed == 0.0) {
+    // States are timestamped when they're flushed, which is meaningless
+    // without the recording's pacing
+    Log::Info("Not predicting pen positions, as the replay isn't real-time");
+  } else if (args.mPredictMilliseconds) {
+    predictor.emplace(
+      input,
+      PenPredictor::Config {
+        .mHorizon = std::chrono::round<std::chrono::microseconds>(
+          std::chrono::duration<double, std::milli>(
+            *args.mPredictMilliseconds)),
+      });
+    input = &*predictor;
+  }
 
+  std::optional<HookReport> hookReport;
+  if (args.mLatencyReport && args.mHijackBuggyDriver) {
+    hookReport.emplace();
+  }
+
+  DeviceCache deviceCache(
+    localAppData / "OpenKneeboard WinTab Adapter" / "devices.bin");
   const auto window = CreateWintabWindow();
-  const auto wintab = std::make_unique<WintabTablet>(window.get(), &servers, args.mHijackBuggyDriver);
+  std::unique_ptr<WintabTablet> wintab;
+  std::optional<MappedFile> replayTrace;
+  std::jthread replayThread;
+  if (args.mReplayPackets) {
+    replayTrace.emplace(*args.mReplayPackets);
+    replayThread = std::jthread([&](const std::stop_token st) {
+      try {
+        const auto count = ReplayPacketTrace(
+          st,
+          replayTrace->GetBytes(),
+          *input,
+          args.mReplaySpeed.value_or(1.0));
+        Log::Info("Replayed {} events", count);
+      } catch (const std::exception& e) {
+        Log::Error("Replay failed: {}", e.what());
+      }
+      gExitEvent.SetEvent();
+    });
+  } else {
+    // Cached tablets are published as soon as WinTab reports them; WinTab
+    // can take a while, especially while the system is starting up
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto elapsedMs = [startTime] {
+      return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - startTime)
+        .count();
+    };
+    wintab = std::make_unique<WintabTablet>(
+      window.get(),
+      input,
+      args.mHijackBuggyDriver,
+      args.mBatchPackets ? WintabTablet::PacketIngestion::Batched
+                         : WintabTablet::PacketIngestion::PerMessage,
+      &deviceCache);
+    Log::Info("Connected to WinTab after {:.1f}ms", elapsedMs());
+    deviceCache.RemoveUnseen();
+    deviceCache.Save();
+    if (args.mCapturePackets) {
+      wintab->CaptureTo(*args.mCapturePackets);
+    }
+  }
 
   const std::array events {static_cast<HANDLE>(gExitEvent.get())};
+  auto nextLatencyReport
+    = std::chrono::steady_clock::now() + LatencyReportInterval;
   while (true) {
+    DWORD timeout = INFINITE;
+    if (args.mLatencyReport) {
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= nextLatencyReport) {
+        PrintLatencyReport();
+        if (hookReport) {
+          hookReport->Print();
+        }
+        nextLatencyReport = now + LatencyReportInterval;
+      }
+      timeout = static_cast<DWORD>(
+        std::chrono::ceil<std::chrono::milliseconds>(nextLatencyReport - now)
+          .count());
+    }
+
     constexpr auto InputResult = WAIT_OBJECT_0 + events.size();
     const auto result = MsgWaitForMultipleObjectsEx(
       static_cast<DWORD>(events.size()),
       events.data(),
-      INFINITE,
+      timeout,
       QS_ALLINPUT,
       MWMO_INPUTAVAILABLE);
+    if (result == WAIT_TIMEOUT) {
+      continue;
+    }
     if (result != InputResult) {
       break;
     }
@@ -182,10 +354,17 @@ MAGIC_ARGS_MAIN(Args&& args) try {
       TranslateMessage(&msg);
       DispatchMessageW(&msg);
     }
+    input->Flush();
   }
 
+  if (args.mLatencyReport) {
+    PrintLatencyReport();
+    if (hookReport) {
+      hookReport->Print();
+    }
+  }
   return EXIT_SUCCESS;
 } catch (const std::exception& e) {
-  std::println(stderr, "Error: {}", e.what());
+  Log::Error("Error: {}", e.what());
   return EXIT_FAILURE;
 }